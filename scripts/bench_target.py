@@ -0,0 +1,15 @@
+# env:native_bench的自定义目标：pio run -e native_bench -t bench
+# 构建后立即运行基准测试，任一项超限或退化时程序返回非0，pio随之失败
+# 基线、容差等参数写在platformio.ini的custom_bench_args中
+Import("env")
+
+program = "$BUILD_DIR/${PROGNAME}${PROGSUFFIX}"
+args = env.GetProjectOption("custom_bench_args", "")
+
+env.AddCustomTarget(
+    name="bench",
+    dependencies=program,
+    actions=f'"{program}" --json "$BUILD_DIR/bench.json" {args}',
+    title="Bench",
+    description="运行主机基准测试，超过上限或比基线慢时失败",
+)
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "board_config.hpp"
+#include "constants.hpp"
+
+// 轴编号，同时是AXIS_REGISTRY和各轴状态数组的下标
+// 注射泵和蠕动泵在所有板型上固定为前两个轴，其余轴按板型描述中的顺序用下标寻址
+enum StepAxisId : uint8_t {
+    SYRINGE_AXIS = 0,
+    PERISTALTIC_AXIS = 1
+};
+
+// 轴注册表：当前板型的各轴描述（引脚、运动学与限制），见board_config.hpp
+// 新增一个泵只需在板型描述的axes中加一项，步进引擎、运动核心、文本指令和遥测都按下标遍历
+inline constexpr const auto& AXIS_REGISTRY = BOARD.axes;
+constexpr size_t STEP_AXIS_COUNT = AXIS_REGISTRY.size();
+
+// 一步至少占两个tick，所有轴的最高速度都必须在步进中断能产生的范围内
+static_assert(std::ranges::all_of(AXIS_REGISTRY, [](const AxisDescriptor& axis) {
+    return axis.max_speed * 2 < STEP_TICK_FREQ;
+}), "步进中断频率不足以产生某个轴的max_speed");
+
+// ISR通过hal::gpioWriteMask批量写GPIO，只支持GPIO0~31
+static_assert(std::ranges::all_of(AXIS_REGISTRY, [](const AxisDescriptor& axis) {
+    return axis.step_pin < 32 && axis.dir_pin < 32;
+}), "步进引脚必须位于GPIO0~31");
+
+// 运动核心用位图记录各轴是否在运动
+static_assert(STEP_AXIS_COUNT <= 32, "轴数超过运动位图宽度");
@@ -0,0 +1,472 @@
+// 主机端基准测试（env:native_bench），测量固件热点路径的耗时
+// 用模拟HAL运行与板上相同的解析、485组帧、步进规划和回复格式化代码，结果以JSON输出
+// 任一项超过绝对上限（乘以--limit-scale），或比--baseline给出的上次结果慢了--tolerance以上时返回1，
+// 参数错误或--filter没有选中任何一项时返回2；pio run -e native_bench -t bench 构建后立即运行，失败时构建失败
+//
+// .pio/build/native_bench/program [--json 结果.json] [--baseline 上次结果.json] [--tolerance 0.25]
+//                                 [--limit-scale 1] [--filter 名称片段]
+
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+
+#include "binary_protocol.hpp"
+#include "command_parser.hpp"
+#include "constants.hpp"
+#include "ctrl_board_manager.hpp"
+#include "hal_native.hpp"
+#include "host_log.hpp"
+#include "misc.hpp"
+#include "step_engine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static StepEngine step_engine;
+static CtrlBoardManager manager(step_engine);
+
+// 每项先倍增迭代次数直到单轮耗时超过CALIBRATE_NS，再按BENCH_ROUND_NS定出每轮次数，取BENCH_REPEATS轮中最快的一轮
+constexpr uint64_t CALIBRATE_NS = 10'000'000;
+constexpr uint64_t BENCH_ROUND_NS = 50'000'000;
+constexpr int BENCH_REPEATS = 5;
+constexpr double DEFAULT_TOLERANCE = 0.25;
+constexpr double DEFAULT_LIMIT_SCALE = 1.0;
+
+// 有代表性的文本指令：覆盖各轴、切换阀、电磁阀、比例阀、光源和查询类指令，以及参数错误的情况
+// 板上没有的外设按无效指令处理，同样走一遍分派
+constexpr std::array<std::string_view, 24> COMMAND_CORPUS {{
+    "sp -fv 1.5",
+    "sp -sv 0.25",
+    "sp -v 12000",
+    "sp -a 200000",
+    "sp -s",
+    "pp -bv 3",
+    "pp -sv 0.1",
+    "pp -j 500000",
+    "pp -s",
+    "sv -c 4",
+    "sv -check",
+    "sv -raw cc00200000ddc901",
+    "sov -h c3",
+    "sov -b 11000011",
+    "sov -c 3 1",
+    "sov -m 0f f0",
+    "pv -p 50",
+    "pv -max 100",
+    "l -b 128",
+    "l -c ff0000 ff",
+    "co -s",
+    "tm -s",
+    "sp -fv abc",
+    "xx -y 1",
+}};
+
+// 数字参数：浮点、整数、十六进制位图
+constexpr std::array<std::string_view, 8> NUMBER_CORPUS {{
+    "1.5", "0.25", "12000", "-3", "200000", "0.001", "35", "4",
+}};
+
+// 阻止编译器把被测结果当作无用计算删掉
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// 清空被测代码写出的日志，保持输出队列不满，每次测量的路径相同
+static void drainOutput() {
+    hostLog().drain();
+    hal::native::hostMock().takeOutput();
+}
+
+static void benchTokenize(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        const CommandTokens tokens = tokenizeCommand(COMMAND_CORPUS[i % COMMAND_CORPUS.size()]);
+        keep(tokens);
+    }
+}
+
+static void benchParseNumber(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        float value = 0;
+        const bool b_ok = parseNumber(NUMBER_CORPUS[i % NUMBER_CORPUS.size()], value);
+        keep(value);
+        keep(b_ok);
+    }
+}
+
+static void benchParseMask(uint64_t iterations) {
+    constexpr std::array<std::string_view, 4> masks {{"c3", "11000011", "0f", "ffffff"}};
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint32_t value = 0;
+        const size_t index = i % masks.size();
+        const bool b_ok = parseNumber(masks[index], value, index == 1 ? 2 : 16);
+        keep(value);
+        keep(b_ok);
+    }
+}
+
+// 一条指令的完整处理：分词、分派、参数检查、执行（投递运动指令、入队485帧等）与回复
+static void benchTextDispatch(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        manager.procInstruction(COMMAND_CORPUS[i % COMMAND_CORPUS.size()]);
+        // 运动核心取走指令，避免队列满后路径改变
+        manager.maintainMotor();
+        manager.procMotionEvents();
+        drainOutput();
+    }
+}
+
+static void benchHexString(uint64_t iterations) {
+    std::array<unsigned char, INSTR_485_LEN> buffer{};
+    for (uint64_t i = 0; i < iterations; i++) {
+        const bool b_ok = hexStringToBytes("cc00200000ddc901", buffer.data());
+        keep(buffer);
+        keep(b_ok);
+    }
+}
+
+static void benchSwitchFrame(uint64_t iterations) {
+    std::array<uint8_t, INSTR_485_LEN> buffer{};
+    for (uint64_t i = 0; i < iterations; i++) {
+        const SwitchCommand command = SwitchChannel{static_cast<int>(i % SWITCH_CHANNEL_COUNT) + 1};
+        const bool b_ok = buildSwitchFrame(command, 0, buffer.data());
+        keep(buffer);
+        keep(b_ok);
+    }
+}
+
+static void benchSwitchChecksum(uint64_t iterations) {
+    std::array<uint8_t, INSTR_485_LEN> frame {{0xcc, 0x00, 0x00, 0x03, 0x00, 0xdd, 0x00, 0x00}};
+    const uint16_t sum = switchChecksum(frame.data());
+    frame[6] = static_cast<uint8_t>(sum & 0xff);
+    frame[7] = static_cast<uint8_t>(sum >> 8);
+    for (uint64_t i = 0; i < iterations; i++) {
+        keep(frame);
+        const bool b_ok = switchFrameValid(frame.data());
+        keep(b_ok);
+    }
+}
+
+static void benchCrc16(uint64_t iterations) {
+    std::array<uint8_t, BINARY_FRAME_MAX> frame{};
+    for (size_t i = 0; i < frame.size(); i++) {
+        frame[i] = static_cast<uint8_t>(i * 37);
+    }
+    for (uint64_t i = 0; i < iterations; i++) {
+        keep(frame);
+        const uint16_t crc = crc16(frame.data(), frame.size());
+        keep(crc);
+    }
+}
+
+static void benchCobs(uint64_t iterations) {
+    std::array<uint8_t, BINARY_FRAME_MAX> frame{};
+    std::array<uint8_t, BINARY_WIRE_MAX> encoded{};
+    std::array<uint8_t, BINARY_WIRE_MAX> decoded{};
+    for (size_t i = 0; i < frame.size(); i++) {
+        frame[i] = static_cast<uint8_t>(i % 7);  // 含0x00，走完整的COBS分组
+    }
+    for (uint64_t i = 0; i < iterations; i++) {
+        const size_t len = cobsEncode(frame.data(), frame.size(), encoded.data());
+        const size_t out = cobsDecode(encoded.data(), len, decoded.data());
+        keep(decoded);
+        keep(out);
+    }
+}
+
+// 一帧二进制指令的完整处理：COBS解码、CRC校验、执行与编码应答
+static void benchBinaryFrame(uint64_t iterations) {
+    std::array<uint8_t, 3> frame {{0x01, static_cast<uint8_t>(BinaryOpcode::GET_STATUS), 0}};
+    std::array<uint8_t, 5> raw{};
+    const uint16_t crc = crc16(frame.data(), 2);
+    raw = {frame[0], frame[1], static_cast<uint8_t>(crc & 0xff), static_cast<uint8_t>(crc >> 8), 0};
+    std::array<uint8_t, 8> encoded{};
+    const size_t len = cobsEncode(raw.data(), 4, encoded.data());
+    for (uint64_t i = 0; i < iterations; i++) {
+        procBinaryFrame(manager, encoded.data(), len);
+        drainOutput();
+    }
+}
+
+static StepAxis makeBenchAxis() {
+    const AxisDescriptor& desc = AXIS_REGISTRY[SYRINGE_AXIS];
+    StepAxis axis;
+    axis.setMaxSpeed(desc.max_speed);
+    axis.setAcceleration(desc.acceleration);
+    axis.setJerk(desc.jerk);
+    return axis;
+}
+
+// 位置运动的规划：斜坡时间、斜坡步数与巡航速度（在任务中执行，含浮点运算）
+static void benchStepPlan(uint64_t iterations) {
+    StepAxis axis = makeBenchAxis();
+    for (uint64_t i = 0; i < iterations; i++) {
+        axis.setCurrentPosition(0);
+        axis.move((i & 1) ? 50000 : -1200);
+        keep(axis);
+    }
+}
+
+// 步进中断中每轴每tick的耗时，覆盖加速、巡航与减速段
+static void benchStepTick(uint64_t iterations) {
+    StepAxis axis = makeBenchAxis();
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (!axis.isRunning()) {
+            axis.setCurrentPosition(0);
+            axis.move(20000);
+        }
+        const uint8_t action = axis.tick();
+        keep(action);
+    }
+}
+
+// 恒速运行的改速规划
+static void benchStepVelocity(uint64_t iterations) {
+    StepAxis axis = makeBenchAxis();
+    axis.runVelocity(5000, 0);
+    for (uint64_t i = 0; i < iterations; i++) {
+        const bool b_ok = axis.runVelocity((i & 1) ? 8000.0f : 5000.0f, 0);
+        keep(b_ok);
+    }
+}
+
+// 典型回复的格式化与写入输出队列
+static void benchResponseFormat(uint64_t iterations) {
+    const AxisDescriptor& desc = AXIS_REGISTRY[SYRINGE_AXIS];
+    for (uint64_t i = 0; i < iterations; i++) {
+        const float speed = 1000.0f + static_cast<float>(i % 64);
+        std::string msg_str = std::format(
+            "已设置{}速度为 {} 微步/s，对应电机转速 {} rps\n",
+            desc.name,
+            speed,
+            speed / desc.microsteps_per_rev
+        );
+        hostLog().print(msg_str);
+        drainOutput();
+    }
+}
+
+static void benchSwitchResponse(uint64_t iterations) {
+    Rs485Transaction txn{};
+    txn.request = {0xcc, 0x00, 0x3e, 0x00, 0x00, 0xdd, 0x00, 0x00};
+    txn.response = {0xcc, 0x00, 0x00, 0x03, 0x00, 0xdd, 0xac, 0x01};
+    txn.status = Rs485Status::OK;
+    for (uint64_t i = 0; i < iterations; i++) {
+        printSwitchResponse(txn, nullptr);
+        drainOutput();
+    }
+}
+
+struct BenchCase {
+    std::string_view name;
+    double limit_ns;                    // 每次操作的绝对上限
+    void (*run)(uint64_t iterations);
+};
+
+// 上限约为x86-64开发机上-O2实测值的3~4倍，含std::format的几项再多留一些余量
+// 比开发机慢的CI机器用--limit-scale整体放宽，不要改这里的数值
+constexpr std::array<BenchCase, 15> BENCH_CASES {{
+    {"parse/tokenize", 200, benchTokenize},
+    {"parse/number", 80, benchParseNumber},
+    {"parse/mask", 40, benchParseMask},
+    {"parse/text_dispatch", 12000, benchTextDispatch},
+    {"misc/hex_string_to_bytes", 100, benchHexString},
+    {"rs485/build_switch_frame", 60, benchSwitchFrame},
+    {"rs485/switch_checksum", 40, benchSwitchChecksum},
+    {"binary/crc16_64", 3000, benchCrc16},
+    {"binary/cobs_roundtrip_64", 600, benchCobs},
+    {"binary/get_status_frame", 4000, benchBinaryFrame},
+    {"step/plan", 250, benchStepPlan},
+    {"step/tick", 25, benchStepTick},
+    {"step/velocity_change", 120, benchStepVelocity},
+    {"format/axis_speed_reply", 3000, benchResponseFormat},
+    {"format/switch_response", 6000, benchSwitchResponse},
+}};
+
+enum class BenchStatus : uint8_t {
+    OK = 0,
+    OVER_LIMIT = 1,                     // 超过绝对上限
+    REGRESSED = 2,                      // 比基线慢了tolerance以上
+};
+
+static constexpr std::string_view statusName(BenchStatus status) {
+    switch (status) {
+        case BenchStatus::OVER_LIMIT: return "over_limit";
+        case BenchStatus::REGRESSED: return "regressed";
+        default: return "ok";
+    }
+}
+
+struct BenchResult {
+    std::string_view name;
+    uint64_t iterations;
+    double ns_per_op;
+    double limit_ns;                    // 已乘以limit_scale
+    double baseline_ns;                 // 没有基线时为0
+    BenchStatus status;
+};
+
+static uint64_t elapsedNs(void (*run)(uint64_t), uint64_t iterations) {
+    const auto start = std::chrono::steady_clock::now();
+    run(iterations);
+    const auto end = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+static BenchResult measure(const BenchCase& bench, double limit_scale) {
+    uint64_t iterations = 1;
+    uint64_t ns = elapsedNs(bench.run, iterations);
+    while (ns < CALIBRATE_NS) {
+        iterations *= 2;
+        ns = elapsedNs(bench.run, iterations);
+    }
+    iterations = std::max<uint64_t>(1, iterations * BENCH_ROUND_NS / ns);
+
+    double best = 0;
+    for (int i = 0; i < BENCH_REPEATS; i++) {
+        const double ns_per_op = static_cast<double>(elapsedNs(bench.run, iterations)) / iterations;
+        if (i == 0 || ns_per_op < best) {
+            best = ns_per_op;
+        }
+    }
+    return {bench.name, iterations, best, bench.limit_ns * limit_scale, 0, BenchStatus::OK};
+}
+
+// 读取上次输出的JSON中各项的ns_per_op，每项占一行，只解析本程序自己写出的格式
+static bool loadBaseline(const char* path, std::vector<std::pair<std::string, double>>& baseline) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t name_pos = line.find("\"name\": \"");
+        const size_t ns_pos = line.find("\"ns_per_op\": ");
+        if (name_pos == std::string::npos || ns_pos == std::string::npos) continue;
+        const size_t name_start = name_pos + std::strlen("\"name\": \"");
+        const size_t name_end = line.find('"', name_start);
+        baseline.emplace_back(line.substr(name_start, name_end - name_start),
+                              std::strtod(line.c_str() + ns_pos + std::strlen("\"ns_per_op\": "), nullptr));
+    }
+    return true;
+}
+
+static std::string toJson(const std::vector<BenchResult>& results, double tolerance, double limit_scale) {
+    std::string json = std::format(
+        "{{\n  \"context\": {{\"board\": \"{}\", \"step_tick_freq\": {}, \"repeats\": {}, \"tolerance\": {}, \"limit_scale\": {}}},\n"
+        "  \"benchmarks\": [\n",
+        BOARD.name,
+        STEP_TICK_FREQ,
+        BENCH_REPEATS,
+        tolerance,
+        limit_scale
+    );
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        json += std::format(
+            "    {{\"name\": \"{}\", \"iterations\": {}, \"ns_per_op\": {:.3f}, \"limit_ns\": {}, \"baseline_ns\": {:.3f}, \"status\": \"{}\"}}{}\n",
+            r.name,
+            r.iterations,
+            r.ns_per_op,
+            r.limit_ns,
+            r.baseline_ns,
+            statusName(r.status),
+            i + 1 < results.size() ? "," : ""
+        );
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+int main(int argc, char** argv) {
+    const char* json_path = nullptr;
+    const char* baseline_path = nullptr;
+    double tolerance = DEFAULT_TOLERANCE;
+    double limit_scale = DEFAULT_LIMIT_SCALE;
+    std::string_view filter;
+    bool b_usage = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (i + 1 < argc && arg == "--json") {
+            json_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--baseline") {
+            baseline_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--tolerance") {
+            tolerance = std::strtod(argv[++i], nullptr);
+            b_usage |= !(tolerance >= 0);
+        } else if (i + 1 < argc && arg == "--limit-scale") {
+            limit_scale = std::strtod(argv[++i], nullptr);
+            b_usage |= !(limit_scale > 0);
+        } else if (i + 1 < argc && arg == "--filter") {
+            filter = argv[++i];
+        } else {
+            b_usage = true;
+        }
+    }
+    if (b_usage) {
+        std::fprintf(stderr, "用法：%s [--json 文件] [--baseline 文件] [--tolerance 0.25] [--limit-scale 1] [--filter 名称片段]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::pair<std::string, double>> baseline;
+    if (baseline_path && !loadBaseline(baseline_path, baseline)) {
+        std::fprintf(stderr, "无法读取基线文件 %s\n", baseline_path);
+        return 2;
+    }
+
+    manager.init();
+    drainOutput();
+
+    std::vector<BenchResult> results;
+    bool b_failed = false;
+    for (const BenchCase& bench : BENCH_CASES) {
+        if (!filter.empty() && bench.name.find(filter) == std::string_view::npos) continue;
+        BenchResult result = measure(bench, limit_scale);
+        const auto it = std::find_if(baseline.begin(), baseline.end(),
+                                     [&](const auto& entry) { return entry.first == bench.name; });
+        if (it != baseline.end()) {
+            result.baseline_ns = it->second;
+        }
+        if (result.ns_per_op > result.limit_ns) {
+            result.status = BenchStatus::OVER_LIMIT;
+        } else if (result.baseline_ns > 0 && result.ns_per_op > result.baseline_ns * (1 + tolerance)) {
+            result.status = BenchStatus::REGRESSED;
+        }
+        b_failed |= (result.status != BenchStatus::OK);
+
+        // 人读的摘要写到stderr，stdout只留JSON
+        std::fprintf(stderr, "%-28s %12.1f ns/op  上限 %8.0f", std::string(result.name).c_str(), result.ns_per_op, result.limit_ns);
+        if (result.baseline_ns > 0) {
+            std::fprintf(stderr, "  基线 %10.1f (%+.1f%%)", result.baseline_ns,
+                         100 * (result.ns_per_op / result.baseline_ns - 1));
+        }
+        std::fprintf(stderr, "  %s\n", std::string(statusName(result.status)).c_str());
+        results.push_back(result);
+    }
+    // 名称片段写错时什么也没测，不能当作通过
+    if (results.empty()) {
+        std::fprintf(stderr, "--filter %s 没有选中任何一项\n", std::string(filter).c_str());
+        return 2;
+    }
+
+    const std::string json = toJson(results, tolerance, limit_scale);
+    if (json_path) {
+        std::ofstream file(json_path);
+        file << json;
+    } else {
+        std::fwrite(json.data(), 1, json.size(), stdout);
+    }
+    if (b_failed) {
+        const size_t failed = std::count_if(results.begin(), results.end(),
+                                            [](const BenchResult& r) { return r.status != BenchStatus::OK; });
+        std::fprintf(stderr, "%zu项未通过\n", failed);
+    }
+    return b_failed ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,394 @@
+#include "binary_protocol.hpp"
+
+#include "constants.hpp"
+#include "host_log.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// output至少需要 len + len / 254 + 1 字节，返回编码后长度（不含分隔符）
+size_t cobsEncode(const uint8_t* input, size_t len, uint8_t* output) {
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (input[i] == 0) {
+            output[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            output[out++] = input[i];
+            if (++code == 0xff) {
+                output[code_pos] = code;
+                code_pos = out++;
+                code = 1;
+            }
+        }
+    }
+    output[code_pos] = code;
+    return out;
+}
+
+// 返回解码后长度，格式错误时返回0
+size_t cobsDecode(const uint8_t* input, size_t len, uint8_t* output) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < len) {
+        const uint8_t code = input[in++];
+        if (code == 0 || in + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            output[out++] = input[in++];
+        }
+        if (code != 0xff && in < len) {
+            output[out++] = 0;
+        }
+    }
+    return out;
+}
+
+void sendBinaryFrame(const uint8_t* frame, size_t len) {
+    std::array<uint8_t, BINARY_FRAME_MAX + 2> buffer;
+    std::array<uint8_t, BINARY_WIRE_MAX + 2> encoded;
+    if (len > BINARY_FRAME_MAX) return;
+
+    std::memcpy(buffer.data(), frame, len);
+    const uint16_t crc = crc16(frame, len);
+    buffer[len] = static_cast<uint8_t>(crc & 0xff);
+    buffer[len + 1] = static_cast<uint8_t>(crc >> 8);
+
+    // 帧前也加分隔符，这样夹在帧之间的文本日志会被上位机当作坏帧丢弃，不会污染下一帧
+    encoded[0] = 0;
+    const size_t encoded_len = cobsEncode(buffer.data(), len + 2, encoded.data() + 1);
+    encoded[encoded_len + 1] = 0;
+    hostLog().writeFrame(encoded.data(), encoded_len + 2);
+}
+
+template <typename T>
+static bool readArgs(const uint8_t* args, size_t len, T& value) {
+    if (len != sizeof(T)) return false;
+    std::memcpy(&value, args, sizeof(T));
+    return true;
+}
+
+// 当前板型是否有该指令用到的外设，操作码按外设分段（0x30切换阀、0x40电磁阀、0x50比例阀、0x60光源）
+static constexpr bool opcodeAvailable(BinaryOpcode opcode) {
+    switch (static_cast<uint8_t>(opcode) & 0xF0) {
+        case 0x30:
+            return BOARD.switch_valve.b_present;
+        case 0x40:
+            return BOARD.solenoid.b_present;
+        case 0x50:
+            return BOARD.dac.b_present;
+        case 0x60:
+            return BOARD.led.b_present;
+        default:
+            return true;
+    }
+}
+
+// SP_FLOW/PP_FLOW：完整参数启动恒流，只有流速时在恒流中改流速
+static BinaryResult flowCommand(CtrlBoardManager& manager, StepAxisId axis, const uint8_t* args, size_t args_len) {
+    ArgFlow arg_flow{};
+    ArgFloat arg_float{};
+    if (readArgs(args, args_len, arg_float)) {
+        arg_flow.rate = arg_float.value;
+        if (manager.flowActive(axis)) {
+            return manager.setFlowRate(axis, arg_flow.rate) ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+    } else if (!readArgs(args, args_len, arg_flow)) {
+        return BinaryResult::BAD_ARGS;
+    }
+    return manager.startFlow(axis, arg_flow.rate, arg_flow.volume, arg_flow.seconds) ? BinaryResult::OK : BinaryResult::REJECTED;
+}
+
+static BinaryResult execute(CtrlBoardManager& manager, BinaryOpcode opcode,
+                            const uint8_t* args, size_t args_len,
+                            uint8_t* reply, size_t& reply_len) {
+    ArgFloat arg_float{};
+    ArgU8 arg_u8{};
+    ArgU16 arg_u16{};
+    ArgSolenoidChannel arg_channel{};
+
+    if (!opcodeAvailable(opcode)) {
+        return BinaryResult::REJECTED;
+    }
+
+    switch (opcode) {
+        using enum BinaryOpcode;
+        case PING:
+            return BinaryResult::OK;
+        case GET_STATUS: {
+            const BoardStatus status = manager.getStatus();
+            const StatusPayload payload {
+                .syringe_position = static_cast<int32_t>(status.axes[SYRINGE_AXIS].position),
+                .peristaltic_position = static_cast<int32_t>(status.axes[PERISTALTIC_AXIS].position),
+                .motor_flags = static_cast<uint8_t>(status.runningMask()),
+                .switch_channel = status.switch_channel,
+                .solenoid_valve_status = static_cast<uint8_t>(status.solenoid_valve_status),
+                .cur_pressure = static_cast<uint16_t>(status.cur_pressure),
+                .max_pressure = static_cast<uint16_t>(status.max_pressure),
+                .light_status = status.light_status,
+                .brightness = status.brightness,
+                .solenoid_mask = status.solenoid_valve_status,
+            };
+            std::memcpy(reply, &payload, sizeof(payload));
+            reply_len = sizeof(payload);
+            return BinaryResult::OK;
+        }
+        case TELEMETRY_RATE:
+            if (!readArgs(args, args_len, arg_u16)) return BinaryResult::BAD_ARGS;
+            return manager.telemetryStream().setRate(arg_u16.value) ? BinaryResult::OK : BinaryResult::REJECTED;
+        case TELEMETRY_DATA:
+            return BinaryResult::REJECTED;
+        case TEXT_MODE:
+            manager.setHostProtocol(HostProtocol::TEXT);
+            return BinaryResult::OK;
+
+        case SP_MOVE_VOLUME:
+            if (!readArgs(args, args_len, arg_float)) return BinaryResult::BAD_ARGS;
+            if (!std::isfinite(arg_float.value)) return BinaryResult::REJECTED;
+            manager.moveAxisVolume(SYRINGE_AXIS, arg_float.value);
+            return BinaryResult::OK;
+        case SP_SET_SPEED:
+            if (!readArgs(args, args_len, arg_float)) return BinaryResult::BAD_ARGS;
+            if (!(arg_float.value > 0 && arg_float.value <= AXIS_REGISTRY[SYRINGE_AXIS].max_volume_speed)) {
+                return BinaryResult::REJECTED;
+            }
+            manager.setAxisSpeed(SYRINGE_AXIS, arg_float.value, true);
+            return BinaryResult::OK;
+        case SP_STOP:
+            manager.stopAxis(SYRINGE_AXIS);
+            return BinaryResult::OK;
+        case SP_FLOW:
+            return flowCommand(manager, SYRINGE_AXIS, args, args_len);
+
+        case PP_MOVE_VOLUME:
+            if (!readArgs(args, args_len, arg_float)) return BinaryResult::BAD_ARGS;
+            if (!std::isfinite(arg_float.value)) return BinaryResult::REJECTED;
+            manager.moveAxisVolume(PERISTALTIC_AXIS, arg_float.value);
+            return BinaryResult::OK;
+        case PP_SET_SPEED:
+            if (!readArgs(args, args_len, arg_float)) return BinaryResult::BAD_ARGS;
+            if (!(arg_float.value > 0 && arg_float.value <= AXIS_REGISTRY[PERISTALTIC_AXIS].max_volume_speed)) {
+                return BinaryResult::REJECTED;
+            }
+            manager.setAxisSpeed(PERISTALTIC_AXIS, arg_float.value, true);
+            return BinaryResult::OK;
+        case PP_STOP:
+            manager.stopAxis(PERISTALTIC_AXIS);
+            return BinaryResult::OK;
+        case PP_FLOW:
+            return flowCommand(manager, PERISTALTIC_AXIS, args, args_len);
+
+        case CO_MOVE: {
+            ArgCoordinated arg_co{};
+            if (!readArgs(args, args_len, arg_co)) return BinaryResult::BAD_ARGS;
+            const bool b_ok = manager.moveCoordinated({arg_co.syringe_volume, arg_co.peristaltic_volume}, arg_co.duration);
+            return b_ok ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+        case FLOW_STATUS: {
+            uint8_t active_mask = 0;
+            for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+                if (manager.flowActive(static_cast<StepAxisId>(i))) {
+                    active_mask |= static_cast<uint8_t>(1u << i);
+                }
+            }
+            const FlowStatusPayload payload {
+                .active_mask = active_mask,
+                .syringe_volume = manager.flowVolume(SYRINGE_AXIS),
+                .syringe_total = manager.flowTotal(SYRINGE_AXIS),
+                .peristaltic_volume = manager.flowVolume(PERISTALTIC_AXIS),
+                .peristaltic_total = manager.flowTotal(PERISTALTIC_AXIS),
+            };
+            std::memcpy(reply, &payload, sizeof(payload));
+            reply_len = sizeof(payload);
+            return BinaryResult::OK;
+        }
+
+        case SV_CHANNEL: {
+            ArgSwitchChannel arg_switch{};
+            if (readArgs(args, args_len, arg_u8)) {
+                arg_switch.channel = arg_u8.value;
+            } else if (!readArgs(args, args_len, arg_switch)) {
+                return BinaryResult::BAD_ARGS;
+            }
+            const bool b_ok = manager.switchValve(SwitchChannel{arg_switch.channel}, arg_switch.valve);
+            return b_ok ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+        case SV_RESET:
+        case SV_CHECK:
+        case SV_STATUS: {
+            if (args_len != 0 && !readArgs(args, args_len, arg_u8)) return BinaryResult::BAD_ARGS;
+            SwitchCommand command = SwitchReset{};
+            if (opcode == SV_CHECK) command = SwitchCheck{};
+            if (opcode == SV_STATUS) command = SwitchStatus{};
+            return manager.switchValve(command, arg_u8.value) ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+
+        case SOV_SET:
+            if (!readArgs(args, args_len, arg_u8)) return BinaryResult::BAD_ARGS;
+            manager.setSolenoidStatus(arg_u8.value);
+            return BinaryResult::OK;
+        case SOV_CHANNEL:
+            if (!readArgs(args, args_len, arg_channel)) return BinaryResult::BAD_ARGS;
+            if (arg_channel.channel < 1 || arg_channel.channel > SOLENOID_CHANNELS) return BinaryResult::REJECTED;
+            manager.solenoidToggleChannel(arg_channel.channel, arg_channel.on != 0);
+            return BinaryResult::OK;
+        case SOV_MASK: {
+            ArgSolenoidMask arg_mask{};
+            if (!readArgs(args, args_len, arg_mask)) return BinaryResult::BAD_ARGS;
+            if ((arg_mask.open_mask | arg_mask.close_mask) > SOLENOID_MASK_ALL) return BinaryResult::REJECTED;
+            if (arg_mask.open_mask & arg_mask.close_mask) return BinaryResult::REJECTED;
+            manager.modifySolenoids(arg_mask.open_mask, arg_mask.close_mask);
+            return BinaryResult::OK;
+        }
+        case SOV_TIMED: {
+            ArgSolenoidTimed arg_timed{};
+            if (!readArgs(args, args_len, arg_timed)) return BinaryResult::BAD_ARGS;
+            const bool b_ok = manager.timeSolenoids(arg_timed.mask, arg_timed.on_ms, arg_timed.off_ms,
+                                                    arg_timed.cycles, arg_timed.stagger_ms, arg_timed.delay_ms);
+            return b_ok ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+
+        case PV_SET_PRESSURE:
+            if (!readArgs(args, args_len, arg_u16)) return BinaryResult::BAD_ARGS;
+            return manager.setPressure(arg_u16.value) ? BinaryResult::OK : BinaryResult::REJECTED;
+        case PV_RAMP: {
+            ArgPressureRamp arg_ramp{};
+            if (!readArgs(args, args_len, arg_ramp) || arg_ramp.shape > 1) return BinaryResult::BAD_ARGS;
+            const bool b_ok = manager.setPressure(arg_ramp.kpa, arg_ramp.ramp_ms,
+                                                  static_cast<PressureRampShape>(arg_ramp.shape));
+            return b_ok ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+        case PV_LOOP: {
+            ArgPressureLoop arg_loop{};
+            if (!readArgs(args, args_len, arg_loop) || arg_loop.enabled > 1) return BinaryResult::BAD_ARGS;
+            const bool b_ok = manager.setPressureGains(arg_loop.kp, arg_loop.ki, arg_loop.kd, arg_loop.kff)
+                              && manager.setPressureLoop(arg_loop.enabled == 1);
+            return b_ok ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+        case PV_SET_MAX:
+            if (!readArgs(args, args_len, arg_u16)) return BinaryResult::BAD_ARGS;
+            return manager.setMaxPressure(arg_u16.value) ? BinaryResult::OK : BinaryResult::REJECTED;
+
+        case LIGHT_SWITCH:
+            if (!readArgs(args, args_len, arg_u8)) return BinaryResult::BAD_ARGS;
+            if (arg_u8.value) {
+                manager.turnOnLED();
+            } else {
+                manager.shutLED();
+            }
+            return BinaryResult::OK;
+        case LIGHT_BRIGHTNESS:
+            if (!readArgs(args, args_len, arg_u8)) return BinaryResult::BAD_ARGS;
+            manager.setBrightness(arg_u8.value);
+            return BinaryResult::OK;
+        case LIGHT_FILL: {
+            ArgLightFill arg_fill{};
+            if (!readArgs(args, args_len, arg_fill) || (arg_fill.mask & ~LED_MASK_ALL) != 0) return BinaryResult::BAD_ARGS;
+            manager.lightEngine().fill(arg_fill.mask, LedColor(arg_fill.r, arg_fill.g, arg_fill.b));
+            return BinaryResult::OK;
+        }
+        case LIGHT_PIXEL: {
+            ArgLightPixel arg_pixel{};
+            if (!readArgs(args, args_len, arg_pixel)) return BinaryResult::BAD_ARGS;
+            const bool b_ok = manager.lightEngine().setPixel(arg_pixel.index, LedColor(arg_pixel.r, arg_pixel.g, arg_pixel.b));
+            return b_ok ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+        case LIGHT_ANIMATE: {
+            ArgLightAnimation arg_animation{};
+            if (!readArgs(args, args_len, arg_animation) || arg_animation.type > static_cast<uint8_t>(LedAnimationType::CHASE)) {
+                return BinaryResult::BAD_ARGS;
+            }
+            if (arg_animation.type == 0) {
+                manager.lightEngine().stopAnimation();
+                return BinaryResult::OK;
+            }
+            const LedAnimation animation {
+                .type = static_cast<LedAnimationType>(arg_animation.type),
+                .mask = arg_animation.mask,
+                .on_ms = arg_animation.on_ms,
+                .off_ms = arg_animation.off_ms,
+                .cycles = arg_animation.cycles,
+            };
+            return manager.lightEngine().animate(animation) ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+
+        case RECIPE_ADD: {
+            ArgRecipeStep arg_step{};
+            if (!readArgs(args, args_len, arg_step)) return BinaryResult::BAD_ARGS;
+            const RecipeStep step {
+                .op = static_cast<RecipeOp>(arg_step.op),
+                .args = {arg_step.args[0], arg_step.args[1], arg_step.args[2]},
+            };
+            return manager.recipeRunner().add(step) ? BinaryResult::OK : BinaryResult::REJECTED;
+        }
+        case RECIPE_CLEAR:
+            return manager.recipeRunner().clear() ? BinaryResult::OK : BinaryResult::REJECTED;
+        case RECIPE_START:
+            return manager.recipeRunner().start() ? BinaryResult::OK : BinaryResult::REJECTED;
+        case RECIPE_PAUSE:
+            return manager.recipeRunner().pause() ? BinaryResult::OK : BinaryResult::REJECTED;
+        case RECIPE_RESUME:
+            return manager.recipeRunner().resume() ? BinaryResult::OK : BinaryResult::REJECTED;
+        case RECIPE_ABORT:
+            manager.recipeRunner().abort();
+            return BinaryResult::OK;
+        case RECIPE_STATUS: {
+            const RecipeRunner& runner = manager.recipeRunner();
+            const RecipeStatusPayload payload {
+                .state = static_cast<uint8_t>(runner.state()),
+                .step_count = static_cast<uint8_t>(runner.size()),
+                .position = static_cast<uint8_t>(runner.position()),
+            };
+            std::memcpy(reply, &payload, sizeof(payload));
+            reply_len = sizeof(payload);
+            return BinaryResult::OK;
+        }
+    }
+
+    return BinaryResult::UNKNOWN_OPCODE;
+}
+
+void procBinaryFrame(CtrlBoardManager& manager, const uint8_t* encoded, size_t len) {
+    std::array<uint8_t, BINARY_FRAME_MAX + 2> frame;
+    std::array<uint8_t, BINARY_FRAME_MAX> reply;
+    size_t reply_len = 0;
+
+    if (len > BINARY_WIRE_MAX) {
+        return;
+    }
+    const size_t frame_len = cobsDecode(encoded, len, frame.data());
+
+    // seq + opcode + crc16
+    BinaryResult result = BinaryResult::BAD_FRAME;
+    if (frame_len >= 4) {
+        const size_t body_len = frame_len - 2;
+        const uint16_t crc = frame[body_len] | (frame[body_len + 1] << 8);
+        if (crc == crc16(frame.data(), body_len)) {
+            result = execute(manager, static_cast<BinaryOpcode>(frame[1]),
+                             frame.data() + 2, body_len - 2,
+                             reply.data() + 3, reply_len);
+        }
+    }
+
+    reply[0] = (frame_len >= 1) ? frame[0] : 0;
+    reply[1] = (frame_len >= 2) ? static_cast<uint8_t>(frame[1] | 0x80) : 0x80;
+    reply[2] = static_cast<uint8_t>(result);
+    sendBinaryFrame(reply.data(), reply_len + 3);
+}
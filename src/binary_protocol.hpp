@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "ctrl_board_manager.hpp"
+
+// 二进制帧协议
+// 解码后帧格式：[seq][opcode][参数...][crc16低字节][crc16高字节]
+// 应答格式：    [seq][opcode | 0x80][结果][数据...][crc16低字节][crc16高字节]
+// 线上每帧经COBS编码，前后各有一个0x00分隔符；CRC16为CCITT-FALSE（多项式0x1021，初值0xFFFF）
+// 多字节数据均为小端序
+
+enum class BinaryOpcode : uint8_t {
+    PING = 0x01,
+    GET_STATUS = 0x02,
+    TELEMETRY_RATE = 0x03,  // ArgU16: 遥测频率(Hz)，0为关闭
+    TELEMETRY_DATA = 0x04,  // 仅用于板子主动发送：[遥测序号][0x84][OK][TelemetrySample]
+    TEXT_MODE = 0x0F,       // 切回文本协议
+
+    SP_MOVE_VOLUME = 0x10,  // ArgFloat: mL，负数为反向
+    SP_SET_SPEED = 0x11,    // ArgFloat: mL/s
+    SP_STOP = 0x12,
+    SP_FLOW = 0x13,         // ArgFlow: 恒流运行；只带ArgFloat时，恒流中改流速，否则无限制地启动
+
+    PP_MOVE_VOLUME = 0x20,  // ArgFloat: mL，负数为反向
+    PP_SET_SPEED = 0x21,    // ArgFloat: mL/s
+    PP_STOP = 0x22,
+    PP_FLOW = 0x23,         // 同SP_FLOW
+
+    CO_MOVE = 0x28,         // ArgCoordinated: 两泵联动，duration<=0时按设定速度
+    FLOW_STATUS = 0x29,     // 应答FlowStatusPayload
+
+    SV_CHANNEL = 0x30,      // ArgU8: 1~6，或ArgSwitchChannel指定总线上的第几台阀
+    SV_RESET = 0x31,        // 以下三条可带ArgU8: 阀下标（从0开始），省略为第一台
+    SV_CHECK = 0x32,
+    SV_STATUS = 0x33,
+
+    SOV_SET = 0x40,         // ArgU8: 通道1~8的位图，其余通道关闭
+    SOV_CHANNEL = 0x41,     // ArgSolenoidChannel
+    SOV_MASK = 0x42,        // ArgSolenoidMask: 同时开启/关闭多个通道，其余不变
+    SOV_TIMED = 0x43,       // ArgSolenoidTimed: 脉冲、占空比或错开序列
+
+    PV_SET_PRESSURE = 0x50, // ArgU16: kPa
+    PV_SET_MAX = 0x51,      // ArgU16: kPa
+    PV_RAMP = 0x52,         // ArgPressureRamp: 按形状在ms内过渡到目标压强
+    PV_LOOP = 0x53,         // ArgPressureLoop: 压强闭环开关与PID参数
+
+    LIGHT_SWITCH = 0x60,    // ArgU8: 0关1开
+    LIGHT_BRIGHTNESS = 0x61, // ArgU8: 0~255
+    LIGHT_FILL = 0x62,      // ArgLightFill: 区域设为指定颜色
+    LIGHT_PIXEL = 0x63,     // ArgLightPixel: 单个LED的颜色
+    LIGHT_ANIMATE = 0x64,   // ArgLightAnimation: 区域动画，type为0时停止动画
+
+    RECIPE_ADD = 0x70,      // ArgRecipeStep: 在配方末尾添加一步
+    RECIPE_CLEAR = 0x71,
+    RECIPE_START = 0x72,
+    RECIPE_PAUSE = 0x73,
+    RECIPE_RESUME = 0x74,
+    RECIPE_ABORT = 0x75,
+    RECIPE_STATUS = 0x76    // 应答RecipeStatusPayload
+};
+
+enum class BinaryResult : uint8_t {
+    OK = 0,
+    BAD_FRAME = 1,      // COBS解码失败、长度不足或CRC错误
+    UNKNOWN_OPCODE = 2,
+    BAD_ARGS = 3,       // 参数长度不符
+    REJECTED = 4        // 参数超出范围或设备忙
+};
+
+#pragma pack(push, 1)
+struct ArgFloat { float value; };
+struct ArgU8 { uint8_t value; };
+struct ArgU16 { uint16_t value; };
+struct ArgSolenoidChannel { uint8_t channel; uint8_t on; };
+struct ArgSwitchChannel { uint8_t channel; uint8_t valve; };  // valve为BOARD.switch_valve.valves的下标
+struct ArgSolenoidMask { uint32_t open_mask; uint32_t close_mask; };
+struct ArgSolenoidTimed { uint32_t mask; float on_ms; float off_ms; uint32_t cycles; float stagger_ms; float delay_ms; };
+struct ArgPressureRamp { uint16_t kpa; float ramp_ms; uint8_t shape; };  // shape为PressureRampShape
+struct ArgPressureLoop { uint8_t enabled; float kp; float ki; float kd; float kff; };
+struct ArgLightFill { uint64_t mask; uint8_t r; uint8_t g; uint8_t b; };
+struct ArgLightPixel { uint8_t index; uint8_t r; uint8_t g; uint8_t b; };
+struct ArgLightAnimation { uint8_t type; uint64_t mask; uint32_t on_ms; uint32_t off_ms; uint32_t cycles; };  // type为LedAnimationType
+struct ArgCoordinated { float syringe_volume; float peristaltic_volume; float duration; };
+struct ArgFlow { float rate; float volume; float seconds; };  // mL/s（负数反向）、mL、s，0为不限
+struct ArgRecipeStep { uint8_t op; float args[3]; };  // op为RecipeOp
+
+struct RecipeStatusPayload {
+    uint8_t state;      // RecipeState
+    uint8_t step_count;
+    uint8_t position;   // 下一个要执行的步骤（从0开始）
+};
+
+struct FlowStatusPayload {
+    uint8_t active_mask;        // bit i: 轴i恒流运行中
+    float syringe_volume;       // 本次已走的mL，未运行时为0
+    float syringe_total;        // 累计mL
+    float peristaltic_volume;
+    float peristaltic_total;
+};
+
+struct StatusPayload {
+    int32_t syringe_position;
+    int32_t peristaltic_position;
+    uint8_t motor_flags;        // bit i: 轴i运行中（bit0注射泵，bit1蠕动泵）
+    uint8_t switch_channel;
+    uint8_t solenoid_valve_status;  // 通道1~8
+    uint16_t cur_pressure;
+    uint16_t max_pressure;
+    uint8_t light_status;
+    uint8_t brightness;
+    uint32_t solenoid_mask;         // 全部通道，追加在末尾以兼容只读前面字段的上位机
+};
+#pragma pack(pop)
+
+// COBS编码后的最大长度（不含分隔符）
+constexpr size_t cobsMaxEncodedLen(size_t len) {
+    return len + len / 254 + 1;
+}
+// 线上一帧（含CRC）编码后的最大长度
+constexpr size_t BINARY_WIRE_MAX = cobsMaxEncodedLen(BINARY_FRAME_MAX + 2);
+static_assert(BINARY_WIRE_MAX + 2 <= LOG_RECORD_MAX, "二进制帧必须能放进一条输出记录");
+
+uint16_t crc16(const uint8_t* data, size_t len);
+size_t cobsEncode(const uint8_t* input, size_t len, uint8_t* output);
+size_t cobsDecode(const uint8_t* input, size_t len, uint8_t* output);
+
+void sendBinaryFrame(const uint8_t* frame, size_t len);
+void procBinaryFrame(CtrlBoardManager& manager, const uint8_t* encoded, size_t len);
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 编译期板型描述：有哪些外设、接在哪些引脚/地址上、泵的运动学参数
+// 在build_flags中定义BOARD_XXX选择板型（见platformio.ini中的各个env），不定义时为BOARD_CTRL_V1
+// 外设b_present为false时，对应的初始化、周期任务、指令和缓冲区都在编译期去除
+
+// 步进轴描述：引脚、运动学与限制，下标为StepAxisId
+struct AxisDescriptor {
+    std::string_view verb;          // 文本指令动词，如 sp
+    std::string_view name;          // 回复中的设备名
+    std::string_view unit;          // -f/-b的位移单位
+    std::string_view move_word;     // 回复中的动作，如 移动、转动
+    uint8_t step_pin;
+    uint8_t dir_pin;
+    float microsteps_per_rev;       // 电机每转微步数
+    float microsteps_per_unit;      // 每单位位移（unit）的微步数
+    float microsteps_per_ml;        // 每mL液体的微步数
+    float default_speed;            // 上电时的速度，微步/s
+    float max_speed;                // 微步/s，-v、微调快速和联动的上限
+    float max_volume_speed;         // mL/s，-sv的上限
+    float finetune_slow;            // 微调慢速，微步/s
+    float acceleration;             // 默认加速度，微步/s²
+    float jerk;                     // 默认加加速度，微步/s³
+};
+
+// 74HC595电磁阀链，由SPI外设驱动：DS接MOSI，SHCP接SCLK，STCP作为片选
+struct SolenoidConfig {
+    bool b_present;
+    uint8_t ds_pin;
+    uint8_t shcp_pin;
+    uint8_t stcp_pin;
+    // 级联的74HC595数量（前一片的QH'接后一片的DS），通道1~8在直接连DS引脚的一片上，最多4片即32通道
+    size_t chips;
+};
+
+// 485总线上的一台切换阀
+struct SwitchValveDescriptor {
+    std::string_view name;  // 回复中的设备名
+    uint8_t address;        // 帧的第2字节，由阀上的拨码设定
+    uint8_t priority;       // 总线调度优先级，越大越优先
+};
+
+constexpr size_t SWITCH_VALVE_MAX = 4;
+
+// 485切换阀：所有阀挂在同一条485总线（Serial1）上，按地址区分
+struct SwitchValveConfig {
+    bool b_present;
+    uint8_t rx_pin;
+    uint8_t tx_pin;
+    uint32_t baud;
+    size_t count;
+    std::array<SwitchValveDescriptor, SWITCH_VALVE_MAX> valves;     // 前count项有效，第一台为sv的默认目标
+};
+
+// 比例阀DAC（MCP4725）
+struct DacConfig {
+    bool b_present;
+    uint8_t address;    // A0接地为0x60，接VCC为0x61
+    uint8_t sda_pin;
+    uint8_t scl_pin;
+};
+
+// 压强传感器：比例输出，经分压接入ADC1，只用于比例阀闭环
+struct PressureSensorConfig {
+    bool b_present;
+    uint8_t pin;
+    float zero_mv;      // 0 kPa
+    float full_mv;      // 满量程
+    float full_kpa;
+};
+
+// WS2812阵列，编号按行排列
+struct LedConfig {
+    bool b_present;
+    uint8_t pin;
+    size_t count;
+    size_t cols;        // 每行LED数
+};
+
+template <size_t AXES>
+struct BoardConfig {
+    std::string_view name;
+    uint8_t motor_en_pin;   // 所有电机驱动器共用的使能
+    std::array<AxisDescriptor, AXES> axes;
+    SolenoidConfig solenoid;
+    SwitchValveConfig switch_valve;
+    DacConfig dac;
+    PressureSensorConfig pressure_sensor;
+    LedConfig led;
+};
+
+// 泵的运动学参数
+constexpr float SCREW_PITCH = 0.8; // M5螺纹，螺距0.8mm/转
+constexpr int STEPS_PER_REV = 200;  // 电机步数/转
+constexpr int MICROSTEPS_1 = 64; // 电机1微步数为64
+constexpr int MICROSTEPS_2 = 8; // 电机2微步数为8
+constexpr float V2D_RATIO = 3.51; // 1mL液体->运动3.51mm
+constexpr float V2R_RATIO = 9.524; // 1转 -> 0.1873mL => 1mL -> 5.339转 // 50r->5.25ml
+// 注射泵微调，快速：0.5mL/s，慢速：0.05mL/s; 快速顺便用作最大限制速度
+constexpr float SYRINGE_MAXIMUM_SPEED = 0.5;
+// 蠕动泵最快速度设置为0.5mL/s，等效0.5*9.524*8*200=7619.2微步/s
+constexpr float PERISTALTIC_MAXIMUM_SPEED = 0.5;
+// 每mL液体对应的微步数
+constexpr float SYRINGE_MICROSTEPS_PER_ML = V2D_RATIO / SCREW_PITCH * STEPS_PER_REV * MICROSTEPS_1;
+constexpr float PERISTALTIC_MICROSTEPS_PER_ML = V2R_RATIO * STEPS_PER_REV * MICROSTEPS_2;
+
+// 注射泵：丝杆推动，位移单位mm
+constexpr AxisDescriptor syringePump(uint8_t step_pin, uint8_t dir_pin) {
+    return {
+        .verb = "sp",
+        .name = "注射泵",
+        .unit = "mm",
+        .move_word = "移动",
+        .step_pin = step_pin,
+        .dir_pin = dir_pin,
+        .microsteps_per_rev = STEPS_PER_REV * MICROSTEPS_1,
+        .microsteps_per_unit = STEPS_PER_REV * MICROSTEPS_1 / SCREW_PITCH,
+        .microsteps_per_ml = SYRINGE_MICROSTEPS_PER_ML,
+        .default_speed = 3200, // 等效速度0.2mm/s -> 0.057mL/s
+        .max_speed = SYRINGE_MAXIMUM_SPEED * SYRINGE_MICROSTEPS_PER_ML,
+        .max_volume_speed = SYRINGE_MAXIMUM_SPEED,
+        .finetune_slow = 0.05 * SYRINGE_MICROSTEPS_PER_ML,
+        .acceleration = 200000, // WTF?
+        // 加加速度取值使满速时加速度段和加加速度段的时长相当（约0.2~0.3s）
+        .jerk = 4000000,
+    };
+}
+
+// 蠕动泵：位移单位为转，同一型号可以接多台，verb和name区分
+constexpr AxisDescriptor peristalticPump(std::string_view verb, std::string_view name,
+                                         uint8_t step_pin, uint8_t dir_pin) {
+    return {
+        .verb = verb,
+        .name = name,
+        .unit = "转",
+        .move_word = "转动",
+        .step_pin = step_pin,
+        .dir_pin = dir_pin,
+        .microsteps_per_rev = STEPS_PER_REV * MICROSTEPS_2,
+        .microsteps_per_unit = STEPS_PER_REV * MICROSTEPS_2,
+        .microsteps_per_ml = PERISTALTIC_MICROSTEPS_PER_ML,
+        .default_speed = 800, // 等效蠕动泵0.5转/s
+        .max_speed = PERISTALTIC_MAXIMUM_SPEED * PERISTALTIC_MICROSTEPS_PER_ML,
+        .max_volume_speed = PERISTALTIC_MAXIMUM_SPEED,
+        .finetune_slow = 0.05 * PERISTALTIC_MICROSTEPS_PER_ML,
+        .acceleration = 40000, // WTF?
+        .jerk = 500000,
+    };
+}
+
+// 主控板V1：注射泵(motor1)、蠕动泵(motor2)、切换阀、8路电磁阀、比例阀（第二组DAC）、压强传感器、8x8灯板
+inline constexpr BoardConfig<2> CTRL_V1_BOARD {
+    .name = "ctrl-v1",
+    .motor_en_pin = 7,
+    .axes = {{
+        syringePump(8, 9),
+        peristalticPump("pp", "蠕动泵", 10, 11),
+    }},
+    .solenoid = {.b_present = true, .ds_pin = 4, .shcp_pin = 5, .stcp_pin = 6, .chips = 1},
+    .switch_valve = {
+        .b_present = true, .rx_pin = 2, .tx_pin = 1, .baud = 9600, .count = 1,
+        .valves = {{{.name = "切换阀", .address = 0, .priority = 0}}},
+    },
+    .dac = {.b_present = true, .address = 0x61, .sda_pin = 15, .scl_pin = 16},
+    .pressure_sensor = {.b_present = true, .pin = 3, .zero_mv = 330, .full_mv = 2970, .full_kpa = 500},
+    .led = {.b_present = true, .pin = 21, .count = 64, .cols = 8},
+};
+
+// 主控板V1，motor3接第二台蠕动泵，电磁阀扩展为两片74HC595共16路，485总线上挂两台切换阀（地址0和1）
+inline constexpr BoardConfig<3> CTRL_V1_3PUMP_BOARD {
+    .name = "ctrl-v1-3pump",
+    .motor_en_pin = 7,
+    .axes = {{
+        syringePump(8, 9),
+        peristalticPump("pp", "蠕动泵", 10, 11),
+        peristalticPump("pp2", "蠕动泵2", 12, 13),
+    }},
+    .solenoid = {.b_present = true, .ds_pin = 4, .shcp_pin = 5, .stcp_pin = 6, .chips = 2},
+    .switch_valve = {
+        .b_present = true, .rx_pin = 2, .tx_pin = 1, .baud = 9600, .count = 2,
+        .valves = {{
+            {.name = "切换阀", .address = 0, .priority = 0},
+            {.name = "切换阀2", .address = 1, .priority = 0},
+        }},
+    },
+    .dac = {.b_present = true, .address = 0x61, .sda_pin = 15, .scl_pin = 16},
+    .pressure_sensor = {.b_present = true, .pin = 3, .zero_mv = 330, .full_mv = 2970, .full_kpa = 500},
+    .led = {.b_present = true, .pin = 21, .count = 64, .cols = 8},
+};
+
+// 简化板：两台泵、切换阀和开环比例阀（第一组DAC），不装电磁阀、压强传感器和灯板
+inline constexpr BoardConfig<2> PUMP_ONLY_BOARD {
+    .name = "pump-only",
+    .motor_en_pin = 7,
+    .axes = {{
+        syringePump(8, 9),
+        peristalticPump("pp", "蠕动泵", 10, 11),
+    }},
+    .solenoid = {.b_present = false, .ds_pin = 0, .shcp_pin = 0, .stcp_pin = 0, .chips = 0},
+    .switch_valve = {
+        .b_present = true, .rx_pin = 2, .tx_pin = 1, .baud = 9600, .count = 1,
+        .valves = {{{.name = "切换阀", .address = 0, .priority = 0}}},
+    },
+    .dac = {.b_present = true, .address = 0x60, .sda_pin = 15, .scl_pin = 16},
+    .pressure_sensor = {.b_present = false, .pin = 0, .zero_mv = 0, .full_mv = 1, .full_kpa = 1},
+    .led = {.b_present = false, .pin = 0, .count = 0, .cols = 1},
+};
+
+#if defined(BOARD_CTRL_V1_3PUMP)
+inline constexpr auto BOARD = CTRL_V1_3PUMP_BOARD;
+#elif defined(BOARD_PUMP_ONLY)
+inline constexpr auto BOARD = PUMP_ONLY_BOARD;
+#else
+inline constexpr auto BOARD = CTRL_V1_BOARD;
+#endif
+
+static_assert(BOARD.axes.size() >= 2, "注射泵和蠕动泵固定为轴0和轴1，二进制协议与配方按此寻址");
+static_assert(!BOARD.solenoid.b_present || (BOARD.solenoid.chips >= 1 && BOARD.solenoid.chips <= 4),
+              "电磁阀位图为32位，最多级联4片74HC595");
+static_assert(!BOARD.switch_valve.b_present || (BOARD.switch_valve.count >= 1 && BOARD.switch_valve.count <= SWITCH_VALVE_MAX),
+              "切换阀数量应在1~SWITCH_VALVE_MAX之间");
+static_assert(!BOARD.pressure_sensor.b_present || BOARD.dac.b_present, "压强传感器只用于比例阀闭环");
+static_assert(!BOARD.led.b_present || (BOARD.led.count <= 64 && BOARD.led.cols > 0), "LED区域位图为64位");
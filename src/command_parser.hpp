@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+// 一条指令最多的token数量，目前最长的是 "rc -add co 1 -2 20"
+constexpr size_t MAX_COMMAND_TOKENS = 6;
+
+// 定长token表，只保存指向原始指令的string_view，不分配堆内存
+struct CommandTokens {
+    std::array<std::string_view, MAX_COMMAND_TOKENS> items{};
+    size_t count = 0;
+    bool overflow = false; // token数量超过MAX_COMMAND_TOKENS
+
+    constexpr std::string_view operator[](size_t i) const { return items[i]; }
+    constexpr size_t size() const { return count; }
+};
+
+// 以空格分割指令，连续空格视为一个分隔符
+constexpr CommandTokens tokenizeCommand(std::string_view line) {
+    CommandTokens tokens;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        while (pos < line.size() && line[pos] == ' ') pos++;
+        if (pos == line.size()) break;
+
+        const size_t end = line.find(' ', pos);
+        const size_t len = (end == std::string_view::npos) ? line.size() - pos : end - pos;
+        if (tokens.count == MAX_COMMAND_TOKENS) {
+            tokens.overflow = true;
+            break;
+        }
+        tokens.items[tokens.count++] = line.substr(pos, len);
+        pos += len;
+    }
+    return tokens;
+}
+
+// 用from_chars解析数字，必须整个token都是合法数字，失败时返回false而不是抛异常
+template <typename T>
+bool parseNumber(std::string_view sv, T& value) {
+    const char* first = sv.data();
+    const char* last = first + sv.size();
+    const auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc() && ptr == last;
+}
+
+// 按指定进制解析无符号整数，例如二进制/十六进制的位图参数
+template <typename T>
+bool parseNumber(std::string_view sv, T& value, int base) {
+    const char* first = sv.data();
+    const char* last = first + sv.size();
+    const auto [ptr, ec] = std::from_chars(first, last, value, base);
+    return ec == std::errc() && ptr == last;
+}
+
+// 参数分派表项：flag与token总数（含动词）都匹配时调用handler
+template <typename Owner>
+struct FlagEntry {
+    std::string_view flag;
+    size_t token_count;
+    bool (*handler)(Owner& owner, const CommandTokens& tokens);
+};
+
+template <typename Owner, size_t N>
+bool dispatchFlag(const std::array<FlagEntry<Owner>, N>& table, Owner& owner, const CommandTokens& tokens) {
+    if (tokens.size() < 2) return false;
+    for (const auto& entry : table) {
+        if (entry.token_count == tokens.size() && entry.flag == tokens[1]) {
+            return entry.handler(owner, tokens);
+        }
+    }
+    return false;
+}
@@ -1,77 +1,149 @@
 #pragma once
-#include <Arduino.h>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include "board_config.hpp"
 
-// 引脚定义
-// 注射泵(motor1)
-constexpr uint8_t STEP_PIN = 8;
-constexpr uint8_t DIR_PIN = 9;
-constexpr uint8_t EN_PIN = 7;
-
-// 蠕动泵(motor2)
-constexpr uint8_t P_STEP = 10;
-constexpr uint8_t P_DIR = 11;
-
-// motor3
-// constexpr uint8_t STEP = 12;
-// constexpr uint8_t DIR = 13;
-
-// 连接切换阀的UART1
-constexpr uint8_t RX_485 = 2;
-constexpr uint8_t TX_485 = 1;
-
-// 第二组74HC595
-// constexpr uint8_t DS 14;
-// constexpr uint8_t SHCP 42;
-// constexpr uint8_t STCP 41;
-
-// 第一组74HC595
-constexpr uint8_t DS = 4;
-constexpr uint8_t SHCP = 5;
-constexpr uint8_t STCP = 6;
-
-// 第一组DAC
-// constexpr uint8_t DAC_ADDR  = 0x60;
-// constexpr uint8_t SDA       = 15;
-// constexpr uint8_t SCL       = 16;
-
-// 第二组DAC
-constexpr uint8_t DAC_ADDR = 0x61;
-constexpr uint8_t SDA_PIN = 15;
-constexpr uint8_t SCL_PIN = 16;
-// constexpr uint8_t SDA      = 17;
-// constexpr uint8_t SCL      = 18;
-
-// WS2812阵列数据
-constexpr uint8_t WS_IN = 21;
-
-// 运动参数
-constexpr float SCREW_PITCH = 0.8; // M5螺纹，螺距0.8mm/转
-constexpr int STEPS_PER_REV = 200;  // 电机步数/转
-constexpr int MICROSTEPS_1 = 64; // 电机1微步数为64
-constexpr int MICROSTEPS_2 = 8; // 电机2微步数为8
-constexpr float V2D_RATIO = 3.51; // 1mL液体->运动3.51mm
-constexpr float V2R_RATIO = 9.524; // 1转 -> 0.1873mL => 1mL -> 5.339转 // 50r->5.25ml
-// 注射泵微调，快速：0.5mL/s，慢速：0.05mL/s; 快速顺便用作最大限制速度
-constexpr float SYRINGE_MAXIMUM_SPEED = 0.5;
-constexpr float FINETUNE_FAST = SYRINGE_MAXIMUM_SPEED * V2D_RATIO / SCREW_PITCH * STEPS_PER_REV * MICROSTEPS_1;
-constexpr float FINETUNE_SLOW = 0.05 * V2D_RATIO / SCREW_PITCH * STEPS_PER_REV * MICROSTEPS_1;
-// 蠕动泵最快速度设置为0.5mL/s，等效0.5*9.524*8*200=7619.2微步/s
-constexpr float PERISTALTIC_MAXIMUM_SPEED = 0.5;
-constexpr float PERISTALTIC_MAXIMUM_MICROSTEP = PERISTALTIC_MAXIMUM_SPEED * V2R_RATIO *STEPS_PER_REV *MICROSTEPS_2;
+// 引脚、地址与泵的运动学参数按板型定义，见board_config.hpp
+
+// 电磁阀通道数，无电磁阀的板型为0
+constexpr size_t SOLENOID_CHIPS = BOARD.solenoid.b_present ? BOARD.solenoid.chips : 0;
+constexpr size_t SOLENOID_CHANNELS = SOLENOID_CHIPS * 8;
+constexpr uint32_t SOLENOID_MASK_ALL = (SOLENOID_CHANNELS == 32) ? UINT32_MAX : ((1UL << SOLENOID_CHANNELS) - 1);
+// 移位时钟，74HC595在3.3V下可到20MHz以上，留出走线余量
+constexpr uint32_t SOLENOID_SPI_FREQ = 10000000;
+// 电磁阀定时（脉冲、占空比、错开序列）的时长范围，单位ms
+// 下限取决于闹钟任务的调度延迟；上限保证32个通道错开后仍在micros()的回绕范围内
+constexpr float SOLENOID_TIMING_MIN_MS = 0.1f;
+constexpr float SOLENOID_TIMING_MAX_MS = 60000;
+constexpr size_t SOLENOID_QUEUE_LEN = 16;
+
+// MCP4725：I2C快速模式，每个数值只发2字节的fast write指令（加地址共3字节，约70us）
+constexpr uint32_t DAC_I2C_FREQ = 400000;
+// 压强斜坡、波形与闭环控制的更新频率
+constexpr uint32_t DAC_UPDATE_FREQ = 2000;
+constexpr size_t DAC_QUEUE_LEN = 8;
+// 斜坡时长上限（ms）与上传波形的最大点数
+constexpr float PRESSURE_RAMP_MAX_MS = 600000;
+constexpr size_t PRESSURE_WAVE_MAX = BOARD.dac.b_present ? 256 : 0;
+
+// 压强传感器：0.5~4.5V比例输出，经分压接入ADC1，引脚与标定见board_config.hpp
+// 读数超出零点到满量程之外这么多时视为断线或损坏，闭环退回开环输出
+constexpr float PRESSURE_SENSOR_FAULT_MV = 150;
+
+// 压强闭环默认参数，设定值、测量值与输出都以最大压强归一化到0~1
+// kff为前馈（开环换算）的权重，ki单位为1/s，kd单位为s
+constexpr float PRESSURE_PID_KP = 2.0f;
+constexpr float PRESSURE_PID_KI = 12.0f;
+constexpr float PRESSURE_PID_KD = 0.0f;
+constexpr float PRESSURE_PID_KFF = 1.0f;
+// 微分项一阶低通的时间常数（s），抑制ADC噪声
+constexpr float PRESSURE_PID_D_FILTER_S = 0.005f;
+// 设定值单次跳变超过该比例时开始统计阶跃响应，误差进入±PRESSURE_SETTLE_BAND（相对阶跃幅度）视为稳定
+constexpr float PRESSURE_STEP_MIN = 0.01f;
+constexpr float PRESSURE_SETTLE_BAND = 0.02f;
+
+// 性能统计开关，可在build_flags中用-DINSTRUMENTATION=0关闭，关闭后统计代码不参与编译
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION 1
+#endif
+constexpr bool INSTRUMENTATION_ENABLED = INSTRUMENTATION;
+// 主机构建中模拟的CPU主频，用于把虚拟时钟换算为周期数
+constexpr uint32_t HOST_CPU_MHZ = 240;
+
+// 闹钟数量上限（电磁阀调度、压强输出）
+constexpr size_t HAL_ALARM_COUNT = 4;
+
+// 步进引擎定时器：10MHz计数，每12.5us触发一次中断(80kHz)，步进抖动不超过一个tick
+// 一步至少占两个tick（高/低电平各一个），单轴最高40k微步/s，各轴max_speed在axis_registry.hpp中检查
+constexpr uint32_t STEP_TIMER_FREQ = 10000000;
+constexpr uint32_t STEP_TICK_FREQ = 80000;
+static_assert(STEP_TIMER_FREQ % STEP_TICK_FREQ == 0, "STEP_TICK_FREQ必须整除STEP_TIMER_FREQ");
+
+// 各轴 -a、-j 可设置的上限
+constexpr float ACCELERATION_LIMIT = 2000000;
+constexpr float JERK_LIMIT = 100000000;
+// 恒流运行的时限上限（s）
+constexpr float FLOW_TIME_LIMIT_MAX_S = 86400;
 
 // 485模块指令长度，默认为8byte
 constexpr int INSTR_485_LEN = 8;
+// 485总线最多挂接的设备数、每台设备的事务队列长度与默认响应超时（切换阀一般1s内响应）
+constexpr size_t RS485_MAX_DEVICES = 4;
+constexpr size_t RS485_DEVICE_QUEUE_LEN = 4;
+constexpr uint32_t RS485_TIMEOUT_MS = 1000;
+// 连续超时多少次视为离线，离线设备让出总线，收到应答后恢复
+constexpr uint32_t RS485_OFFLINE_AFTER = 3;
+// 切换阀通道数，以及缓存的通道/状态在多久内可以直接回答查询
+constexpr int SWITCH_CHANNEL_COUNT = 6;
+constexpr uint32_t SWITCH_CACHE_TTL_MS = 5000;
+// 当前板型485总线上的切换阀数量
+constexpr size_t SWITCH_VALVE_COUNT = BOARD.switch_valve.b_present ? BOARD.switch_valve.count : 0;
+static_assert(SWITCH_VALVE_COUNT <= RS485_MAX_DEVICES, "切换阀数量超过485总线设备数");
+
+// 上位机串口接收环形缓冲区（必须是2的幂）与文本指令最大长度
+constexpr size_t HOST_RX_BUFFER_LEN = 1024;
+constexpr size_t COMMAND_LINE_MAX = 128;
+
+// 上位机输出队列：环形缓冲区字节数（必须是2的幂）、单条记录最大长度，
+// 以及入队后超过多久才开始发送记为延迟
+constexpr size_t LOG_BUFFER_LEN = 4096;
+constexpr size_t LOG_LINE_MAX = 256;
+constexpr size_t LOG_RECORD_MAX = LOG_LINE_MAX;
+constexpr uint32_t LOG_DELAY_MS = 100;
+static_assert((LOG_BUFFER_LEN & (LOG_BUFFER_LEN - 1)) == 0, "LOG_BUFFER_LEN必须是2的幂");
+
+// 二进制协议单帧最大长度（解码后，不含CRC）
+constexpr size_t BINARY_FRAME_MAX = 64;
+
+// 遥测：采样缓冲区容量（必须是2的幂）与最高采样率(Hz)
+constexpr size_t TELEMETRY_BUFFER_LEN = 16;
+constexpr uint16_t TELEMETRY_MAX_RATE = 100;
+
+// 双核任务划分：运动与阀门执行在核心1（与步进中断、电磁阀调度闹钟同核），指令解析、日志与总线I/O在核心0
+// 压强输出的闹钟由esp_timer在核心0回调，其I2C读写不会推迟阀门切换
+constexpr int MOTION_CORE = 1;
+constexpr int COMMAND_CORE = 0;
+constexpr unsigned MOTION_TASK_PRIORITY = 5;
+constexpr unsigned COMMAND_TASK_PRIORITY = 2;
+// 固定核心的闹钟任务，高于运动任务，回调到期时立即抢占
+constexpr unsigned ALARM_TASK_PRIORITY = 20;
+constexpr uint32_t MOTION_TASK_STACK = 4096;
+constexpr uint32_t COMMAND_TASK_STACK = 16384;
+constexpr uint32_t ALARM_TASK_STACK = 4096;
+// 核间队列容量（必须是2的幂）
+constexpr size_t MOTION_QUEUE_LEN = 32;
+constexpr size_t EVENT_QUEUE_LEN = 16;
+
+// 配方最多步骤数与循环嵌套深度
+constexpr size_t RECIPE_MAX_STEPS = 64;
+constexpr size_t RECIPE_LOOP_DEPTH = 4;
+// 单个wait步骤与单层循环次数的上限
+constexpr float RECIPE_WAIT_MAX_MS = 86400000;
+constexpr float RECIPE_LOOP_MAX = 1000000;
 
-constexpr long INTERVAL = 50; // 间隔时间(毫秒)
-constexpr int NUM_LEDS = 64; // WS2812 LED数量
-// LED中心4*4阵列编号
-constexpr auto LED_ARR = []() {
-    std::array<int, 16> arr{};
-    for(int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            arr[i * 4 + j] = (i + 2) * 8 + (j + 2);
+constexpr long INTERVAL = 50; // 间隔时间(毫秒)，主机构建中每条输入指令之后推进的虚拟时间
+// WS2812 LED数量与每行LED数，编号按行排列；无灯板的板型为0
+constexpr int NUM_LEDS = BOARD.led.b_present ? static_cast<int>(BOARD.led.count) : 0;
+constexpr int LED_COLS = static_cast<int>(BOARD.led.cols);
+// LED区域位图，bit i对应编号i的LED
+using LedMask = uint64_t;
+constexpr LedMask LED_MASK_ALL = (NUM_LEDS == 64) ? UINT64_MAX : ((1ULL << NUM_LEDS) - 1);
+// 以(x, y)为左上角、w*h的矩形区域
+constexpr LedMask ledRect(int x, int y, int w, int h) {
+    LedMask mask = 0;
+    for (int row = y; row < y + h; row++) {
+        for (int col = x; col < x + w; col++) {
+            if (row >= 0 && col >= 0 && col < LED_COLS && row * LED_COLS + col < NUM_LEDS) {
+                mask |= 1ULL << (row * LED_COLS + col);
+            }
         }
     }
-    return arr;
-};
\ No newline at end of file
+    return mask;
+}
+// 中心4*4区域，开机时的默认照明图案
+constexpr LedMask LED_CENTER_MASK = ledRect(2, 2, 4, 4);
+// 连续变化的动画（呼吸）的帧间隔；闪烁、跑马等离散变化在变化时立即发送
+constexpr uint32_t LED_FRAME_MS = 20;
+// 动画单段时长上限：闪烁周期on_ms + off_ms与呼吸亮度on_ms * 255都不会溢出uint32
+constexpr uint32_t LED_ANIMATION_MAX_MS = 3600000;
\ No newline at end of file
@@ -1,32 +1,53 @@
 #include "ctrl_board_manager.hpp"
 
-#include "FastLED.h"
+#include "command_parser.hpp"
 #include "constants.hpp"
-#include "esp32-hal-gpio.h"
+#include "hal.hpp"
+#include "host_log.hpp"
+#include "instrumentation.hpp"
 #include "misc.hpp"
 #include "types.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <format>
-#include <ranges>
 #include <string>
 #include <string_view>
-#include <vector>
-#include "Wire.h"
+#include <utility>
 
-CtrlBoardManager::CtrlBoardManager(AccelStepper* sp, AccelStepper* pp) {
-    stepper = sp;
-    stepper_pp = pp;
+// 当前板型没有该外设，对应指令在编译期被去除
+static void printAbsent(std::string_view name) {
+    std::string msg_str = std::format("当前板型（{}）没有{}\n", BOARD.name, name);
+    hostLog().at(LogLevel::WARN).print(msg_str);
+}
 
-    // 配置步进电机参数
-    // 这些参数目前都是随手填的，需要规范化
-    syringe_speed = 3200; // 等效速度0.2mm/s -> 0.057mL/s
-    syringe_status = false;
+// 按板型描述在总线上依次注册各切换阀
+template <size_t... I>
+static std::array<SwitchValve, sizeof...(I)> makeSwitchValves(Rs485Bus& bus, std::index_sequence<I...>) {
+    return {SwitchValve(bus, BOARD.switch_valve.valves[I])...};
+}
 
-    peristaltic_speed = 800; // 等效蠕动泵0.5转/s
-    peristaltic_status = false;
+CtrlBoardManager::CtrlBoardManager(StepEngine& step_engine)
+    : engine(step_engine), switch_bus(hal::rs485Serial()),
+      switch_valves(makeSwitchValves(switch_bus, std::make_index_sequence<SWITCH_VALVE_COUNT>{})),
+      pressure_sensor(BOARD.pressure_sensor.pin, BOARD.pressure_sensor.zero_mv, BOARD.pressure_sensor.full_mv,
+                      BOARD.pressure_sensor.full_kpa),
+      host_rx(hal::hostSerial()), recipe(*this), telemetry(*this) {
+    // 配置步进电机参数，初值见AXIS_REGISTRY
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        axis_settings[i] = {
+            .speed = AXIS_REGISTRY[i].default_speed,
+            .acceleration = AXIS_REGISTRY[i].acceleration,
+            .jerk = AXIS_REGISTRY[i].jerk,
+        };
+    }
+    running_axes = 0;
+    velocity_axes = 0;
+    flows.fill({});
+    flow_total_steps.fill(0);
 
-    switch_channel = 0;
+    motion_posted = 0;
+    motion_executed = 0;
 
     // 电磁阀状态：默认全关闭
     solenoid_valve_status = 0;
@@ -34,10 +55,10 @@ CtrlBoardManager::CtrlBoardManager(AccelStepper* sp, AccelStepper* pp) {
     // 比例阀
     max_pressure = 100;
     cur_pressure = 0;
+    pressure_wave_len = 0;
+    pressure_loop.full_scale_kpa = static_cast<float>(max_pressure);
 
-    // 光源初始化
-    brightness = 200;
-    light_status = false;
+    host_protocol = HostProtocol::TEXT;
 }
 
 CtrlBoardManager::~CtrlBoardManager() {
@@ -46,532 +67,1607 @@ CtrlBoardManager::~CtrlBoardManager() {
 
 void CtrlBoardManager::init() {
     // 与上位机通信
-    Serial.begin(115200);
+    hal::hostSerial().begin(115200);
+    host_rx.begin();
     // 连接485模块
-    Serial1.begin(9600, SERIAL_8N1, RX_485, TX_485);
+    if constexpr (BOARD.switch_valve.b_present) {
+        hal::rs485Serial().begin(BOARD.switch_valve.baud, BOARD.switch_valve.rx_pin, BOARD.switch_valve.tx_pin);
+    }
 
-    pinMode(EN_PIN, OUTPUT);
-    digitalWrite(EN_PIN, HIGH);  // 启用3个电机驱动器
+    hal::gpioOutput(BOARD.motor_en_pin);
+    hal::gpioWrite(BOARD.motor_en_pin, true);  // 启用所有电机驱动器
 
-    // 74HC595
-    pinMode(DS, OUTPUT);
-    pinMode(SHCP, OUTPUT);
-    pinMode(STCP, OUTPUT);
+    if constexpr (BOARD.solenoid.b_present) {
+        // 74HC595链
+        hal::shiftChainBegin(BOARD.solenoid.ds_pin, BOARD.solenoid.shcp_pin, BOARD.solenoid.stcp_pin,
+                             SOLENOID_SPI_FREQ);
 
-    // 电磁阀初始化
-    transmit595(solenoid_valve_status);
+        // 电磁阀初始化（任务启动前单线程运行，可直接输出）
+        valves.begin();
+    }
 
-    // DAC2 (比例阀)
-    Wire.begin(SDA_PIN, SCL_PIN);
-    updatePressure();
+    if constexpr (BOARD.dac.b_present) {
+        // 比例阀DAC，没有传感器时只能开环
+        if constexpr (BOARD.pressure_sensor.b_present) {
+            pressure_sensor.begin();
+        }
+        pressure_out.begin(pressureCode(cur_pressure), pressure_sensor);
+        postPressureLoop();
+    }
 
     // 旋转阀初始化
-    procSwitchData(SwitchReset{});
+    for (auto& valve : switch_valves) {
+        valve.request(SwitchReset{});
+    }
 
-    // 电机初始化速度和加速度
-    if (stepper) {
-        stepper->setMaxSpeed(syringe_speed);
-        stepper->setAcceleration(200000); // WTF?
-        stepper->setCurrentPosition(0);
+    // 电机初始化速度、加速度和加加速度
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        const StepAxisId axis = static_cast<StepAxisId>(i);
+        engine.setAcceleration(axis, axis_settings[i].acceleration);
+        engine.setJerk(axis, axis_settings[i].jerk);
+        engine.setMaxSpeed(axis, axis_settings[i].speed);
+        engine.setCurrentPosition(axis, 0);
     }
 
-    if (stepper_pp) {
-        stepper_pp->setMaxSpeed(peristaltic_speed);
-        stepper_pp->setAcceleration(40000); // WTF?
-        stepper_pp->setCurrentPosition(0);
+    // 参数就绪后再启动步进中断
+    // 中断分配在调用核心上，init()需在运动核心（MOTION_CORE）上调用
+    engine.begin();
+
+    // LED 初始图案：中心4x4为白，其余为黑，开启光源前不发送
+    if constexpr (BOARD.led.b_present) {
+        light.begin();
     }
+}
 
-    // LED 初始色彩设置：中心4x4为白，其余为黑
-    FastLED.addLeds<WS2812B, WS_IN, GRB>(leds.data(), NUM_LEDS);
-    fill_solid(&(leds[0]), NUM_LEDS, CRGB::Black);
-    for (auto i : LED_ARR()) {
-        leds[i] = CRGB::White;
+void CtrlBoardManager::setAxisSpeed(StepAxisId axis, float speed, bool b_volume_speed) {
+    // 流速换算：电机速度(微步/s) = 流速（mL/s) * 每mL微步数
+    // 注射泵微步数64下，速度最好不要超过0.5mL/s
+    axis_settings[axis].speed = b_volume_speed ? speed * AXIS_REGISTRY[axis].microsteps_per_ml : speed;
+    postMotion({MotionOp::SET_MAX_SPEED, axis, 0, axis_settings[axis].speed});    // 最大速度（步/秒）
+    // 恒流运行中，新速度同时作为流速平滑生效
+    if (flows[axis].b_active && !flows[axis].b_stopping) {
+        const float rate = axis_settings[axis].speed / AXIS_REGISTRY[axis].microsteps_per_ml;
+        setFlowRate(axis, flows[axis].rate < 0 ? -rate : rate);
     }
 }
 
-void CtrlBoardManager::setSyringeSpeed(float speed, bool b_volume_speed) {
-    if (b_volume_speed) {
-        // 设置流体速度
-        // 电机速度(微步/s) = 流速（mL/s) * 比例（mm/mL）/ 螺距(mm/转) * 微步数 * 每转步数
-        // 微步数64下，速度最好不要超过0.5mL/s
-        syringe_speed = speed * V2D_RATIO / SCREW_PITCH * MICROSTEPS_1 * STEPS_PER_REV;
-    } else {
-        syringe_speed = speed;
+void CtrlBoardManager::moveAxis(StepAxisId axis, float distance) {
+    const long target = distance * AXIS_REGISTRY[axis].microsteps_per_unit;
+    postMotion({MotionOp::MOVE, axis, target, 0});
+}
+
+void CtrlBoardManager::moveAxisVolume(StepAxisId axis, float volume) {
+    const long target = volume * AXIS_REGISTRY[axis].microsteps_per_ml;
+    postMotion({MotionOp::MOVE, axis, target, 0});
+}
+
+void CtrlBoardManager::finetuneAxis(StepAxisId axis, FinetuneType type) {
+    // 微调
+    // 0,1,2,3分别表示快进，慢进，慢退，快退
+    // 以微调速度恒速运行直到stopAxis，最多走30mL作为保护
+    // 速度直接随指令下发，不覆盖用户用setAxisSpeed保存的速度
+    const AxisDescriptor& desc = AXIS_REGISTRY[axis];
+    if (flows[axis].b_active) {
+        std::string msg_str = std::format("{}正在恒流运行，先停止再微调\n", desc.name);
+        hostLog().at(LogLevel::WARN).print(msg_str);
+        return;
     }
+    const bool b_fast = (type == FinetuneType::SPEED_UP || type == FinetuneType::SPEED_DOWN);
+    const bool b_forward = (type == FinetuneType::SPEED_UP || type == FinetuneType::SLOW_UP);
+    constexpr float distance = 30.0;
+    const float speed = b_fast ? desc.max_speed : desc.finetune_slow;
+    const long limit = std::lround(distance * desc.microsteps_per_ml);
+
+    postMotion({MotionOp::RUN_VELOCITY, axis, b_forward ? limit : -limit, b_forward ? speed : -speed});
+    std::string msg_str = std::format(
+        "{}{}{}\n",
+        desc.name,
+        b_fast ? "快速" : "慢速",
+        b_forward ? "正向微调" : "反向微调"
+    );
+    hostLog().print(msg_str);
+}
 
-    if (stepper) {
-        stepper->setMaxSpeed(syringe_speed);    // 最大速度（步/秒）
+void CtrlBoardManager::stopAxis(StepAxisId axis) {
+    // 恒速运行（恒流、微调）同样减速停止，结束时回报VELOCITY_DONE
+    // 减速期间收到的改速会重新加速，恒流在此标记为停止中，之后的改速一律拒绝
+    if (flows[axis].b_active) {
+        flows[axis].b_stopping = true;
     }
+    postMotion({MotionOp::STOP, axis, 0, 0});
 }
 
-void CtrlBoardManager::setPeristalticSpeed(float speed, bool b_volume_speed) {
-    if (b_volume_speed) {
-        peristaltic_speed = speed * V2R_RATIO * MICROSTEPS_2 * STEPS_PER_REV;
-    } else {
-        peristaltic_speed = speed;
+bool CtrlBoardManager::startFlow(StepAxisId axis, float rate, float volume, float seconds) {
+    const AxisDescriptor& desc = AXIS_REGISTRY[axis];
+    if (flows[axis].b_active) {
+        return false;
+    }
+    if (running_axes.load(std::memory_order_relaxed) & (uint32_t{1} << axis)) {
+        // 微调等恒速运行中再下发会被当作改速，位移起点不对
+        std::string msg_str = std::format("{}正在运动，停止后再启动恒流\n", desc.name);
+        hostLog().at(LogLevel::WARN).print(msg_str);
+        return false;
+    }
+    if (!std::isfinite(rate) || rate == 0 || std::fabs(rate) > desc.max_volume_speed) {
+        return false;
+    }
+    if (!std::isfinite(volume) || volume < 0 || !(seconds >= 0 && seconds <= FLOW_TIME_LIMIT_MAX_S)) {
+        return false;
+    }
+    // 体积按整步取整，停止位置与totalizer用同一个步数
+    long limit_steps = std::lround(volume * desc.microsteps_per_ml);
+    if (volume > 0 && limit_steps == 0) {
+        return false;
     }
+    if (rate < 0) {
+        limit_steps = -limit_steps;
+    }
+
+    flows[axis] = {
+        .b_active = true,
+        .rate = rate,
+        .limit_steps = limit_steps,
+        .time_limit_ms = static_cast<uint32_t>(std::lround(seconds * 1000)),
+        .start_ms = hal::millis(),
+        .b_stopping = false,
+    };
+    postMotion({MotionOp::RUN_VELOCITY, axis, limit_steps, rate * desc.microsteps_per_ml});
+    return true;
+}
 
-    if (stepper_pp) {
-        stepper_pp->setMaxSpeed(peristaltic_speed);
+bool CtrlBoardManager::setFlowRate(StepAxisId axis, float rate) {
+    const AxisDescriptor& desc = AXIS_REGISTRY[axis];
+    FlowState& flow = flows[axis];
+    if (!flow.b_active) {
+        return false;
+    }
+    if (flow.b_stopping) {
+        std::string msg_str = std::format("{}恒流正在停止，改速被忽略\n", desc.name);
+        hostLog().at(LogLevel::WARN).print(msg_str);
+        return false;
     }
+    if (!std::isfinite(rate) || rate == 0 || std::fabs(rate) > desc.max_volume_speed) {
+        return false;
+    }
+    if (flow.limit_steps != 0 && (rate < 0) != (flow.rate < 0)) {
+        std::string msg_str = std::format("{}恒流设有体积上限，不能反向\n", desc.name);
+        hostLog().at(LogLevel::WARN).print(msg_str);
+        return false;
+    }
+    flow.rate = rate;
+    postMotion({MotionOp::SET_VELOCITY, axis, flow.limit_steps, rate * desc.microsteps_per_ml});
+    return true;
 }
 
-void CtrlBoardManager::moveMm(float mm) {
-    const long target = mm * (STEPS_PER_REV * MICROSTEPS_1) / SCREW_PITCH;
-    if (stepper) {
-        stepper->move(target);
+float CtrlBoardManager::flowVolume(StepAxisId axis) {
+    if (!flows[axis].b_active) {
+        return 0;
     }
-    syringe_status = true;
+    return engine.velocityDisplacement(axis) / AXIS_REGISTRY[axis].microsteps_per_ml;
 }
 
-void CtrlBoardManager::ppMoveRounds(float rounds) {
-    const long target = rounds * (STEPS_PER_REV * MICROSTEPS_2);
-    if (stepper_pp) {
-        stepper_pp->move(target);
+float CtrlBoardManager::flowTotal(StepAxisId axis) {
+    int64_t steps = flow_total_steps[axis];
+    if (flows[axis].b_active) {
+        steps += engine.velocityDisplacement(axis);
     }
-    peristaltic_status = true;
+    return static_cast<float>(steps / static_cast<double>(AXIS_REGISTRY[axis].microsteps_per_ml));
 }
 
-void CtrlBoardManager::syrineFinetune(const SyringeFinetuneType& type) {
-    // 微调
-    // 0,1,2,3分别表示快升，慢升，慢降，快降
-    // finetune使用强制位移到一个很远的地方，比如30mL
-    const float distance = 30.0 * V2D_RATIO;
-
-    if (stepper) {
-        switch (type) {
-            using enum SyringeFinetuneType;
-            // 不能用setSyringeSpeed，因为这是用户保存的速度，不能覆盖
-            case SPEED_UP:
-                stepper->setMaxSpeed(FINETUNE_FAST);
-                moveMm(distance);
-                Serial.println("注射泵快速上移");
-                break;
-            case SLOW_UP:
-                stepper->setMaxSpeed(FINETUNE_SLOW);
-                moveMm(distance);
-                Serial.println("注射泵慢速上移");
-                break;
-            case SLOW_DOWN:
-                stepper->setMaxSpeed(FINETUNE_SLOW);
-                moveMm(-distance);
-                Serial.println("注射泵慢速下移");
-                break;
-            case SPEED_DOWN:
-                stepper->setMaxSpeed(FINETUNE_FAST);
-                moveMm(-distance);
-                Serial.println("注射泵快速下移");
-                break;
+void CtrlBoardManager::resetFlowTotal(StepAxisId axis) {
+    // 运行中清零时减去本次已走的位移，使累计值从现在开始计
+    flow_total_steps[axis] = flows[axis].b_active ? -engine.velocityDisplacement(axis) : 0;
+}
+
+void CtrlBoardManager::maintainFlow() {
+    const uint32_t now = hal::millis();
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        FlowState& flow = flows[i];
+        if (!flow.b_active || flow.time_limit_ms == 0 || flow.b_stopping) continue;
+        if (now - flow.start_ms >= flow.time_limit_ms) {
+            stopAxis(static_cast<StepAxisId>(i));
+            std::string msg_str = std::format("{}恒流达到时限 {} s，减速停止\n",
+                                              AXIS_REGISTRY[i].name, flow.time_limit_ms / 1000.0f);
+            hostLog().print(msg_str);
         }
     }
 }
 
-void CtrlBoardManager::stopSyringe() {
-    if (stepper) {
-        stepper->stop();
-        stepper->setMaxSpeed(syringe_speed); // finetune后恢复
+void CtrlBoardManager::stopAllAxes() {
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        stopAxis(static_cast<StepAxisId>(i));
     }
-    syringe_status = false;
 }
 
-void CtrlBoardManager::stopPeristaltic() {
-    if (stepper_pp) {
-        stepper_pp->stop();
+void CtrlBoardManager::setAcceleration(StepAxisId axis, float acceleration) {
+    axis_settings[axis].acceleration = acceleration;
+    postMotion({MotionOp::SET_ACCELERATION, axis, 0, acceleration});
+}
+
+void CtrlBoardManager::setJerk(StepAxisId axis, float jerk) {
+    axis_settings[axis].jerk = jerk;
+    postMotion({MotionOp::SET_JERK, axis, 0, jerk});
+}
+
+bool CtrlBoardManager::moveCoordinated(const std::array<float, STEP_AXIS_COUNT>& volumes, float duration) {
+    // 各轴在同一时间轴上联动：步数最多的为主轴，其余轴按Bresenham插补，保证同时开始、同时结束、流量比恒定
+    // duration > 0：按总时长（含加减速）反解主轴巡航速度；否则按各轴当前设定速度中最紧的约束运行
+    std::array<long, STEP_AXIS_COUNT> steps{};
+    std::array<float, STEP_AXIS_COUNT> abs_steps{};
+    StepAxisId master_axis = SYRINGE_AXIS;
+    float major = 0;
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        steps[i] = std::lround(volumes[i] * AXIS_REGISTRY[i].microsteps_per_ml);
+        abs_steps[i] = std::abs(static_cast<float>(steps[i]));
+        if (abs_steps[i] > major) {
+            major = abs_steps[i];
+            master_axis = static_cast<StepAxisId>(i);
+        }
+    }
+    if (major == 0) {
+        return false;
+    }
+
+    float master_speed = 0;
+    if (duration > 0) {
+        // S曲线：T(v) = S / v + Tr(v)，Tr为StepAxis::rampTime；要求 v·Tr(v) <= S 才能达到巡航速度
+        // T(v)在该区间内单调递减，二分求T(v) = duration的解
+        const float accel = axis_settings[master_axis].acceleration;
+        const float jerk = axis_settings[master_axis].jerk;
+        const auto total_time = [&](float v) { return major / v + StepAxis::rampTime(v, accel, jerk); };
+        // 能完成完整加减速的最高速度
+        float hi = std::min(std::sqrt(major * accel / 1.5f), std::cbrt(major * major * jerk / 4.5f));
+        float lo = major / duration;
+        if (lo >= hi || total_time(hi) > duration) {
+            return false;
+        }
+        for (int i = 0; i < 32; i++) {
+            const float mid = (lo + hi) / 2;
+            if (total_time(mid) > duration) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        master_speed = lo;
+    } else {
+        master_speed = axis_settings[master_axis].speed;
+        for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+            if (abs_steps[i] > 0) {
+                master_speed = std::min(master_speed, axis_settings[i].speed * major / abs_steps[i]);
+            }
+        }
+    }
+
+    if (master_speed <= 0) {
+        return false;
+    }
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        if (master_speed * abs_steps[i] / major > AXIS_REGISTRY[i].max_speed) {
+            return false;
+        }
+    }
+
+    return postMotion({MotionOp::MOVE_COORDINATED, master_axis, 0, master_speed, steps});
+}
+
+bool CtrlBoardManager::postMotion(const MotionCommand& command) {
+    if (!motion_queue.push(command)) {
+        hostLog().at(LogLevel::ERROR).println("运动指令队列已满，指令被丢弃");
+        return false;
+    }
+    motion_posted++;
+    return true;
+}
+
+void CtrlBoardManager::execMotion(const MotionCommand& command) {
+    const StepAxisId axis = static_cast<StepAxisId>(command.axis);
+    switch (command.op) {
+        case MotionOp::SET_MAX_SPEED:
+            engine.setMaxSpeed(axis, command.value);
+            break;
+        case MotionOp::SET_ACCELERATION:
+            engine.setAcceleration(axis, command.value);
+            break;
+        case MotionOp::SET_JERK:
+            engine.setJerk(axis, command.value);
+            break;
+        case MotionOp::MOVE:
+            if (engine.move(axis, command.steps)) {
+                running_axes.fetch_or(uint32_t{1} << axis, std::memory_order_relaxed);
+            } else {
+                event_queue.push({MotionEventType::MOVE_REJECTED, command.axis});
+            }
+            break;
+        case MotionOp::STOP:
+            // 保持使能直到减速结束，完成后照常回报MOTION_DONE
+            engine.stop(axis);
+            break;
+        case MotionOp::RUN_VELOCITY:
+            if (engine.runVelocity(axis, command.value, command.steps)) {
+                running_axes.fetch_or(uint32_t{1} << axis, std::memory_order_relaxed);
+                velocity_axes |= uint32_t{1} << axis;
+            } else {
+                event_queue.push({MotionEventType::VELOCITY_REJECTED, command.axis});
+            }
+            break;
+        case MotionOp::SET_VELOCITY:
+            // 本轴的恒速运行交给位置模式做最后的制动后runVelocity返回false，此时改速已无意义，直接忽略
+            // 运行已结束时也忽略，不会重新启动
+            if (velocity_axes & (uint32_t{1} << axis)) {
+                engine.runVelocity(axis, command.value, command.steps);
+            }
+            break;
+        case MotionOp::MOVE_COORDINATED:
+            if (engine.moveCoordinated(command.axis_steps, command.value)) {
+                uint32_t moving = 0;
+                for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+                    moving |= static_cast<uint32_t>(command.axis_steps[i] != 0) << i;
+                }
+                running_axes.fetch_or(moving, std::memory_order_relaxed);
+            } else {
+                event_queue.push({MotionEventType::COORDINATED_REJECTED, 0});
+            }
+            break;
     }
-    peristaltic_status = false;
 }
 
 void CtrlBoardManager::maintainMotor() {
-    if (stepper) {
-        if (stepper->distanceToGo() != 0) {
-            stepper->run();
-        } else {
-            if (syringe_status == true) {
-                Serial.println("注射泵运动完成");
-                syringe_status = false;
+    motor_meter.tick(instr::histograms().motor_interval);
+
+    MotionCommand command;
+    while (motion_queue.pop(command)) {
+        execMotion(command);
+        motion_executed.fetch_add(1, std::memory_order_release);
+    }
+
+    // 步进脉冲由StepEngine中断产生，这里只跟踪运动完成和驱动器使能
+    // 只有运动核心写running_axes，读出后在局部变量上逐轴清位，最后一次写回
+    uint32_t running = running_axes.load(std::memory_order_relaxed);
+    for (uint32_t pending = running; pending != 0; pending &= pending - 1) {
+        const auto axis = static_cast<StepAxisId>(__builtin_ctz(pending));
+        if (!engine.isRunning(axis)) {
+            const uint32_t bit = uint32_t{1} << axis;
+            running &= ~bit;
+            if (velocity_axes & bit) {
+                velocity_axes &= ~bit;
+                event_queue.push({MotionEventType::VELOCITY_DONE, axis, engine.velocityDisplacement(axis)});
+            } else {
+                event_queue.push({MotionEventType::MOTION_DONE, axis});
             }
         }
     }
+    running_axes.store(running, std::memory_order_relaxed);
 
-    if (stepper) {
-        if (stepper_pp->distanceToGo() != 0) {
-            stepper_pp->run();
-        } else {
-            if (peristaltic_status == true) {
-                Serial.println("蠕动泵运动完成");
-                peristaltic_status = false;
+    // 不用时关闭使能
+    hal::gpioWrite(BOARD.motor_en_pin, running == 0);
+}
+
+void CtrlBoardManager::procMotionEvents() {
+    MotionEvent event;
+    while (event_queue.pop(event)) {
+        switch (event.type) {
+            case MotionEventType::MOTION_DONE: {
+                std::string msg_str = std::format("{}运动完成\n", AXIS_REGISTRY[event.axis].name);
+                hostLog().print(msg_str);
+                break;
             }
+            case MotionEventType::COORDINATED_REJECTED:
+                hostLog().at(LogLevel::WARN).println("电机正在运动，联动未启动");
+                break;
+            case MotionEventType::MOVE_REJECTED:
+                hostLog().at(LogLevel::WARN).println("电机正在联动或恒流运行，单轴运动指令被忽略");
+                break;
+            case MotionEventType::VELOCITY_DONE: {
+                const AxisDescriptor& desc = AXIS_REGISTRY[event.axis];
+                std::string msg_str;
+                if (flows[event.axis].b_active) {
+                    flows[event.axis].b_active = false;
+                    flow_total_steps[event.axis] += event.steps;
+                    msg_str = std::format("{}恒流结束：本次 {} mL，累计 {} mL\n",
+                                          desc.name,
+                                          event.steps / desc.microsteps_per_ml,
+                                          flowTotal(static_cast<StepAxisId>(event.axis)));
+                } else {
+                    msg_str = std::format("{}运动完成\n", desc.name);
+                }
+                hostLog().print(msg_str);
+                break;
+            }
+            case MotionEventType::VELOCITY_REJECTED: {
+                // 只有启动会被拒绝（改速用SET_VELOCITY，不回报），此时轴没有动过
+                flows[event.axis].b_active = false;
+                std::string msg_str = std::format("{}正在运动，恒速运行未启动\n", AXIS_REGISTRY[event.axis].name);
+                hostLog().at(LogLevel::WARN).print(msg_str);
+                break;
+            }
+        }
+        // 配方中的运动被拒绝时后续步骤已失去意义
+        const bool b_done = (event.type == MotionEventType::MOTION_DONE || event.type == MotionEventType::VELOCITY_DONE);
+        if (!b_done && recipe.state() != RecipeState::IDLE) {
+            recipe.abort();
+            hostLog().at(LogLevel::ERROR).println("配方中的运动指令被拒绝，配方已中止");
         }
     }
+}
 
-    // 不用时关闭使能
-    if (syringe_status || peristaltic_status) {
-        digitalWrite(EN_PIN, LOW);
-    } else {
-        digitalWrite(EN_PIN, HIGH);
+bool CtrlBoardManager::motionIdle() const {
+    return motion_executed.load(std::memory_order_acquire) == motion_posted
+        && running_axes.load(std::memory_order_relaxed) == 0;
+}
+
+void CtrlBoardManager::maintainSwitch() {
+    // 推进485事务，响应到达或超时时触发回调
+    if constexpr (BOARD.switch_valve.b_present) {
+        switch_bus.poll();
+        for (auto& valve : switch_valves) {
+            valve.maintain();
+        }
+    }
+}
+
+bool CtrlBoardManager::switchValve(const SwitchCommand& command, size_t valve) {
+    if (valve >= switch_valves.size()) {
+        return false;
+    }
+    return switch_valves[valve].request(command);
+}
+
+bool CtrlBoardManager::switchBusy() const {
+    for (const auto& valve : switch_valves) {
+        if (valve.busy()) return true;
     }
+    return switch_bus.busy();
 }
 
 void CtrlBoardManager::solenoidToggleChannel(int channel, bool status) {
-    const int bit_num = channel - 1;
-    const unsigned char val = 1 << bit_num;
-    const unsigned char mask = ~val;
-    
-    solenoid_valve_status &= mask;
+    const SolenoidMask val = SolenoidMask{1} << (channel - 1);
     if (status) {
-        solenoid_valve_status |= val;
+        modifySolenoids(val, 0);
+    } else {
+        modifySolenoids(0, val);
     }
-    transmit595(solenoid_valve_status);
 }
 
-void CtrlBoardManager::updatePressure() {
-    const float proportion = static_cast<float>(cur_pressure) / static_cast<float>(max_pressure);
+void CtrlBoardManager::setSolenoidStatus(SolenoidMask status) {
+    modifySolenoids(status, SOLENOID_MASK_ALL);
+}
+
+void CtrlBoardManager::modifySolenoids(SolenoidMask open_mask, SolenoidMask close_mask) {
+    open_mask &= SOLENOID_MASK_ALL;
+    close_mask &= SOLENOID_MASK_ALL;
+    if (postValve({.type = ValveCommandType::SET, .mask = open_mask, .close_mask = close_mask})) {
+        solenoid_valve_status = (solenoid_valve_status & ~close_mask) | open_mask;
+    }
+}
+
+bool CtrlBoardManager::timeSolenoids(SolenoidMask mask, float on_ms, float off_ms, uint32_t cycles,
+                                     float stagger_ms, float delay_ms) {
+    const auto in_range = [](float ms, float min_ms) {
+        return std::isfinite(ms) && ms >= min_ms && ms <= SOLENOID_TIMING_MAX_MS;
+    };
+    if (mask == 0 || mask > SOLENOID_MASK_ALL) return false;
+    if (!in_range(on_ms, SOLENOID_TIMING_MIN_MS)) return false;
+    // 重复开启时关闭段不能为0，否则同一时刻反复切换
+    if (!in_range(off_ms, (cycles == 1) ? 0 : SOLENOID_TIMING_MIN_MS)) return false;
+    if (!in_range(stagger_ms, 0) || !in_range(delay_ms, 0)) return false;
+
+    const auto to_us = [](float ms) { return static_cast<uint32_t>(std::lround(ms * 1000)); };
+    const ValveCommand command {
+        .type = ValveCommandType::TIMED,
+        .mask = mask,
+        .close_mask = 0,
+        .start_us = hal::micros() + to_us(delay_ms),
+        .on_us = to_us(on_ms),
+        .off_us = to_us(off_ms),
+        .cycles = cycles,
+        .stagger_us = to_us(stagger_ms),
+    };
+    if (!postValve(command)) return false;
+    solenoid_valve_status &= ~mask;
+    return true;
+}
+
+bool CtrlBoardManager::postValve(const ValveCommand& command) {
+    if constexpr (!BOARD.solenoid.b_present) {
+        return false;
+    }
+    if (!valves.submit(command)) {
+        hostLog().at(LogLevel::ERROR).println("电磁阀指令队列已满，指令被丢弃");
+        return false;
+    }
+    return true;
+}
+
+bool CtrlBoardManager::setPressure(int pressure, float ramp_ms, PressureRampShape shape) {
+    if (pressure < 0 || pressure > max_pressure) {
+        return false;
+    }
+    if (!(ramp_ms >= 0 && ramp_ms <= PRESSURE_RAMP_MAX_MS)) {
+        return false;
+    }
+    cur_pressure = pressure;
+    return updatePressure(ramp_ms, shape);
+}
+
+bool CtrlBoardManager::setMaxPressure(int pressure) {
+    if (pressure <= 0 || pressure > 500) {
+        return false;
+    }
+    max_pressure = pressure;
+    pressure_loop.full_scale_kpa = static_cast<float>(pressure);
+    postPressureLoop();
+    updatePressure();
+    return true;
+}
+
+bool CtrlBoardManager::setPressureLoop(bool b_enabled) {
+    // 没有传感器的板型只能开环
+    if (b_enabled && !BOARD.pressure_sensor.b_present) {
+        return false;
+    }
+    pressure_loop.b_enabled = b_enabled;
+    return postPressureLoop();
+}
+
+bool CtrlBoardManager::setPressureGains(float kp, float ki, float kd, float kff) {
+    const bool b_valid = std::isfinite(kp) && std::isfinite(ki) && std::isfinite(kd) && std::isfinite(kff)
+                         && kp >= 0 && ki >= 0 && kd >= 0 && kff >= 0;
+    if (!b_valid) {
+        return false;
+    }
+    pressure_loop.kp = kp;
+    pressure_loop.ki = ki;
+    pressure_loop.kd = kd;
+    pressure_loop.kff = kff;
+    return postPressureLoop();
+}
+
+uint16_t CtrlBoardManager::pressureCode(int pressure) const {
+    const float proportion = static_cast<float>(pressure) / static_cast<float>(max_pressure);
     const int quantized_data = static_cast<int>(std::round(proportion * 4096.0));
-    const int data = std::min(quantized_data, 4095);
-    writeDAC(data);
+    return static_cast<uint16_t>(std::min(quantized_data, 4095));
+}
+
+bool CtrlBoardManager::postPressure(const DacCommand& command) {
+    if constexpr (!BOARD.dac.b_present) {
+        return false;
+    }
+    if (!pressure_out.submit(command)) {
+        hostLog().at(LogLevel::ERROR).println("压强指令队列已满，指令被丢弃");
+        return false;
+    }
+    return true;
+}
+
+bool CtrlBoardManager::postPressureLoop() {
+    if constexpr (!BOARD.dac.b_present) {
+        return false;
+    }
+    if (!pressure_out.configureLoop(pressure_loop)) {
+        hostLog().at(LogLevel::ERROR).println("压强闭环参数队列已满，设置被丢弃");
+        return false;
+    }
+    return true;
 }
 
-void CtrlBoardManager::shutLED() {
-    FastLED.setBrightness(0);
-    FastLED.show();
-    light_status = false;
+bool CtrlBoardManager::updatePressure(float ramp_ms, PressureRampShape shape) {
+    DacCommand command {
+        .type = DacCommandType::SET,
+        .shape = shape,
+        .code = pressureCode(cur_pressure),
+    };
+    if (ramp_ms > 0) {
+        command.type = DacCommandType::RAMP;
+        command.duration_us = static_cast<uint32_t>(ramp_ms * 1000);
+    }
+    return postPressure(command);
+}
+
+bool CtrlBoardManager::addPressureWavePoint(int pressure) {
+    if (pressure < 0 || pressure > max_pressure || pressure_wave_len == pressure_wave.size()) {
+        return false;
+    }
+    pressure_wave[pressure_wave_len++] = pressure;
+    return true;
+}
+
+bool CtrlBoardManager::playPressureWave(float sample_ms, uint32_t repeats) {
+    if (pressure_wave_len < 2 || !(sample_ms >= 1000.0f / DAC_UPDATE_FREQ && sample_ms <= PRESSURE_RAMP_MAX_MS)) {
+        return false;
+    }
+    // 一遍之内的位置按32位µs计算，一遍的时长不能超过该范围（约71分钟）；播放次数不受此限制
+    const double period_us = static_cast<double>(sample_ms) * 1000 * (pressure_wave_len - 1);
+    if (period_us > UINT32_MAX) {
+        return false;
+    }
+    std::array<uint16_t, PRESSURE_WAVE_MAX> codes;
+    for (size_t i = 0; i < pressure_wave_len; i++) {
+        codes[i] = pressureCode(pressure_wave[i]);
+    }
+    if (!pressure_out.loadWave(codes.data(), pressure_wave_len)) {
+        return false;
+    }
+    // 有限次播放结束时停在最后一个点
+    cur_pressure = pressure_wave[pressure_wave_len - 1];
+    return postPressure(DacCommand {
+        .type = DacCommandType::WAVE,
+        .duration_us = static_cast<uint32_t>(sample_ms * 1000),
+        .repeats = repeats,
+    });
 }
 
-void CtrlBoardManager::updateLED() {
-    FastLED.setBrightness(brightness);
-    FastLED.show();
+BoardStatus CtrlBoardManager::getStatus() {
+    // 闭环时报告传感器读数，否则按DAC输出换算
+    float pressure = pressure_out.currentCode() * max_pressure / 4096.0f;
+    pressure_out.measuredPressure(pressure);
+    BoardStatus status {
+        .axes = {},
+        .switch_channel = switch_valves.empty() ? uint8_t{0} : switch_valves[0].currentChannel(),
+        .solenoid_valve_status = valves.currentOutput(),
+        .cur_pressure = static_cast<int>(std::lround(pressure)),
+        .max_pressure = max_pressure,
+        .brightness = light.currentBrightness(),
+        .light_status = light.isOn(),
+    };
+    const uint32_t running = running_axes.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        const StepAxisId axis = static_cast<StepAxisId>(i);
+        status.axes[i] = {
+            .position = engine.currentPosition(axis),
+            .speed = engine.speed(axis),
+            .b_running = (running >> i & 1) != 0,
+        };
+    }
+    return status;
 }
 
+const std::array<CtrlBoardManager::VerbEntry, 10> CtrlBoardManager::verb_table {{
+    {"sv", &CtrlBoardManager::procSwitch},
+    {"sov", &CtrlBoardManager::procSolenoid},
+    {"pv", &CtrlBoardManager::procProportion},
+    {"l", &CtrlBoardManager::procLight},
+    {"bin", &CtrlBoardManager::procBinary},
+    {"co", &CtrlBoardManager::procCoordinated},
+    {"rc", &CtrlBoardManager::procRecipe},
+    {"tm", &CtrlBoardManager::procTelemetry},
+    {"log", &CtrlBoardManager::procLog},
+    {"diag", &CtrlBoardManager::procDiag},
+}};
+
 void CtrlBoardManager::procInstruction(std::string_view instruction) {
-    auto tokens = instruction
-        | std::views::split(' ') // 只能使用字符(char)，不能使用字符串
-        | std::views::transform([](auto token) {
-            return std::string(token.begin(), token.end());
-        });
-    // 展望C++23用上 | std::ranges::to<std::string>();
-    const std::vector<std::string> tokens_vec(tokens.begin(), tokens.end());
-    const int token_count = tokens_vec.size();
-    if (token_count == 0) return;
-
-    // 处理指令
-    bool b_proc_success = false;
-
-    if (tokens_vec[0] == "sp") {
-        // 注射泵控制
-        if (token_count == 2 && tokens_vec[1] == "-s") {
-            stopSyringe();
-            Serial.println("注射泵已停止");
-            b_proc_success = true;
-        } else if (token_count == 3) {
-            const auto instruction = tokens_vec[1];
-            const auto value = tokens_vec[2];
-
-            if (instruction == "-v") {
-                const float speed = std::stof(value);
-                if (speed > 0 && speed <= FINETUNE_FAST) {
-                    setSyringeSpeed(speed);
-                    std::string msg_str = std::format(
-                        "已设置注射泵速度为 {} 微步/s，对应电机转速 {} rps\n",
-                        speed,
-                        speed / MICROSTEPS_1 / STEPS_PER_REV
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-sv") {
-                const float speed = std::stof(value);
-                if (speed > 0 && speed <= SYRINGE_MAXIMUM_SPEED) {
-                    setSyringeSpeed(speed, true);
-                    std::string msg_str = std::format(
-                        "已设置注射泵速度为 {} mL/s，对应电机转速 {} rps\n",
-                        speed,
-                        speed * V2D_RATIO / SCREW_PITCH
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-f" || instruction == "-b") {
-                const float distance = std::stof(value);
-                if (distance > 0) {
-                    const float distance_r = (instruction == "-f") ? distance : -distance;
-                    const std::string_view pos_str = (instruction == "-f") ? "正向" : "反向";
-                    moveMm(distance_r);
-                    std::string msg_str = std::format(
-                        "注射泵 {} 移动 {} mm\n",
-                        pos_str,
-                        distance
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-fv" || instruction == "-bv") {
-                const float volume = std::stof(value);
-                if (volume > 0) {
-                    const float volume_r = (instruction == "-fv") ? volume : -volume;
-                    const float distance_r = volume_r * V2D_RATIO;
-                    const std::string_view pos_str = (instruction == "-fv") ? "正向" : "反向";
-                    moveMm(distance_r);
-                    std::string msg_str = std::format(
-                        "注射泵 {} 移动 {} mL\n",
-                        pos_str,
-                        volume
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-ft") {
-                const int param = std::stoi(value);
-                if (param >= 0 && param <=3) {
-                    SyringeFinetuneType finetune_type = static_cast<SyringeFinetuneType>(param);
-                    syrineFinetune(finetune_type);
-                    b_proc_success = true;
-                }
-            }
-        }
+    const CommandTokens tokens = tokenizeCommand(instruction);
+    if (tokens.size() == 0) return;
 
-        if (!b_proc_success) {
-            Serial.println("无效指令，格式应为：");
-            printSyringeInstr();
+    if (!tokens.overflow) {
+        for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+            if (AXIS_REGISTRY[i].verb == tokens[0]) {
+                const uint32_t start = instr::now();
+                procAxis(static_cast<StepAxisId>(i), tokens);
+                instr::recordSince(instr::histograms().verbs[i], start);
+                return;
+            }
         }
-    } else if (tokens_vec[0] == "pp") {
-        // 蠕动泵控制
-        if (token_count == 2 && tokens_vec[1] == "-s") {
-            stopPeristaltic();
-            Serial.println("蠕动泵已停止");
-            b_proc_success = true;
-        } else if (token_count == 3) {
-            auto instruction = tokens_vec[1];
-            auto value = tokens_vec[2];
-
-            if (instruction == "-v") {
-                const float speed = std::stof(value);
-                if (speed > 0 && speed <= PERISTALTIC_MAXIMUM_MICROSTEP) {
-                    setPeristalticSpeed(speed);
-                    std::string msg_str = std::format(
-                        "已设置蠕动泵速度为 {} 微步/s，对应电机转速 {} rps\n",
-                        speed,
-                        speed / MICROSTEPS_2 / STEPS_PER_REV
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-sv") {
-                const float speed = std::stof(value);
-                if (speed > 0 && speed <= PERISTALTIC_MAXIMUM_SPEED) {
-                    setPeristalticSpeed(speed, true);
-                    std::string msg_str = std::format(
-                        "已设置蠕动泵速度为 {} mL/s，对应电机转速 {} rps\n",
-                        speed,
-                        speed * V2R_RATIO
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-f" || instruction == "-b") {
-                const float rounds = std::stof(value);
-                if (rounds > 0) {
-                    const float rounds_r = (instruction == "-f") ? rounds : -rounds;
-                    const std::string_view pos_str = (instruction == "-f") ? "正向" : "反向";
-                    ppMoveRounds(rounds_r);
-                    std::string msg_str = std::format(
-                        "蠕动泵 {} 转动 {} 转\n",
-                        pos_str,
-                        rounds
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
-            } else if (instruction == "-fv" || instruction == "-bv") {
-                const float volume = std::stof(value);
-                if (volume > 0) {
-                    const float volume_r = (instruction == "-fv") ? volume : -volume;
-                    const float rounds_r = volume_r * V2R_RATIO;
-                    const std::string_view pos_str = (instruction == "-fv") ? "正向" : "反向";
-                    ppMoveRounds(rounds_r);
-                    std::string msg_str = std::format(
-                        "蠕动泵 {} 转动 {} mL\n",
-                        pos_str,
-                        volume
-                    );
-                    Serial.print(msg_str.c_str());
-                    b_proc_success = true;
-                }
+        for (size_t i = 0; i < verb_table.size(); i++) {
+            if (verb_table[i].verb == tokens[0]) {
+                const uint32_t start = instr::now();
+                (this->*verb_table[i].handler)(tokens);
+                instr::recordSince(instr::histograms().verbs[STEP_AXIS_COUNT + i], start);
+                return;
             }
         }
+    }
 
-        if (!b_proc_success) {
-            Serial.println("无效指令，格式应为：");
-            printPeristalticInstr();
+    hostLog().at(LogLevel::WARN).println("无效指令");
+    hostLog().println("可用命令：");
+    for (const auto& axis : AXIS_REGISTRY) {
+        printAxisInstr(axis);
+    }
+    if constexpr (BOARD.switch_valve.b_present) printSwitchInstr();
+    if constexpr (BOARD.solenoid.b_present) printSolenoidInstr();
+    if constexpr (BOARD.dac.b_present) printProportionInstr();
+    if constexpr (BOARD.led.b_present) printLightInstr();
+    printCoordinatedInstr();
+    printRecipeInstr();
+    printTelemetryInstr();
+    printLogInstr();
+    printDiagInstr();
+    printBinaryInstr();
+}
+
+void CtrlBoardManager::procAxis(StepAxisId axis, const CommandTokens& tokens) {
+    // 注射泵、蠕动泵等各轴共用的指令，单位与限制取自AXIS_REGISTRY
+    struct AxisContext {
+        CtrlBoardManager& manager;
+        StepAxisId axis;
+        const AxisDescriptor& desc;
+    };
+    using Entry = FlagEntry<AxisContext>;
+    static constexpr auto move_handler = [](AxisContext& c, const CommandTokens& t) {
+        float distance = 0;
+        if (!parseNumber(t[2], distance) || distance <= 0) return false;
+        const bool b_forward = (t[1] == "-f");
+        const std::string_view pos_str = b_forward ? "正向" : "反向";
+        c.manager.moveAxis(c.axis, b_forward ? distance : -distance);
+        std::string msg_str = std::format(
+            "{} {} {} {} {}\n",
+            c.desc.name,
+            pos_str,
+            c.desc.move_word,
+            distance,
+            c.desc.unit
+        );
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr auto volume_handler = [](AxisContext& c, const CommandTokens& t) {
+        float volume = 0;
+        if (!parseNumber(t[2], volume) || volume <= 0) return false;
+        const bool b_forward = (t[1] == "-fv");
+        const std::string_view pos_str = b_forward ? "正向" : "反向";
+        c.manager.moveAxisVolume(c.axis, b_forward ? volume : -volume);
+        std::string msg_str = std::format(
+            "{} {} {} {} mL\n",
+            c.desc.name,
+            pos_str,
+            c.desc.move_word,
+            volume
+        );
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr auto flow_handler = [](AxisContext& c, const CommandTokens& t) {
+        // -flow 流速 [体积] [秒]，已在恒流时只改流速
+        float rate = 0;
+        float volume = 0;
+        float seconds = 0;
+        if (!parseNumber(t[2], rate)) return false;
+        if (c.manager.flowActive(c.axis)) {
+            if (t.size() != 3 || !c.manager.setFlowRate(c.axis, rate)) return false;
+            std::string msg_str = std::format("{}流速改为 {} mL/s\n", c.desc.name, rate);
+            hostLog().print(msg_str);
+            return true;
         }
-    } else if (tokens_vec[0] == "sv") {
-        // 切换阀控制
-        SwitchCommand cmd;
-        if (token_count == 2) {
-            if (tokens_vec[1] == "-check") {
-                cmd = SwitchCheck{};
-                b_proc_success = true;
-            } else if (tokens_vec[1] == "-status") {
-                cmd = SwitchStatus{};
-                b_proc_success = true;
-            } else if (tokens_vec[1] == "-r") {
-                cmd = SwitchReset{};
-                b_proc_success = true;
-            }
-        } else if (token_count == 3) {
-            if (tokens_vec[1] == "-raw") {
-                cmd = SwitchRaw{tokens_vec[2]};
-                b_proc_success = true;
-            } else if (tokens_vec[1] == "-c") {
-                const int channel = std::stoi(tokens_vec[2]);
-                cmd = SwitchChannel{channel};
-                b_proc_success = true;
-            }
+        if (t.size() > 3 && !parseNumber(t[3], volume)) return false;
+        if (t.size() > 4 && !parseNumber(t[4], seconds)) return false;
+        if (!c.manager.startFlow(c.axis, rate, volume, seconds)) return false;
+        std::string msg_str = std::format("{}以 {} mL/s 恒流运行", c.desc.name, rate);
+        if (volume > 0) {
+            msg_str += std::format("，{} mL后停止", volume);
+        }
+        if (seconds > 0) {
+            msg_str += std::format("，最长 {} s", seconds);
         }
+        msg_str += "\n";
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr auto total_handler = [](AxisContext& c, const CommandTokens& t) {
+        if (t.size() == 3) {
+            if (t[2] != "0") return false;
+            c.manager.resetFlowTotal(c.axis);
+        }
+        std::string msg_str = std::format(
+            "{}恒流累计 {} mL{}\n",
+            c.desc.name,
+            c.manager.flowTotal(c.axis),
+            c.manager.flowActive(c.axis) ? std::format("（运行中，本次 {} mL）", c.manager.flowVolume(c.axis)) : ""
+        );
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr std::array<Entry, 15> flag_table {{
+        {"-a", 3, [](AxisContext& c, const CommandTokens& t) {
+            return c.manager.procRampParam(c.axis, false, t[2]);
+        }},
+        {"-j", 3, [](AxisContext& c, const CommandTokens& t) {
+            return c.manager.procRampParam(c.axis, true, t[2]);
+        }},
+        {"-s", 2, [](AxisContext& c, const CommandTokens&) {
+            c.manager.stopAxis(c.axis);
+            std::string msg_str = std::format("{}已停止\n", c.desc.name);
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-v", 3, [](AxisContext& c, const CommandTokens& t) {
+            float speed = 0;
+            if (!parseNumber(t[2], speed) || speed <= 0 || speed > c.desc.max_speed) return false;
+            c.manager.setAxisSpeed(c.axis, speed);
+            std::string msg_str = std::format(
+                "已设置{}速度为 {} 微步/s，对应电机转速 {} rps\n",
+                c.desc.name,
+                speed,
+                speed / c.desc.microsteps_per_rev
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-sv", 3, [](AxisContext& c, const CommandTokens& t) {
+            float speed = 0;
+            if (!parseNumber(t[2], speed) || speed <= 0 || speed > c.desc.max_volume_speed) return false;
+            c.manager.setAxisSpeed(c.axis, speed, true);
+            std::string msg_str = std::format(
+                "已设置{}速度为 {} mL/s，对应电机转速 {} rps\n",
+                c.desc.name,
+                speed,
+                speed * c.desc.microsteps_per_ml / c.desc.microsteps_per_rev
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-f", 3, move_handler},
+        {"-b", 3, move_handler},
+        {"-fv", 3, volume_handler},
+        {"-bv", 3, volume_handler},
+        {"-ft", 3, [](AxisContext& c, const CommandTokens& t) {
+            int param = 0;
+            if (!parseNumber(t[2], param) || param < 0 || param > 3) return false;
+            c.manager.finetuneAxis(c.axis, static_cast<FinetuneType>(param));
+            return true;
+        }},
+        {"-flow", 3, flow_handler},
+        {"-flow", 4, flow_handler},
+        {"-flow", 5, flow_handler},
+        {"-total", 2, total_handler},
+        {"-total", 3, total_handler},
+    }};
 
-        if (b_proc_success) {
-            procSwitchData(cmd);
-        } else {
-            Serial.println("指令暂不支持，可用指令：");
-            printSwitchInstr();
+    AxisContext context {*this, axis, AXIS_REGISTRY[axis]};
+    if (!dispatchFlag(flag_table, context, tokens)) {
+        hostLog().at(LogLevel::WARN).println("无效指令，格式应为：");
+        printAxisInstr(AXIS_REGISTRY[axis]);
+    }
+}
+
+bool CtrlBoardManager::procRampParam(StepAxisId axis, bool b_jerk, std::string_view token) {
+    // 各轴的 -a、-j：设置加速度（微步/s²）或加加速度（微步/s³），下一次从静止启动时生效
+    float value = 0;
+    const float limit = b_jerk ? JERK_LIMIT : ACCELERATION_LIMIT;
+    if (!parseNumber(token, value) || value <= 0 || value > limit) return false;
+    if (b_jerk) {
+        setJerk(axis, value);
+    } else {
+        setAcceleration(axis, value);
+    }
+    std::string msg_str = std::format(
+        "已设置{}{}为 {} {}\n",
+        AXIS_REGISTRY[axis].name,
+        b_jerk ? "加加速度" : "加速度",
+        value,
+        b_jerk ? "微步/s³" : "微步/s²"
+    );
+    hostLog().print(msg_str);
+    return true;
+}
+
+void CtrlBoardManager::procSwitch(const CommandTokens& tokens) {
+    // 切换阀控制
+    if constexpr (!BOARD.switch_valve.b_present) {
+        printAbsent("切换阀");
+        return;
+    }
+    // sv -d [阀号] 后接其余参数，选择总线上的第几台阀，省略时为第一台
+    struct SwitchContext {
+        CtrlBoardManager& manager;
+        size_t valve;
+    };
+    SwitchContext context{*this, 0};
+    CommandTokens args = tokens;
+    if (tokens.size() >= 4 && tokens[1] == "-d") {
+        size_t number = 0;
+        if (!parseNumber(tokens[2], number) || number < 1 || number > SWITCH_VALVE_COUNT) {
+            std::string msg_str = std::format("阀号错误，应在1~{}之间\n", SWITCH_VALVE_COUNT);
+            hostLog().at(LogLevel::WARN).print(msg_str);
+            return;
+        }
+        context.valve = number - 1;
+        args.count = tokens.size() - 2;
+        for (size_t i = 1; i < args.count; i++) {
+            args.items[i] = tokens[i + 2];
         }
+    }
 
-    } else if (tokens_vec[0] == "sov") {
-        // 电磁阀控制
-        if (token_count == 2 && tokens_vec[1] == "-s") {
-            b_proc_success = true;
-        } else if (token_count == 3) {
-            const std::string instr = tokens_vec[1];
-            const std::string val = tokens_vec[2];
-            if (instr == "-d") {
-                const int status_val = std::stoi(val);
-                if (status_val >= 0 && status_val <= 255) {
-                    b_proc_success = true;
-                    solenoid_valve_status = static_cast<unsigned char>(status_val);
-                    transmit595(solenoid_valve_status);
-                }  else {
-                    Serial.println("输入整数参数必须在0~255之间");
-                }
-            } else if (instr == "-b") {
-                if (val.length() == 8 && binStringToBytes(val, &solenoid_valve_status)) {
-                    b_proc_success = true;
-                    transmit595(solenoid_valve_status);
-                } else {
-                    Serial.println("输入参数必须是8个二进制数（0或1）");
-                }
-            } else if (instr == "-h") {
-                if (val.length() == 2 && hexStringToBytes(val, &solenoid_valve_status)) {
-                    b_proc_success = true;
-                    transmit595(solenoid_valve_status);
-                } else {
-                    Serial.println("输入参数必须是2个十六进制字符（0~F）");
-                }
+    using Entry = FlagEntry<SwitchContext>;
+    static constexpr std::array<Entry, 7> flag_table {{
+        {"-bus", 2, [](SwitchContext& c, const CommandTokens&) {
+            c.manager.switch_bus.printStatus();
+            return true;
+        }},
+        {"-cache", 2, [](SwitchContext& c, const CommandTokens&) {
+            c.manager.switch_valves[c.valve].printCache();
+            return true;
+        }},
+        {"-check", 2, [](SwitchContext& c, const CommandTokens&) {
+            c.manager.switchValve(SwitchCheck{}, c.valve);
+            return true;
+        }},
+        {"-status", 2, [](SwitchContext& c, const CommandTokens&) {
+            c.manager.switchValve(SwitchStatus{}, c.valve);
+            return true;
+        }},
+        {"-r", 2, [](SwitchContext& c, const CommandTokens&) {
+            c.manager.switchValve(SwitchReset{}, c.valve);
+            return true;
+        }},
+        {"-raw", 3, [](SwitchContext& c, const CommandTokens& t) {
+            c.manager.switchValve(SwitchRaw{t[2]}, c.valve);
+            return true;
+        }},
+        {"-c", 3, [](SwitchContext& c, const CommandTokens& t) {
+            int channel = 0;
+            if (!parseNumber(t[2], channel)) return false;
+            c.manager.switchValve(SwitchChannel{channel}, c.valve);
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, context, args)) {
+        hostLog().println("指令暂不支持，可用指令：");
+        printSwitchInstr();
+    }
+}
+
+void CtrlBoardManager::procSolenoid(const CommandTokens& tokens) {
+    // 电磁阀控制
+    if constexpr (!BOARD.solenoid.b_present) {
+        printAbsent("电磁阀");
+        return;
+    }
+    using Entry = FlagEntry<CtrlBoardManager>;
+    static constexpr auto timing_error = []() {
+        std::string msg_str = std::format(
+            "参数错误：时长需要在{}~{}ms之间，通道需要在[1,{}]范围\n",
+            SOLENOID_TIMING_MIN_MS,
+            SOLENOID_TIMING_MAX_MS,
+            SOLENOID_CHANNELS
+        );
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr auto pulse_handler = [](CtrlBoardManager& m, const CommandTokens& t) {
+        int channel = 0;
+        float on_ms = 0;
+        float delay_ms = 0;
+        if (!parseNumber(t[2], channel) || !parseNumber(t[3], on_ms)) return false;
+        if (t.size() == 5 && !parseNumber(t[4], delay_ms)) return false;
+        if (channel < 1 || channel > static_cast<int>(SOLENOID_CHANNELS)
+            || !m.timeSolenoids(SolenoidMask{1} << (channel - 1), on_ms, 0, 1, 0, delay_ms)) {
+            return timing_error();
+        }
+        std::string msg_str = std::format("通道{} 将在 {} ms 后开启 {} ms\n", channel, delay_ms, on_ms);
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr std::array<Entry, 10> flag_table {{
+        {"-p", 4, pulse_handler},
+        {"-p", 5, pulse_handler},
+        {"-w", 6, [](CtrlBoardManager& m, const CommandTokens& t) {
+            int channel = 0;
+            float on_ms = 0;
+            float off_ms = 0;
+            uint32_t cycles = 0;
+            if (!parseNumber(t[2], channel) || !parseNumber(t[3], on_ms)
+                || !parseNumber(t[4], off_ms) || !parseNumber(t[5], cycles)) return false;
+            if (channel < 1 || channel > static_cast<int>(SOLENOID_CHANNELS)
+                || !m.timeSolenoids(SolenoidMask{1} << (channel - 1), on_ms, off_ms, cycles)) {
+                return timing_error();
             }
-        } else if (token_count == 4) {
-            if (tokens_vec[1] == "-c") {
-                b_proc_success = true;
-                const int channel = std::stoi(tokens_vec[2]);
-                const bool status = static_cast<bool>(std::stoi(tokens_vec[3]));
-                if (channel >= 1 && channel <= 8) {
-                    solenoidToggleChannel(channel, status);
-                } else {
-                    Serial.println("参数错误：通道（即第一个参数）需要在[1,8]范围");
-                }
+            return true;
+        }},
+        {"-q", 5, [](CtrlBoardManager& m, const CommandTokens& t) {
+            SolenoidMask mask = 0;
+            float on_ms = 0;
+            float stagger_ms = 0;
+            if (!parseNumber(t[2], mask, 16) || !parseNumber(t[3], on_ms) || !parseNumber(t[4], stagger_ms)) return false;
+            if (!m.timeSolenoids(mask, on_ms, 0, 1, stagger_ms)) {
+                return timing_error();
+            }
+            return true;
+        }},
+        {"-s", 2, [](CtrlBoardManager&, const CommandTokens&) {
+            return true;
+        }},
+        {"-d", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            SolenoidMask status = 0;
+            if (parseNumber(t[2], status) && status <= SOLENOID_MASK_ALL) {
+                m.setSolenoidStatus(status);
+                return true;
+            }
+            std::string msg_str = std::format("输入整数参数必须在0~{}之间\n", SOLENOID_MASK_ALL);
+            hostLog().print(msg_str);
+            return false;
+        }},
+        {"-b", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            SolenoidMask status = 0;
+            if (t[2].length() <= SOLENOID_CHANNELS && parseNumber(t[2], status, 2)) {
+                m.setSolenoidStatus(status);
+                return true;
+            }
+            std::string msg_str = std::format("输入参数必须是不超过{}个二进制数（0或1）\n", SOLENOID_CHANNELS);
+            hostLog().print(msg_str);
+            return false;
+        }},
+        {"-h", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            SolenoidMask status = 0;
+            if (parseNumber(t[2], status, 16) && status <= SOLENOID_MASK_ALL) {
+                m.setSolenoidStatus(status);
+                return true;
             }
+            std::string msg_str = std::format("输入参数必须是不超过{}个十六进制字符（0~F）\n", SOLENOID_CHANNELS / 4);
+            hostLog().print(msg_str);
+            return false;
+        }},
+        {"-m", 4, [](CtrlBoardManager& m, const CommandTokens& t) {
+            SolenoidMask open_mask = 0;
+            SolenoidMask close_mask = 0;
+            if (!parseNumber(t[2], open_mask, 16) || !parseNumber(t[3], close_mask, 16)) return false;
+            if ((open_mask | close_mask) > SOLENOID_MASK_ALL || (open_mask & close_mask) != 0) {
+                hostLog().println("参数错误：位图超出通道数，或同一通道既开启又关闭");
+                return true;
+            }
+            m.modifySolenoids(open_mask, close_mask);
+            return true;
+        }},
+        {"-c", 4, [](CtrlBoardManager& m, const CommandTokens& t) {
+            int channel = 0;
+            int status = 0;
+            if (!parseNumber(t[2], channel) || !parseNumber(t[3], status)) return false;
+            if (channel >= 1 && channel <= static_cast<int>(SOLENOID_CHANNELS)) {
+                m.solenoidToggleChannel(channel, status != 0);
+            } else {
+                std::string msg_str = std::format("参数错误：通道（即第一个参数）需要在[1,{}]范围\n", SOLENOID_CHANNELS);
+                hostLog().print(msg_str);
+            }
+            return true;
+        }},
+    }};
+
+    if (dispatchFlag(flag_table, *this, tokens)) {
+        showSolenoidStatus(solenoid_valve_status);
+        if (const SolenoidMask timed = valves.timedChannels(); timed != 0) {
+            std::string msg_str = std::format("定时中的通道：{:X}\n", timed);
+            hostLog().print(msg_str);
         }
+    } else {
+        hostLog().println("指令错误，可用指令:");
+        printSolenoidInstr();
+    }
+}
 
-        if (b_proc_success) {
-            showSolenoidStatus(solenoid_valve_status);
-        } else{
-            Serial.println("指令错误，可用指令:");
-            printSolenoidInstr();
+void CtrlBoardManager::procProportion(const CommandTokens& tokens) {
+    // 比例阀控制
+    if constexpr (!BOARD.dac.b_present) {
+        printAbsent("比例阀");
+        return;
+    }
+    using Entry = FlagEntry<CtrlBoardManager>;
+    // -r/-e共用：目标压强与过渡时长
+    static constexpr auto ramp_handler = [](CtrlBoardManager& m, const CommandTokens& t) {
+        int val = 0;
+        float ramp_ms = 0;
+        if (!parseNumber(t[2], val) || !parseNumber(t[3], ramp_ms)) return false;
+        const PressureRampShape shape = (t[1] == "-e") ? PressureRampShape::EXPONENTIAL : PressureRampShape::LINEAR;
+        if (m.setPressure(val, ramp_ms, shape)) {
+            std::string msg_str = std::format(
+                "压强在 {} ms内{}过渡到 {} kPa\n",
+                ramp_ms, shape == PressureRampShape::EXPONENTIAL ? "按指数曲线" : "线性", m.cur_pressure
+            );
+            hostLog().print(msg_str);
+        } else {
+            std::string msg_str = std::format(
+                "输出压强必须在 [0, {}] kPa范围内，过渡时长必须在 [0, {}] ms范围内\n",
+                m.max_pressure, PRESSURE_RAMP_MAX_MS
+            );
+            hostLog().print(msg_str);
         }
-    } else if (tokens_vec[0] == "pv") {
-        // 比例阀控制
-        if (token_count == 3) {
-            std::string cmd = tokens_vec[1];
-            int val = std::stoi(tokens_vec[2]);
-            if (cmd == "-max") {
-                b_proc_success = true;
-                if (val > 0 && val <= 500) {
-                    max_pressure = val;
-                    updatePressure();
-
-                    std::string msg_str = std::format(
-                        "已将最大压强记录为 {} kPa\n",
-                        max_pressure
-                    );
-                    Serial.print(msg_str.c_str());
-                } else {
-                    Serial.println("最大压强必须在 (0, 500] kPa范围内");
-                }
-            } else if (cmd == "-p") {
-                b_proc_success = true;
-                if (val >= 0 && val <= max_pressure) {
-                    cur_pressure = val;
-                    updatePressure();
-
-                    std::string msg_str = std::format(
-                        "输出压强 {} kPa\n",
-                        cur_pressure
-                    );
-                    Serial.print(msg_str.c_str());
-                } else {
-                    std::string msg_str = std::format(
-                        "输出压强必须在 [0, {}] kPa范围内\n",
-                        max_pressure
-                    );
-                    Serial.print(msg_str.c_str());
-                }
+        return true;
+    };
+    // -wa 后可跟1~4个点
+    static constexpr auto wave_add_handler = [](CtrlBoardManager& m, const CommandTokens& t) {
+        for (size_t i = 2; i < t.size(); i++) {
+            int val = 0;
+            if (!parseNumber(t[i], val)) return false;
+            if (!m.addPressureWavePoint(val)) {
+                std::string msg_str = std::format(
+                    "波形点必须在 [0, {}] kPa范围内，最多 {} 个点\n",
+                    m.max_pressure, PRESSURE_WAVE_MAX
+                );
+                hostLog().print(msg_str);
+                return true;
             }
         }
-
-        if (!b_proc_success) {
-            Serial.println("指令错误，可用指令:");
-            printProportionInstr();
-        }
-
-    } else if (tokens_vec[0] == "l") {
-        // 光源控制
-        if (token_count == 2 && (tokens_vec[1] == "-on" || tokens_vec[1] == "-off")) {
-            if (tokens_vec[1] == "-off") {
-                shutLED();
-                Serial.println("已关闭光源");
+        std::string msg_str = std::format("波形共 {} 个点\n", m.pressureWaveLength());
+        hostLog().print(msg_str);
+        return true;
+    };
+    static constexpr std::array<Entry, 14> flag_table {{
+        {"-max", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            int val = 0;
+            if (!parseNumber(t[2], val)) return false;
+            if (m.setMaxPressure(val)) {
+                std::string msg_str = std::format(
+                    "已将最大压强记录为 {} kPa\n",
+                    m.max_pressure
+                );
+                hostLog().print(msg_str);
+            } else {
+                hostLog().println("最大压强必须在 (0, 500] kPa范围内");
+            }
+            return true;
+        }},
+        {"-p", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            int val = 0;
+            if (!parseNumber(t[2], val)) return false;
+            if (m.setPressure(val)) {
+                std::string msg_str = std::format(
+                    "输出压强 {} kPa\n",
+                    m.cur_pressure
+                );
+                hostLog().print(msg_str);
             } else {
-                updateLED();
-                light_status = true;
                 std::string msg_str = std::format(
-                    "已开启光源，亮度为 {}\n",
-                    brightness
+                    "输出压强必须在 [0, {}] kPa范围内\n",
+                    m.max_pressure
                 );
-                Serial.print(msg_str.c_str());
+                hostLog().print(msg_str);
             }
-        } else if (token_count == 3 && tokens_vec[1] == "-b") {
-            int val = std::stoi(tokens_vec[2]);
-            if (val >= 0 && val <= 255) {
-                brightness = static_cast<uint8_t>(val);
-                if (light_status) {
-                    updateLED();
-                }
+            return true;
+        }},
+        {"-r", 4, ramp_handler},
+        {"-e", 4, ramp_handler},
+        {"-wa", 3, wave_add_handler},
+        {"-wa", 4, wave_add_handler},
+        {"-wa", 5, wave_add_handler},
+        {"-wa", 6, wave_add_handler},
+        {"-wc", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.clearPressureWave();
+            hostLog().println("已清空波形");
+            return true;
+        }},
+        {"-ws", 4, [](CtrlBoardManager& m, const CommandTokens& t) {
+            float sample_ms = 0;
+            uint32_t repeats = 0;
+            if (!parseNumber(t[2], sample_ms) || !parseNumber(t[3], repeats)) return false;
+            if (m.pressureWavePlaying()) {
+                hostLog().println("波形播放中，请先用 pv -p 或 pv -r 停止");
+            } else if (m.playPressureWave(sample_ms, repeats)) {
                 std::string msg_str = std::format(
-                    "已调整亮度为 {}\n",
-                    brightness
+                    "开始播放 {} 个点的波形，间隔 {} ms，{}\n",
+                    m.pressureWaveLength(), sample_ms,
+                    repeats == 0 ? std::string("循环播放") : std::format("共 {} 次", repeats)
                 );
-                Serial.print(msg_str.c_str());
+                hostLog().print(msg_str);
             } else {
-                Serial.println("亮度值需要在[0,255]范围内");
+                std::string msg_str = std::format(
+                    "波形至少需要2个点，间隔必须在 [{}, {}] ms范围内，一遍不超过71分钟\n",
+                    1000.0f / DAC_UPDATE_FREQ, PRESSURE_RAMP_MAX_MS
+                );
+                hostLog().print(msg_str);
+            }
+            return true;
+        }},
+        {"-cl", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            int val = 0;
+            if (!parseNumber(t[2], val) || val < 0 || val > 1) return false;
+            if (m.setPressureLoop(val == 1)) {
+                hostLog().println(val == 1 ? "已开启压强闭环" : "已关闭压强闭环，按开环换算输出");
+            } else if (!BOARD.pressure_sensor.b_present) {
+                printAbsent("压强传感器，只能开环输出");
+            }
+            return true;
+        }},
+        {"-pid", 5, [](CtrlBoardManager& m, const CommandTokens& t) {
+            float kp = 0;
+            float ki = 0;
+            float kd = 0;
+            if (!parseNumber(t[2], kp) || !parseNumber(t[3], ki) || !parseNumber(t[4], kd)) return false;
+            if (!m.setPressureGains(kp, ki, kd, m.pressure_loop.kff)) {
+                hostLog().println("PID参数必须为非负数");
+                return true;
             }
+            std::string msg_str = std::format("PID参数：kp {}，ki {} /s，kd {} s\n", kp, ki, kd);
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-ff", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            float kff = 0;
+            if (!parseNumber(t[2], kff)) return false;
+            const PressureLoopConfig& loop = m.pressure_loop;
+            if (!m.setPressureGains(loop.kp, loop.ki, loop.kd, kff)) {
+                hostLog().println("前馈权重必须为非负数");
+                return true;
+            }
+            std::string msg_str = std::format("前馈权重：{}\n", kff);
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-s", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            const PressureOutput& out = m.pressure_out;
+            std::string msg_str = std::format(
+                "目标 {} kPa，设定值 {:.1f} kPa，DAC {}{}\n",
+                m.cur_pressure, out.setpointCode() * m.max_pressure / 4096.0f, out.currentCode(),
+                m.pressureWavePlaying() ? "，波形播放中" : (m.pressureBusy() ? "，过渡中" : "")
+            );
+            hostLog().print(msg_str);
+            if (!out.loopEnabled()) {
+                hostLog().println("压强闭环：关闭");
+                return true;
+            }
+            const PressureLoopConfig& loop = m.pressure_loop;
+            msg_str = std::format(
+                "压强闭环：开启，kp {}，ki {} /s，kd {} s，前馈 {}\n",
+                loop.kp, loop.ki, loop.kd, loop.kff
+            );
+            hostLog().print(msg_str);
+            float measured = 0;
+            if (!out.measuredPressure(measured)) {
+                hostLog().at(LogLevel::WARN).println("压强传感器读数异常，已退回开环输出");
+                return true;
+            }
+            msg_str = std::format("测量压强 {:.1f} kPa\n", measured);
+            hostLog().print(msg_str);
+            if (const StepResponse step = out.stepResponse(); step.b_valid) {
+                msg_str = std::format(
+                    "阶跃 {:.1f} -> {:.1f} kPa：超调 {:.1f}%，稳定时间 {:.1f} ms{}\n",
+                    step.from * m.max_pressure, step.to * m.max_pressure, step.overshoot * 100,
+                    step.settle_us / 1000.0f, step.b_settled ? "" : "（尚未稳定）"
+                );
+                hostLog().print(msg_str);
+            }
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, *this, tokens)) {
+        hostLog().println("指令错误，可用指令:");
+        printProportionInstr();
+    }
+}
+
+void CtrlBoardManager::procLight(const CommandTokens& tokens) {
+    // 光源控制
+    if constexpr (!BOARD.led.b_present) {
+        printAbsent("光源");
+        return;
+    }
+    using Entry = FlagEntry<CtrlBoardManager>;
+    // -c的颜色与可选的区域位图
+    static constexpr auto fill_handler = [](CtrlBoardManager& m, const CommandTokens& t) {
+        uint32_t rgb = 0;
+        LedMask mask = LED_MASK_ALL;
+        if (!parseNumber(t[2], rgb, 16) || rgb > 0xFFFFFF) return false;
+        if (t.size() == 4 && (!parseNumber(t[3], mask, 16) || (mask & ~LED_MASK_ALL) != 0)) return false;
+        m.light.fill(mask, LedColor(rgb));
+        std::string msg_str = std::format("已将区域 {:X} 设为 {:06X}\n", mask, rgb);
+        hostLog().print(msg_str);
+        return true;
+    };
+    // -bl/-br/-ch共用：区域位图、时长与次数
+    static constexpr auto animation_handler = [](CtrlBoardManager& m, const CommandTokens& t) {
+        LedAnimation animation;
+        if (!parseNumber(t[2], animation.mask, 16) || !parseNumber(t[3], animation.on_ms)) return false;
+        if (t[1] == "-bl") {
+            animation.type = LedAnimationType::BLINK;
+            if (!parseNumber(t[4], animation.off_ms) || !parseNumber(t[5], animation.cycles)) return false;
         } else {
-            Serial.println("指令错误，可用指令:");
-            printLightInstr();
+            animation.type = (t[1] == "-br") ? LedAnimationType::BREATHE : LedAnimationType::CHASE;
+            if (!parseNumber(t[4], animation.cycles)) return false;
         }
-    } else {
-        Serial.println("无效指令");
-        Serial.println("可用命令：");
-        printSyringeInstr();
-        printPeristalticInstr();
-        printSwitchInstr();
-        printSolenoidInstr();
-        printProportionInstr();
+        if (m.light.animate(animation)) {
+            hostLog().println(m.light.isOn() ? "动画开始" : "动画开始，光源关闭中，开启后可见");
+        } else {
+            std::string msg_str = std::format(
+                "区域不能为空，时长必须在1~{} ms之间（呼吸周期至少 {} ms）\n",
+                LED_ANIMATION_MAX_MS, 2 * LED_FRAME_MS
+            );
+            hostLog().print(msg_str);
+        }
+        return true;
+    };
+    static constexpr std::array<Entry, 13> flag_table {{
+        {"-off", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.shutLED();
+            hostLog().println("已关闭光源");
+            return true;
+        }},
+        {"-on", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.turnOnLED();
+            std::string msg_str = std::format(
+                "已开启光源，亮度为 {}\n",
+                m.light.currentBrightness()
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-b", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            int val = 0;
+            if (!parseNumber(t[2], val)) return false;
+            if (val >= 0 && val <= 255) {
+                m.setBrightness(static_cast<uint8_t>(val));
+                std::string msg_str = std::format(
+                    "已调整亮度为 {}\n",
+                    m.light.currentBrightness()
+                );
+                hostLog().print(msg_str);
+            } else {
+                hostLog().println("亮度值需要在[0,255]范围内");
+            }
+            return true;
+        }},
+        {"-c", 3, fill_handler},
+        {"-c", 4, fill_handler},
+        {"-px", 4, [](CtrlBoardManager& m, const CommandTokens& t) {
+            size_t index = 0;
+            uint32_t rgb = 0;
+            if (!parseNumber(t[2], index) || !parseNumber(t[3], rgb, 16) || rgb > 0xFFFFFF) return false;
+            if (!m.light.setPixel(index, LedColor(rgb))) {
+                std::string msg_str = std::format("LED编号必须在0~{}之间\n", NUM_LEDS - 1);
+                hostLog().print(msg_str);
+            }
+            return true;
+        }},
+        {"-clr", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.light.fill(LED_MASK_ALL, LedColor(0, 0, 0));
+            hostLog().println("已清空图案");
+            return true;
+        }},
+        {"-rm", 6, [](CtrlBoardManager&, const CommandTokens& t) {
+            int x = 0;
+            int y = 0;
+            int w = 0;
+            int h = 0;
+            if (!parseNumber(t[2], x) || !parseNumber(t[3], y) || !parseNumber(t[4], w) || !parseNumber(t[5], h)) return false;
+            std::string msg_str = std::format("区域位图：{:X}\n", ledRect(x, y, w, h));
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-bl", 6, animation_handler},
+        {"-br", 5, animation_handler},
+        {"-ch", 5, animation_handler},
+        {"-as", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.light.stopAnimation();
+            hostLog().println("已停止动画");
+            return true;
+        }},
+        {"-s", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            static constexpr std::array<std::string_view, 4> animation_names {"无", "闪烁", "呼吸", "跑马"};
+            const LedEngine& light = m.light;
+            std::string msg_str = std::format(
+                "光源{}，亮度 {}，动画：{}，画面变化 {} 次，已发送 {} 帧\n",
+                light.isOn() ? "开启" : "关闭", light.currentBrightness(),
+                animation_names[static_cast<size_t>(light.animationType())],
+                light.updateCount(), light.frameCount()
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, *this, tokens)) {
+        hostLog().println("指令错误，可用指令:");
         printLightInstr();
     }
-}
\ No newline at end of file
+}
+
+void CtrlBoardManager::procBinary(const CommandTokens& tokens) {
+    // 切换到二进制帧协议
+    if (tokens.size() == 1) {
+        hostLog().println("已切换到二进制协议");
+        setHostProtocol(HostProtocol::BINARY);
+    } else {
+        hostLog().println("指令错误，可用指令:");
+        printBinaryInstr();
+    }
+}
+
+void CtrlBoardManager::procCoordinated(const CommandTokens& tokens) {
+    // 多轴联动
+    using Entry = FlagEntry<CtrlBoardManager>;
+    static_assert(3 + STEP_AXIS_COUNT <= MAX_COMMAND_TOKENS, "co -t 的参数超过MAX_COMMAND_TOKENS");
+    static constexpr auto volumes_str = [](const std::array<float, STEP_AXIS_COUNT>& volumes) {
+        std::string res;
+        for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+            res += std::format("{}{} {} mL", (i == 0) ? "" : "，", AXIS_REGISTRY[i].name, volumes[i]);
+        }
+        return res;
+    };
+    static constexpr std::array<Entry, 3> flag_table {{
+        {"-t", 3 + STEP_AXIS_COUNT, [](CtrlBoardManager& m, const CommandTokens& t) {
+            // co -t [各轴mL] [s]
+            std::array<float, STEP_AXIS_COUNT> volumes{};
+            float duration = 0;
+            for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+                if (!parseNumber(t[2 + i], volumes[i])) return false;
+            }
+            if (!parseNumber(t[2 + STEP_AXIS_COUNT], duration) || duration <= 0) {
+                return false;
+            }
+            if (m.moveCoordinated(volumes, duration)) {
+                std::string msg_str = std::format("联动：{}，用时 {} s\n", volumes_str(volumes), duration);
+                hostLog().print(msg_str);
+            } else {
+                hostLog().println("联动参数无效：时长过短或超过电机最大速度");
+            }
+            return true;
+        }},
+        {"-r", 4, [](CtrlBoardManager& m, const CommandTokens& t) {
+            std::array<float, STEP_AXIS_COUNT> volumes{};
+            float ratio = 0;
+            if (!parseNumber(t[2], volumes[SYRINGE_AXIS]) || !parseNumber(t[3], ratio)) {
+                return false;
+            }
+            volumes[PERISTALTIC_AXIS] = volumes[SYRINGE_AXIS] * ratio;
+            if (m.moveCoordinated(volumes)) {
+                std::string msg_str = std::format("联动：{}\n", volumes_str(volumes));
+                hostLog().print(msg_str);
+            } else {
+                hostLog().println("联动参数无效：超过电机最大速度");
+            }
+            return true;
+        }},
+        {"-s", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.stopAllAxes();
+            hostLog().println("联动已停止");
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, *this, tokens)) {
+        hostLog().println("指令错误，可用指令:");
+        printCoordinatedInstr();
+    }
+}
+
+void CtrlBoardManager::procRecipe(const CommandTokens& tokens) {
+    // 板上配方：上传、查看、启动、暂停、继续、中止
+    using Entry = FlagEntry<CtrlBoardManager>;
+    static constexpr auto add_handler = [](CtrlBoardManager& m, const CommandTokens& t) {
+        RecipeStep step{};
+        if (!parseRecipeStep(t, 2, step)) return false;
+        if (!m.recipe.add(step)) {
+            hostLog().println("配方运行中、已满或参数超出范围，步骤未添加");
+            return true;
+        }
+        printRecipeStep(m.recipe.size() - 1, step);
+        return true;
+    };
+    static constexpr std::array<Entry, 11> flag_table {{
+        {"-add", 3, add_handler},
+        {"-add", 4, add_handler},
+        {"-add", 5, add_handler},
+        {"-add", 6, add_handler},
+        {"-clear", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            hostLog().println(m.recipe.clear() ? "配方已清空" : "配方运行中，无法清空");
+            return true;
+        }},
+        {"-list", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            for (size_t i = 0; i < m.recipe.size(); i++) {
+                printRecipeStep(i, m.recipe.step(i));
+            }
+            std::string msg_str = std::format(
+                "配方共 {} 步，状态 {}，当前第 {} 步\n",
+                m.recipe.size(),
+                static_cast<int>(m.recipe.state()),
+                m.recipe.position() + 1
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-start", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            hostLog().println(m.recipe.start() ? "配方开始执行" : "配方为空、循环不匹配或正在运行");
+            return true;
+        }},
+        {"-pause", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            hostLog().println(m.recipe.pause() ? "配方已暂停" : "配方未在运行");
+            return true;
+        }},
+        {"-resume", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            hostLog().println(m.recipe.resume() ? "配方继续执行" : "配方未暂停");
+            return true;
+        }},
+        {"-abort", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            m.recipe.abort();
+            hostLog().println("配方已中止");
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, *this, tokens)) {
+        hostLog().at(LogLevel::WARN).println("无效指令，格式应为：");
+        printRecipeInstr();
+    }
+}
+
+void CtrlBoardManager::procTelemetry(const CommandTokens& tokens) {
+    // 周期遥测：以二进制帧输出板上状态
+    using Entry = FlagEntry<CtrlBoardManager>;
+    static constexpr std::array<Entry, 2> flag_table {{
+        {"-r", 3, [](CtrlBoardManager& m, const CommandTokens& t) {
+            uint16_t hz = 0;
+            if (!parseNumber(t[2], hz) || !m.telemetry.setRate(hz)) return false;
+            std::string msg_str = std::format("遥测频率已设置为 {} Hz\n", hz);
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-s", 2, [](CtrlBoardManager& m, const CommandTokens&) {
+            std::string msg_str = std::format(
+                "遥测频率 {} Hz，缓冲 {} 条，已发送 {} 帧，丢弃 {} 条\n",
+                m.telemetry.currentRate(),
+                m.telemetry.buffered(),
+                m.telemetry.sentCount(),
+                m.telemetry.droppedCount()
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, *this, tokens)) {
+        hostLog().at(LogLevel::WARN).println("无效指令，格式应为：");
+        printTelemetryInstr();
+    }
+}
+
+void CtrlBoardManager::procLog(const CommandTokens& tokens) {
+    // 上位机输出队列：级别过滤、丢弃策略与统计
+    using Entry = FlagEntry<CtrlBoardManager>;
+    static constexpr std::array<Entry, 3> flag_table {{
+        {"-l", 3, [](CtrlBoardManager&, const CommandTokens& t) {
+            int level = 0;
+            if (!parseNumber(t[2], level) || level < 0 || level > 3) return false;
+            hostLog().setLevel(static_cast<LogLevel>(level));
+            std::string msg_str = std::format("输出级别已设置为 {}\n", level);
+            hostLog().print(msg_str);
+            return true;
+        }},
+        {"-p", 3, [](CtrlBoardManager&, const CommandTokens& t) {
+            int policy = 0;
+            if (!parseNumber(t[2], policy) || policy < 0 || policy > 1) return false;
+            hostLog().setDropPolicy(static_cast<LogDropPolicy>(policy));
+            hostLog().println(policy == 0 ? "队列满时丢弃新消息" : "队列满时丢弃最早的消息");
+            return true;
+        }},
+        {"-s", 2, [](CtrlBoardManager&, const CommandTokens&) {
+            const LogStats stats = hostLog().statistics();
+            std::string msg_str = std::format(
+                "输出队列：入队 {}，已发送 {}，丢弃 {}，过滤 {}，延迟 {}，最高占用 {}/{} 字节\n",
+                stats.queued,
+                stats.sent,
+                stats.dropped,
+                stats.filtered,
+                stats.delayed,
+                stats.high_water,
+                LOG_BUFFER_LEN
+            );
+            hostLog().print(msg_str);
+            return true;
+        }},
+    }};
+
+    if (!dispatchFlag(flag_table, *this, tokens)) {
+        hostLog().at(LogLevel::WARN).println("无效指令，格式应为：");
+        printLogInstr();
+    }
+}
+
+void CtrlBoardManager::procDiag(const CommandTokens& tokens) {
+    // 性能统计：diag 打印并清零，diag -p 只打印
+    constexpr size_t verb_count = STEP_AXIS_COUNT + std::tuple_size_v<decltype(verb_table)>;
+    static_assert(verb_count <= instr::VERB_SLOTS, "动词数超过VERB_SLOTS");
+
+    const bool b_peek = (tokens.size() == 2 && tokens[1] == "-p");
+    if (tokens.size() > 2 || (tokens.size() == 2 && !b_peek)) {
+        hostLog().at(LogLevel::WARN).println("无效指令，格式应为：");
+        printDiagInstr();
+        return;
+    }
+
+    std::array<std::string_view, verb_count> verb_names;
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        verb_names[i] = AXIS_REGISTRY[i].verb;
+    }
+    for (size_t i = 0; i < verb_table.size(); i++) {
+        verb_names[STEP_AXIS_COUNT + i] = verb_table[i].verb;
+    }
+    instr::dumpHistograms(verb_names, !b_peek);
+}
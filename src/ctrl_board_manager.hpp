@@ -1,61 +1,229 @@
 #pragma once
 
-#include <AccelStepper.h>
-#include <Arduino.h>
 #include <array>
+#include <atomic>
+#include <string_view>
+#include "command_parser.hpp"
 #include "constants.hpp"
-#include <FastLED.h>
+#include "hal.hpp"
+#include "instrumentation.hpp"
+#include "led_engine.hpp"
+#include "pressure_output.hpp"
+#include "recipe.hpp"
+#include "rs485_bus.hpp"
+#include "serial_rx.hpp"
+#include "solenoid_scheduler.hpp"
+#include "spsc_queue.hpp"
+#include "step_engine.hpp"
+#include "switch_valve.hpp"
+#include "telemetry.hpp"
 #include "types.hpp"
 
 class CtrlBoardManager {
 private:
-    AccelStepper* stepper;
-    AccelStepper* stepper_pp;
+    // 步进脉冲由定时器中断产生，这里只下发目标和速度
+    StepEngine& engine;
 
-    // 注射泵与蠕动泵电机速度，单位为步/秒
-    float syringe_speed;
-    float peristaltic_speed;
+    // 各轴由指令核心维护的参数，按StepAxisId索引，运动学与限制见AXIS_REGISTRY
+    struct AxisSettings {
+        float speed;        // 用户设定的速度，微步/s，微调结束后恢复
+        float acceleration; // 步/s²
+        float jerk;         // 步/s³
+    };
+    std::array<AxisSettings, STEP_AXIS_COUNT> axis_settings;
 
-    bool syringe_status;
-    bool peristaltic_status;
+    // 正在运动的轴，bit i为轴i；由运动核心写入，指令核心只读
+    std::atomic<uint32_t> running_axes;
+    // 正在恒速运行的轴，只由运动核心读写，结束时回报VELOCITY_DONE而不是MOTION_DONE
+    uint32_t velocity_axes;
 
-    // 旋转阀当前通道，关闭时为0，开始时范围为1~6
-    unsigned char switch_channel;
+    // 恒流运行（指令核心）：按mL/s持续运行，可随时改变流速，达到体积或时限时自动停止
+    struct FlowState {
+        bool b_active;
+        float rate;             // mL/s，带符号
+        long limit_steps;       // 相对本次起点的停止位移（微步），0为不限
+        uint32_t time_limit_ms; // 0为不限
+        uint32_t start_ms;
+        bool b_stopping;        // 已发出停止（stopAxis或时限），不再接受改速
+    };
+    std::array<FlowState, STEP_AXIS_COUNT> flows;
+    // 已结束的恒流运行累计位移（微步），整步累加不损失小数步，-total 0清零
+    std::array<int64_t, STEP_AXIS_COUNT> flow_total_steps;
 
-    // 电磁阀状态，一共8位，就是8bit数据，用unsigned char保存即可
+    // 核间队列：指令核心 -> 运动核心，运动核心 -> 指令核心
+    SpscQueue<MotionCommand, MOTION_QUEUE_LEN> motion_queue;
+    SpscQueue<MotionEvent, EVENT_QUEUE_LEN> event_queue;
+
+    // 已投递与已执行的运动指令数，两者相等说明队列中的指令都已生效
+    uint32_t motion_posted;
+    std::atomic<uint32_t> motion_executed;
+
+    bool postMotion(const MotionCommand& command);
+    void execMotion(const MotionCommand& command);
+
+    // 连接切换阀的485总线（Serial1），多台阀按地址共用
+    Rs485Bus switch_bus;
+    // 各切换阀的驱动与位置缓存，顺序同BOARD.switch_valve.valves
+    std::array<SwitchValve, SWITCH_VALVE_COUNT> switch_valves;
+
+    // 电磁阀状态，每个通道一位
     // 25.11.25 review: 笑嘻了，半年前居然无意间自己实现了个vector<bool>
-    unsigned char solenoid_valve_status;
+    // 这里是指令设定的开关状态，定时通道结束后关闭，所以设定定时时清掉对应位
+    SolenoidMask solenoid_valve_status;
+    // 电磁阀输出调度，唯一写74HC595的地方
+    SolenoidScheduler valves;
+
+    bool postValve(const ValveCommand& command);
 
-    // 比例阀压强记录
+    // 比例阀压强记录，cur_pressure为最近一次设定的目标
     int max_pressure;
     int cur_pressure;
+    // 比例阀DAC输出，斜坡、波形和闭环由闹钟推进
+    PressureOutput pressure_out;
+    AnalogPressureSensor pressure_sensor;
+    PressureLoopConfig pressure_loop;
+    // 暂存的波形点（kPa），播放时换算为DAC码
+    std::array<int, PRESSURE_WAVE_MAX> pressure_wave;
+    size_t pressure_wave_len;
+
+    uint16_t pressureCode(int pressure) const;
+    bool postPressure(const DacCommand& command);
+    bool postPressureLoop();
 
     // WS2812光源
-    std::array<CRGB, NUM_LEDS> leds;
-    uint8_t brightness;
-    bool light_status;
+    LedEngine light;
+
+    // 上位机协议：文本或二进制帧
+    HostProtocol host_protocol;
+    // 上位机串口接收通道
+    SerialRx host_rx;
+
+    // 板上配方，由指令核心推进
+    RecipeRunner recipe;
+
+    // 周期遥测
+    Telemetry telemetry;
+
+    // 运动核心循环间隔统计
+    instr::IntervalMeter motor_meter;
+
+    // 动词表，下标同时是instr::Histograms::verbs的下标
+    using VerbHandler = void (CtrlBoardManager::*)(const CommandTokens&);
+    struct VerbEntry {
+        std::string_view verb;
+        VerbHandler handler;
+    };
+    // 各轴的动词在AXIS_REGISTRY中，直方图下标0~STEP_AXIS_COUNT-1留给各轴，verb_table依次排在后面
+    static const std::array<VerbEntry, 10> verb_table;
+
+    // 各设备指令处理，由procInstruction按动词分派
+    // 所有轴共用一套指令，axis由动词在AXIS_REGISTRY中的位置决定
+    void procAxis(StepAxisId axis, const CommandTokens& tokens);
+    void procSwitch(const CommandTokens& tokens);
+    void procSolenoid(const CommandTokens& tokens);
+    void procProportion(const CommandTokens& tokens);
+    void procLight(const CommandTokens& tokens);
+    void procBinary(const CommandTokens& tokens);
+    void procCoordinated(const CommandTokens& tokens);
+    void procRecipe(const CommandTokens& tokens);
+    void procTelemetry(const CommandTokens& tokens);
+    void procLog(const CommandTokens& tokens);
+    void procDiag(const CommandTokens& tokens);
+    // 各轴共用的 -a/-j 参数处理
+    bool procRampParam(StepAxisId axis, bool b_jerk, std::string_view token);
 
 public:
-    CtrlBoardManager(AccelStepper* sp = nullptr, AccelStepper* pp = nullptr);
+    explicit CtrlBoardManager(StepEngine& step_engine);
     ~CtrlBoardManager();
 
     void init();
 
-    void setSyringeSpeed(float speed, bool b_volume_speed = false);
-    void setPeristalticSpeed(float speed, bool b_volume_speed = false);
-    void moveMm(float mm);
-    void ppMoveRounds(float rounds);
-    void syrineFinetune(const SyringeFinetuneType& type);
-    void stopSyringe();
-    void stopPeristaltic();
+    // 单轴运动：b_volume_speed为true时speed单位为mL/s，否则为微步/s
+    void setAxisSpeed(StepAxisId axis, float speed, bool b_volume_speed = false);
+    // 按AXIS_REGISTRY中的unit（注射泵为mm，蠕动泵为转）或按体积相对移动，负数为反向
+    void moveAxis(StepAxisId axis, float distance);
+    void moveAxisVolume(StepAxisId axis, float volume);
+    void finetuneAxis(StepAxisId axis, FinetuneType type);
+    // 减速停止，对恒流和微调同样有效
+    void stopAxis(StepAxisId axis);
+    void stopAllAxes();
+    // 恒流：rate为mL/s（负数为反向），volume > 0时在本次流出volume mL处精确停下，seconds > 0时到时减速停止
+    // 该轴已在恒流运行时只能用setFlowRate改变流速，参数超出范围时返回false
+    bool startFlow(StepAxisId axis, float rate, float volume = 0, float seconds = 0);
+    // 运行中平滑改变流速，体积与时限不变；该轴不在恒流运行时返回false
+    bool setFlowRate(StepAxisId axis, float rate);
+    bool flowActive(StepAxisId axis) const { return flows[axis].b_active; }
+    // 本次恒流已流出的体积，以及包括本次在内的累计体积（mL）
+    float flowVolume(StepAxisId axis);
+    float flowTotal(StepAxisId axis);
+    void resetFlowTotal(StepAxisId axis);
+    // 指令核心每毫秒调用，检查恒流时限
+    void maintainFlow();
+    void setAcceleration(StepAxisId axis, float acceleration);
+    void setJerk(StepAxisId axis, float jerk);
+    // 各轴按体积（mL）联动，duration > 0时按总时长反解速度
+    bool moveCoordinated(const std::array<float, STEP_AXIS_COUNT>& volumes, float duration = 0);
+
+    // 运动核心：执行队列中的指令，跟踪运动完成并控制驱动器使能
     void maintainMotor();
+    // 指令核心：处理运动核心回报的事件
+    void procMotionEvents();
+    // 所有已投递的运动指令都已执行且所有轴都已停止
+    bool motionIdle() const;
+
+    void maintainSwitch();
+    // valve为BOARD.switch_valve.valves中的下标，二进制协议与配方默认用第一台
+    bool switchValve(const SwitchCommand& command, size_t valve = 0);
+    bool switchBusy() const;
+
+    // 指令核心每毫秒调用，推进板上配方
+    void maintainRecipe() { recipe.maintain(); }
+    RecipeRunner& recipeRunner() { return recipe; }
+
+    // 指令核心每毫秒调用，采样并发送遥测帧
+    void maintainTelemetry() { telemetry.maintain(); }
+    Telemetry& telemetryStream() { return telemetry; }
 
     void solenoidToggleChannel(int channel, bool status);
+    void setSolenoidStatus(SolenoidMask status);
+    // 同时开启open_mask、关闭close_mask中的通道，其余通道不变，所有变化在同一次锁存中生效
+    void modifySolenoids(SolenoidMask open_mask, SolenoidMask close_mask);
+    // 定时开启mask中的通道：每次开启on_ms、关闭off_ms，共cycles次（0为持续），
+    // 第一个通道在delay_ms后开启，之后每个通道依次推迟stagger_ms；参数超出范围时返回false
+    bool timeSolenoids(SolenoidMask mask, float on_ms, float off_ms, uint32_t cycles,
+                       float stagger_ms = 0, float delay_ms = 0);
+    bool solenoidBusy() const { return valves.busy(); }
+
+    // ramp_ms大于0时从当前输出按shape过渡到目标，参数超出范围时返回false
+    bool setPressure(int pressure, float ramp_ms = 0, PressureRampShape shape = PressureRampShape::LINEAR);
+    bool setMaxPressure(int pressure);
+    bool updatePressure(float ramp_ms = 0, PressureRampShape shape = PressureRampShape::LINEAR);
+    // 波形：逐点添加后播放，相邻两点间隔sample_ms并线性插值，repeats为0时循环
+    bool addPressureWavePoint(int pressure);
+    void clearPressureWave() { pressure_wave_len = 0; }
+    size_t pressureWaveLength() const { return pressure_wave_len; }
+    bool playPressureWave(float sample_ms, uint32_t repeats);
+    bool pressureWavePlaying() const { return pressure_out.wavePlaying(); }
+    // 有限的斜坡或波形尚未结束
+    bool pressureBusy() const { return pressure_out.busy(); }
+    // 压强闭环：开启后按传感器读数修正比例阀输出，PID参数见PressureLoopConfig
+    bool setPressureLoop(bool b_enabled);
+    bool setPressureGains(float kp, float ki, float kd, float kff);
+
+    void shutLED() { light.setOn(false); }
+    void turnOnLED() { light.setOn(true); }
+    void setBrightness(uint8_t value) { light.setBrightness(value); }
+    // 指令核心每毫秒调用，推进LED动画并在画面变化时发送
+    void maintainLight() {
+        if constexpr (BOARD.led.b_present) light.maintain();
+    }
+    LedEngine& lightEngine() { return light; }
 
-    void updatePressure(); 
+    BoardStatus getStatus();
 
-    void shutLED();
-    void updateLED();
+    SerialRx& hostRx() { return host_rx; }
+    HostProtocol hostProtocol() const { return host_protocol; }
+    void setHostProtocol(HostProtocol protocol) { host_protocol = protocol; }
 
     void procInstruction(std::string_view instruction);
 };
\ No newline at end of file
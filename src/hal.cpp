@@ -0,0 +1,39 @@
+#include "hal.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+// HalPrint的格式化输出，串口与日志队列共用
+
+size_t HalPrint::print(std::string_view str) {
+    return write(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+size_t HalPrint::print(char c) {
+    const uint8_t byte = static_cast<uint8_t>(c);
+    return write(&byte, 1);
+}
+
+size_t HalPrint::print(long value) {
+    char buffer[16];
+    const int len = snprintf(buffer, sizeof(buffer), "%ld", value);
+    return write(reinterpret_cast<const uint8_t*>(buffer), len);
+}
+
+size_t HalPrint::println(std::string_view str) {
+    return print(str) + print("\r\n");
+}
+
+size_t HalPrint::println(long value) {
+    return print(value) + print("\r\n");
+}
+
+size_t HalPrint::printf(const char* fmt, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    if (len <= 0) return 0;
+    return write(reinterpret_cast<const uint8_t*>(buffer), std::min<size_t>(len, sizeof(buffer) - 1));
+}
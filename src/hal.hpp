@@ -0,0 +1,190 @@
+#pragma once
+
+// 硬件抽象层
+// 固件逻辑只通过这里访问串口、GPIO、I2C、WS2812和定时器
+// ESP32上由hal_arduino.cpp实现，主机(env:native)上由hal_native.cpp提供记录总线流量的模拟实现
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <FastLED.h>
+#include <soc/gpio_reg.h>
+#define HAL_ISR_ATTR ARDUINO_ISR_ATTR
+#else
+#include <atomic>
+#define HAL_ISR_ATTR
+#endif
+
+// LED颜色类型：ESP32上直接使用FastLED的CRGB，主机上使用内存布局相同的结构
+#ifdef ARDUINO
+using LedColor = CRGB;
+#else
+struct LedColor {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+
+    constexpr LedColor() = default;
+    constexpr LedColor(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    constexpr explicit LedColor(uint32_t rgb)
+        : r(static_cast<uint8_t>(rgb >> 16)), g(static_cast<uint8_t>(rgb >> 8)), b(static_cast<uint8_t>(rgb)) {}
+    constexpr bool operator==(const LedColor&) const = default;
+};
+#endif
+
+// 串口接收回调：ESP32上在UART事件任务中调用，主机上在注入数据时调用，不在中断上下文
+using SerialRxCallback = void (*)(void* arg);
+
+// 文本输出接口，print系列辅助函数都基于write实现
+class HalPrint {
+public:
+    virtual ~HalPrint() = default;
+
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+
+    size_t print(std::string_view str);
+    size_t print(char c);
+    size_t print(long value);
+    size_t println(std::string_view str = "");
+    size_t println(long value);
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// 串口抽象
+class HalSerial : public HalPrint {
+public:
+    // rx_pin/tx_pin为-1时使用默认引脚
+    virtual void begin(unsigned long baud, int rx_pin = -1, int tx_pin = -1) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    // 发送缓冲区剩余空间，写入不超过该长度时write不会阻塞
+    virtual int availableForWrite() = 0;
+    // 收到数据时调用callback，调用前驱动缓冲区中已有新数据，回调中用available/read取出
+    virtual void onReceive(SerialRxCallback callback, void* arg) = 0;
+};
+
+namespace hal {
+
+// 串口：与上位机通信的USB串口，以及连接485模块的UART1
+HalSerial& hostSerial();
+HalSerial& rs485Serial();
+
+// 时间
+uint32_t millis();
+uint32_t micros();
+
+// GPIO
+void gpioOutput(uint8_t pin);
+void gpioWrite(uint8_t pin, bool level);
+// 74HC595级联链，由SPI外设移位：data_pin接DS，clock_pin接SHCP，latch_pin(STCP)作为片选
+// 片选在传输期间为低、结束后拉高，整条链在同一个上升沿锁存，所有输出同时更新
+void shiftChainBegin(uint8_t data_pin, uint8_t clock_pin, uint8_t latch_pin, uint32_t freq);
+// data[0]最先移出，最终位于链上离DS最远的一片；每字节高位在前；阻塞到传输结束（32位约4us）
+void shiftChainWrite(const uint8_t* data, size_t len);
+
+// I2C
+void i2cBegin(uint8_t sda_pin, uint8_t scl_pin, uint32_t freq);
+bool i2cWrite(uint8_t address, const uint8_t* data, size_t len);
+
+// ADC，读数为经过出厂校准的毫伏值
+void adcBegin(uint8_t pin);
+uint32_t adcReadMv(uint8_t pin);
+
+// WS2812，由RMT外设异步发送：ledShow按亮度缩放并编码后立即返回，不等待发送结束
+// 发送期间（含帧间的复位低电平）ledBusy()为true，此时ledShow返回false，正在发送的数据不受影响
+void ledBegin(uint8_t pin);
+bool ledShow(const LedColor* pixels, size_t count, uint8_t brightness);
+bool ledBusy();
+
+// 周期定时器，callback在中断上下文中以 timer_freq / alarm_ticks 的频率被调用
+using TimerCallback = void (*)(void* arg);
+void timerStart(uint32_t timer_freq, uint32_t alarm_ticks, TimerCallback callback, void* arg);
+
+// 单次闹钟：到期后调用一次callback，同一个闹钟再次alarmArm会取代尚未到期的设定
+// 回调都在任务中执行（不是中断），回调里可以使用SPI、I2C等驱动
+// core为ALARM_TIMER_TASK时，ESP32上由esp_timer在其高优先级任务（核心0）中回调，这类闹钟依次回调，彼此不会并发
+// core为0或1时，由该核心上的硬件定时器中断唤醒专用任务回调，不排在esp_timer的回调之后；
+// 设定时刻与重新设定相距极近时可能多回调一次，回调需自行判断是否到期
+using AlarmId = uint8_t;
+constexpr int ALARM_TIMER_TASK = -1;
+AlarmId alarmCreate(TimerCallback callback, void* arg, int core = ALARM_TIMER_TASK);
+void alarmArm(AlarmId alarm, uint32_t delay_us);
+
+// CPU周期计数器（32位，240MHz下约18s回绕一次），用于性能统计
+// 主机上由虚拟时钟按HOST_CPU_MHZ换算
+#ifdef ARDUINO
+__attribute__((always_inline)) inline uint32_t cycleCount() { return ESP.getCycleCount(); }
+inline uint32_t cpuMhz() { return getCpuFrequencyMhz(); }
+#else
+uint32_t cycleCount();
+uint32_t cpuMhz();
+#endif
+
+// 在中断中批量置位/清零GPIO0~31
+#ifdef ARDUINO
+__attribute__((always_inline)) inline void gpioWriteMask(uint32_t set_mask, uint32_t clear_mask) {
+    if (clear_mask) REG_WRITE(GPIO_OUT_W1TC_REG, clear_mask);
+    if (set_mask) REG_WRITE(GPIO_OUT_W1TS_REG, set_mask);
+}
+#else
+void gpioWriteMask(uint32_t set_mask, uint32_t clear_mask);
+#endif
+
+// 临界区自旋锁，可跨核心、可在中断中使用
+#ifdef ARDUINO
+class SpinLock {
+private:
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+public:
+    void lock() { portENTER_CRITICAL(&mux); }
+    void unlock() { portEXIT_CRITICAL(&mux); }
+    void lockFromISR() { portENTER_CRITICAL_ISR(&mux); }
+    void unlockFromISR() { portEXIT_CRITICAL_ISR(&mux); }
+};
+#else
+class SpinLock {
+private:
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+public:
+    void lock() { while (flag.test_and_set(std::memory_order_acquire)) {} }
+    void unlock() { flag.clear(std::memory_order_release); }
+    void lockFromISR() { lock(); }
+    void unlockFromISR() { unlock(); }
+};
+#endif
+
+// 任务唤醒信号：give()可在任意任务中调用，take()阻塞等待直到被唤醒或超时
+// 多次give只会唤醒一次
+#ifdef ARDUINO
+class Signal {
+private:
+    StaticSemaphore_t storage;
+    SemaphoreHandle_t handle;
+
+public:
+    Signal() : handle(xSemaphoreCreateBinaryStatic(&storage)) {}
+    Signal(const Signal&) = delete;
+    Signal& operator=(const Signal&) = delete;
+
+    void give() { xSemaphoreGive(handle); }
+    bool take(uint32_t timeout_ms) { return xSemaphoreTake(handle, pdMS_TO_TICKS(timeout_ms)) == pdTRUE; }
+};
+#else
+// 主机上两个任务在同一线程中轮流执行，take()不阻塞
+class Signal {
+private:
+    std::atomic<bool> flag{false};
+
+public:
+    void give() { flag.store(true, std::memory_order_release); }
+    bool take(uint32_t) { return flag.exchange(false, std::memory_order_acquire); }
+};
+#endif
+
+} // namespace hal
@@ -0,0 +1,237 @@
+#include "hal.hpp"
+
+#include "constants.hpp"
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <Wire.h>
+#include <driver/spi_master.h>
+#include <esp_timer.h>
+
+#include <array>
+#include <cassert>
+#include <cstring>
+
+// HardwareSerial的HalSerial包装
+class ArduinoSerial : public HalSerial {
+private:
+    HardwareSerial& port;
+
+public:
+    explicit ArduinoSerial(HardwareSerial& serial) : port(serial) {}
+
+    void begin(unsigned long baud, int rx_pin, int tx_pin) override {
+        port.begin(baud, SERIAL_8N1, rx_pin, tx_pin);
+    }
+    int available() override { return port.available(); }
+    int read() override { return port.read(); }
+    size_t write(const uint8_t* data, size_t len) override { return port.write(data, len); }
+    int availableForWrite() override { return port.availableForWrite(); }
+    void onReceive(SerialRxCallback callback, void* arg) override {
+        // 默认要等RX FIFO攒满120字节或超时才回调，这里改为1个字符时间无新数据即回调
+        port.setRxTimeout(1);
+        port.onReceive([callback, arg]() { callback(arg); }, false);
+    }
+};
+
+static ArduinoSerial host_serial(Serial);
+static ArduinoSerial rs485_serial(Serial1);
+
+namespace hal {
+
+HalSerial& hostSerial() { return host_serial; }
+HalSerial& rs485Serial() { return rs485_serial; }
+
+uint32_t millis() { return ::millis(); }
+uint32_t micros() { return ::micros(); }
+
+void gpioOutput(uint8_t pin) {
+    pinMode(pin, OUTPUT);
+}
+
+void gpioWrite(uint8_t pin, bool level) {
+    digitalWrite(pin, level ? HIGH : LOW);
+}
+
+static spi_device_handle_t shift_chain = nullptr;
+// 超过4字节的链走DMA，缓冲区必须在内部RAM中
+static DMA_ATTR uint8_t shift_chain_buffer[16];
+
+void shiftChainBegin(uint8_t data_pin, uint8_t clock_pin, uint8_t latch_pin, uint32_t freq) {
+    spi_bus_config_t bus_config = {};
+    bus_config.mosi_io_num = data_pin;
+    bus_config.miso_io_num = -1;
+    bus_config.sclk_io_num = clock_pin;
+    bus_config.quadwp_io_num = -1;
+    bus_config.quadhd_io_num = -1;
+    bus_config.max_transfer_sz = sizeof(shift_chain_buffer);
+    ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &bus_config, SPI_DMA_CH_AUTO));
+
+    spi_device_interface_config_t device_config = {};
+    device_config.mode = 0;
+    device_config.clock_speed_hz = static_cast<int>(freq);
+    device_config.spics_io_num = latch_pin;
+    device_config.cs_ena_posttrans = 1;   // 最后一个移位时钟之后再锁存
+    device_config.queue_size = 1;
+    ESP_ERROR_CHECK(spi_bus_add_device(SPI2_HOST, &device_config, &shift_chain));
+}
+
+void shiftChainWrite(const uint8_t* data, size_t len) {
+    if (!shift_chain || len == 0 || len > sizeof(shift_chain_buffer)) return;
+
+    spi_transaction_t transaction = {};
+    transaction.length = len * 8;
+    if (len <= sizeof(transaction.tx_data)) {
+        // 不超过4字节时直接放在事务结构中，不需要DMA
+        transaction.flags = SPI_TRANS_USE_TXDATA;
+        std::memcpy(transaction.tx_data, data, len);
+    } else {
+        std::memcpy(shift_chain_buffer, data, len);
+        transaction.tx_buffer = shift_chain_buffer;
+    }
+    // 轮询方式省去中断与任务切换，几个字节的传输比排队更快
+    spi_device_polling_transmit(shift_chain, &transaction);
+}
+
+void adcBegin(uint8_t pin) {
+    // 11dB衰减，量程约0~3.1V
+    analogSetPinAttenuation(pin, ADC_11db);
+}
+
+uint32_t adcReadMv(uint8_t pin) {
+    return analogReadMilliVolts(pin);
+}
+
+void i2cBegin(uint8_t sda_pin, uint8_t scl_pin, uint32_t freq) {
+    Wire.begin(sda_pin, scl_pin, freq);
+}
+
+bool i2cWrite(uint8_t address, const uint8_t* data, size_t len) {
+    Wire.beginTransmission(address);
+    Wire.write(data, len);
+    return Wire.endTransmission() == 0;
+}
+
+// WS2812时序（RMT计数10MHz，每tick 0.1us）：0码高0.4us低0.85us，1码高0.8us低0.45us，每位1.25us
+// 每位编码为一个RMT符号，整帧在发送期间必须保持不变
+static constexpr uint32_t LED_RMT_FREQ = 10000000;
+static constexpr rmt_data_t LED_BIT_0 = {{4, 1, 9, 0}};
+static constexpr rmt_data_t LED_BIT_1 = {{8, 1, 5, 0}};
+// 帧间复位：较新的WS2812B要求至少280us低电平
+static constexpr uint32_t LED_RESET_US = 300;
+
+static std::array<rmt_data_t, NUM_LEDS * 24> led_symbols;
+static uint8_t led_pin = 0;
+static uint32_t led_start_us = 0;
+static uint32_t led_frame_us = 0;
+
+void ledBegin(uint8_t pin) {
+    led_pin = pin;
+    rmtInit(pin, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_2, LED_RMT_FREQ);
+}
+
+bool ledBusy() {
+    return !rmtTransmitCompleted(led_pin) || micros() - led_start_us < led_frame_us;
+}
+
+bool ledShow(const LedColor* pixels, size_t count, uint8_t brightness) {
+    if (count > NUM_LEDS || ledBusy()) {
+        return false;
+    }
+    size_t symbol = 0;
+    for (size_t i = 0; i < count; i++) {
+        // WS2812的字节顺序为GRB，高位先发
+        const uint8_t channels[3] = {pixels[i].g, pixels[i].r, pixels[i].b};
+        for (const uint8_t channel : channels) {
+            const uint8_t value = scale8(channel, brightness);
+            for (int bit = 7; bit >= 0; bit--) {
+                led_symbols[symbol++] = (value >> bit) & 1 ? LED_BIT_1 : LED_BIT_0;
+            }
+        }
+    }
+    led_start_us = micros();
+    led_frame_us = count * 24 * 5 / 4 + LED_RESET_US;
+    return rmtWriteAsync(led_pin, led_symbols.data(), symbol);
+}
+
+void timerStart(uint32_t timer_freq, uint32_t alarm_ticks, TimerCallback callback, void* arg) {
+    hw_timer_t* timer = timerBegin(timer_freq);
+    timerAttachInterruptArg(timer, callback, arg);
+    timerAlarm(timer, alarm_ticks, true, 0);
+}
+
+// 固定核心的闹钟：1MHz自由运行的64位计数器，不会回绕
+static constexpr uint32_t PINNED_ALARM_FREQ = 1000000;
+
+// esp_timer闹钟只有handle；固定核心的闹钟有自己的硬件定时器与回调任务
+struct Alarm {
+    esp_timer_handle_t handle = nullptr;
+    hw_timer_t* timer = nullptr;
+    TaskHandle_t task = nullptr;
+    TaskHandle_t creator = nullptr;
+    TimerCallback callback = nullptr;
+    void* arg = nullptr;
+};
+
+static std::array<Alarm, HAL_ALARM_COUNT> alarms{};
+static size_t alarm_count = 0;
+
+// 中断只唤醒回调任务
+static void ARDUINO_ISR_ATTR pinnedAlarmIsr(void* arg) {
+    BaseType_t b_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(static_cast<Alarm*>(arg)->task, &b_woken);
+    portYIELD_FROM_ISR(b_woken);
+}
+
+// 定时器在本任务中创建，中断随之分配在任务所在的核心
+static void pinnedAlarmTask(void* param) {
+    Alarm& alarm = *static_cast<Alarm*>(param);
+    alarm.task = xTaskGetCurrentTaskHandle();
+    alarm.timer = timerBegin(PINNED_ALARM_FREQ);
+    timerAttachInterruptArg(alarm.timer, &pinnedAlarmIsr, &alarm);
+    xTaskNotifyGive(alarm.creator);
+    for (;;) {
+        // 多次唤醒合并为一次回调
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        alarm.callback(alarm.arg);
+    }
+}
+
+AlarmId alarmCreate(TimerCallback callback, void* arg, int core) {
+    assert(alarm_count < alarms.size());
+    Alarm& alarm = alarms[alarm_count];
+    alarm.callback = callback;
+    alarm.arg = arg;
+    if (core == ALARM_TIMER_TASK) {
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback = callback;
+        timer_args.arg = arg;
+        timer_args.dispatch_method = ESP_TIMER_TASK;
+        timer_args.name = "alarm";
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &alarm.handle));
+    } else {
+        // 等回调任务建好定时器再返回，之后才能alarmArm
+        alarm.creator = xTaskGetCurrentTaskHandle();
+        xTaskCreatePinnedToCore(pinnedAlarmTask, "alarm", ALARM_TASK_STACK, &alarm, ALARM_TASK_PRIORITY, nullptr, core);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    return static_cast<AlarmId>(alarm_count++);
+}
+
+void alarmArm(AlarmId id, uint32_t delay_us) {
+    Alarm& alarm = alarms[id];
+    if (alarm.timer == nullptr) {
+        // 闹钟未启动时stop返回错误，忽略即可
+        esp_timer_stop(alarm.handle);
+        esp_timer_start_once(alarm.handle, delay_us);
+        return;
+    }
+    // 闹钟值设在当前计数之后，取代尚未到期的设定；设定完成时已经到期的直接唤醒任务
+    const uint64_t target = timerRead(alarm.timer) + delay_us;
+    timerAlarm(alarm.timer, target, false, 0);
+    if (timerRead(alarm.timer) >= target) {
+        xTaskNotifyGive(alarm.task);
+    }
+}
+
+} // namespace hal
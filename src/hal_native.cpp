@@ -0,0 +1,392 @@
+#include "hal_native.hpp"
+
+#include "constants.hpp"
+
+#ifndef ARDUINO
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace hal::native {
+
+void MockSerial::begin(unsigned long baud_rate, int, int) {
+    baud = baud_rate;
+}
+
+int MockSerial::available() {
+    return static_cast<int>(input.size());
+}
+
+int MockSerial::read() {
+    if (input.empty()) return -1;
+    const uint8_t byte = input.front();
+    input.pop_front();
+    return byte;
+}
+
+size_t MockSerial::write(const uint8_t* data, size_t len) {
+    output.append(reinterpret_cast<const char*>(data), len);
+    return len;
+}
+
+void MockSerial::onReceive(SerialRxCallback callback, void* arg) {
+    rx_callback = callback;
+    rx_arg = arg;
+}
+
+// 注入后立即触发接收回调，相当于UART事件任务收到数据
+void MockSerial::inject(std::string_view data) {
+    input.insert(input.end(), data.begin(), data.end());
+    if (rx_callback) rx_callback(rx_arg);
+}
+
+void MockSerial::inject(const uint8_t* data, size_t len) {
+    input.insert(input.end(), data, data + len);
+    if (rx_callback) rx_callback(rx_arg);
+}
+
+std::string MockSerial::takeOutput() {
+    std::string res;
+    res.swap(output);
+    return res;
+}
+
+struct MockTimer {
+    uint64_t period_ns;
+    uint64_t next_ns;
+    TimerCallback callback;
+    void* arg;
+};
+
+struct SimValve {
+    SwitchValveSim config;
+    uint8_t channel;
+};
+
+struct SimReply {
+    uint64_t due_ns;
+    std::array<uint8_t, INSTR_485_LEN> frame;
+};
+
+struct MockState {
+    MockSerial host_serial;
+    MockSerial rs485_serial;
+
+    uint64_t now_ns = 0;
+    std::vector<MockTimer> timers;
+    std::vector<MockTimer> alarms;  // 单次闹钟，next_ns为UINT64_MAX表示未启动
+
+    std::array<bool, 64> pin_levels{};
+    std::array<uint64_t, 64> rising_edges{};
+    bool b_pin_logging = false;
+
+    std::vector<PinEvent> pin_log;
+    std::vector<ShiftEvent> shift_log;
+    std::vector<uint8_t> shift_chain;
+    std::vector<I2cTransfer> i2c_log;
+    std::vector<LedFrame> led_log;
+    std::vector<ValveMove> valve_log;
+
+    uint64_t led_busy_until_ns = 0;
+
+    std::vector<SimValve> sim_valves;
+    std::string rs485_rx;           // 模拟阀尚未解析的总线字节
+    std::deque<SimReply> sim_replies;
+
+    AnalogPlant plant{};
+    bool b_plant = false;
+    float plant_mv = 0;
+    uint16_t plant_code = 0;
+    uint64_t plant_update_ns = 0;
+};
+
+static MockState& state() {
+    static MockState s;
+    return s;
+}
+
+MockSerial& hostMock() { return state().host_serial; }
+MockSerial& rs485Mock() { return state().rs485_serial; }
+
+uint64_t nowNs() { return state().now_ns; }
+
+static void serviceSwitchValves();
+
+void advanceNs(uint64_t ns) {
+    MockState& s = state();
+    const uint64_t end = s.now_ns + ns;
+    for (;;) {
+        // 按时间顺序触发最早到期的定时器
+        MockTimer* next = nullptr;
+        for (auto& timer : s.timers) {
+            if (timer.next_ns <= end && (!next || timer.next_ns < next->next_ns)) {
+                next = &timer;
+            }
+        }
+        for (auto& alarm : s.alarms) {
+            if (alarm.next_ns <= end && (!next || alarm.next_ns < next->next_ns)) {
+                next = &alarm;
+            }
+        }
+        if (!next) break;
+        s.now_ns = next->next_ns;
+        if (next->period_ns == 0) {
+            next->next_ns = UINT64_MAX; // 单次闹钟，回调中可以重新设定
+        } else {
+            next->next_ns += next->period_ns;
+        }
+        next->callback(next->arg);
+    }
+    s.now_ns = end;
+    serviceSwitchValves();
+}
+
+void advanceUs(uint64_t us) {
+    advanceNs(us * 1000);
+}
+
+static void setPin(uint8_t pin, bool level) {
+    MockState& s = state();
+    if (pin >= s.pin_levels.size()) return;
+    if (level && !s.pin_levels[pin]) {
+        s.rising_edges[pin]++;
+    }
+    if (s.b_pin_logging && level != s.pin_levels[pin]) {
+        s.pin_log.push_back({s.now_ns, pin, level});
+    }
+    s.pin_levels[pin] = level;
+}
+
+bool pinLevel(uint8_t pin) { return pin < 64 && state().pin_levels[pin]; }
+uint64_t risingEdges(uint8_t pin) { return pin < 64 ? state().rising_edges[pin] : 0; }
+
+void setPinLogging(bool enable) { state().b_pin_logging = enable; }
+const std::vector<PinEvent>& pinLog() { return state().pin_log; }
+const std::vector<ShiftEvent>& shiftLog() { return state().shift_log; }
+const std::vector<uint8_t>& shiftChainOutput() { return state().shift_chain; }
+const std::vector<I2cTransfer>& i2cLog() { return state().i2c_log; }
+const std::vector<LedFrame>& ledLog() { return state().led_log; }
+const std::vector<ValveMove>& valveLog() { return state().valve_log; }
+
+// DAC码在两次更新之间不变，一阶响应可以按解析解推进
+static void advancePlant() {
+    MockState& s = state();
+    const float dt_us = (s.now_ns - s.plant_update_ns) / 1000.0f;
+    const float target = std::max(0.0f, s.plant.offset_mv + s.plant.gain_mv_per_code * s.plant_code);
+    s.plant_mv = target + (s.plant_mv - target) * std::exp(-dt_us / s.plant.tau_us);
+    s.plant_update_ns = s.now_ns;
+}
+
+void setAnalogPlant(const AnalogPlant& plant) {
+    MockState& s = state();
+    s.plant = plant;
+    s.b_plant = true;
+    s.plant_update_ns = s.now_ns;
+    s.plant_mv = std::max(0.0f, plant.offset_mv + plant.gain_mv_per_code * s.plant_code);
+}
+
+// 切换阀帧的校验和：前6字节之和，低字节在前
+static void sealSwitchFrame(std::array<uint8_t, INSTR_485_LEN>& frame) {
+    unsigned int sum = 0;
+    for (size_t i = 0; i < 6; i++) {
+        sum += frame[i];
+    }
+    frame[6] = static_cast<uint8_t>(sum % 256);
+    frame[7] = static_cast<uint8_t>(sum / 256);
+}
+
+void addSwitchValveSim(const SwitchValveSim& sim) {
+    state().sim_valves.push_back({sim, 1});
+}
+
+uint8_t switchValveSimChannel(uint8_t address) {
+    for (const auto& valve : state().sim_valves) {
+        if (valve.config.address == address) return valve.channel;
+    }
+    return 0;
+}
+
+// 解析主机发到总线上的帧，被寻址的模拟阀在延迟后应答；应答按到期时间依次注入rs485Mock()
+static void serviceSwitchValves() {
+    MockState& s = state();
+    if (s.sim_valves.empty()) return;
+
+    s.rs485_rx += s.rs485_serial.takeOutput();
+    while (s.rs485_rx.size() >= INSTR_485_LEN) {
+        if (static_cast<uint8_t>(s.rs485_rx[0]) != 0xcc) {
+            s.rs485_rx.erase(0, 1);
+            continue;
+        }
+        std::array<uint8_t, INSTR_485_LEN> request;
+        std::memcpy(request.data(), s.rs485_rx.data(), INSTR_485_LEN);
+        s.rs485_rx.erase(0, INSTR_485_LEN);
+
+        std::array<uint8_t, INSTR_485_LEN> checked = request;
+        sealSwitchFrame(checked);
+        if (checked != request || request[5] != 0xdd) continue;   // 校验失败的帧不应答
+
+        auto valve = std::find_if(s.sim_valves.begin(), s.sim_valves.end(), [&](const SimValve& v) {
+            return v.config.address == request[1];
+        });
+        if (valve == s.sim_valves.end() || valve->config.b_silent) continue;
+
+        std::array<uint8_t, INSTR_485_LEN> reply{0xcc, request[1], 0x00, 0, 0, 0xdd, 0, 0};
+        uint64_t busy_ms = valve->config.reply_ms;
+        switch (request[2]) {
+            case 0x3e:
+                reply[3] = valve->channel;
+                break;
+            case 0x44:
+                if (request[3] >= 1 && request[3] <= SWITCH_CHANNEL_COUNT) {
+                    const int distance = std::abs(request[3] - valve->channel);
+                    busy_ms += static_cast<uint64_t>(std::min(distance, SWITCH_CHANNEL_COUNT - distance))
+                             * valve->config.move_ms_per_step;
+                    s.valve_log.push_back({s.now_ns, s.now_ns + busy_ms * 1000000, request[1], valve->channel, request[3]});
+                    valve->channel = request[3];
+                } else {
+                    reply[2] = 0x02;    // 参数错误
+                }
+                break;
+            case 0x45:
+                busy_ms += static_cast<uint64_t>(valve->channel - 1) * valve->config.move_ms_per_step;
+                s.valve_log.push_back({s.now_ns, s.now_ns + busy_ms * 1000000, request[1], valve->channel, 1});
+                valve->channel = 1;
+                break;
+            default:
+                break;
+        }
+        sealSwitchFrame(reply);
+        s.sim_replies.push_back({s.now_ns + busy_ms * 1000000, reply});
+    }
+
+    while (!s.sim_replies.empty() && s.sim_replies.front().due_ns <= s.now_ns) {
+        s.rs485_serial.inject(s.sim_replies.front().frame.data(), INSTR_485_LEN);
+        s.sim_replies.pop_front();
+    }
+}
+
+void reset() {
+    MockState& s = state();
+    s.host_serial.takeOutput();
+    s.rs485_serial.takeOutput();
+    s.rs485_rx.clear();
+    s.sim_replies.clear();
+    while (s.host_serial.read() >= 0) {}
+    while (s.rs485_serial.read() >= 0) {}
+    for (auto& timer : s.timers) {
+        timer.next_ns -= std::min(timer.next_ns, s.now_ns);
+    }
+    for (auto& alarm : s.alarms) {
+        if (alarm.next_ns != UINT64_MAX) {
+            alarm.next_ns -= std::min(alarm.next_ns, s.now_ns);
+        }
+    }
+    s.led_busy_until_ns -= std::min(s.led_busy_until_ns, s.now_ns);
+    s.now_ns = 0;
+    s.plant_update_ns = 0;
+    s.pin_levels.fill(false);
+    s.rising_edges.fill(0);
+    s.pin_log.clear();
+    s.shift_log.clear();
+    s.i2c_log.clear();
+    s.led_log.clear();
+    s.valve_log.clear();
+}
+
+} // namespace hal::native
+
+namespace hal {
+
+using namespace hal::native;
+
+HalSerial& hostSerial() { return state().host_serial; }
+HalSerial& rs485Serial() { return state().rs485_serial; }
+
+uint32_t millis() { return static_cast<uint32_t>(state().now_ns / 1000000); }
+uint32_t micros() { return static_cast<uint32_t>(state().now_ns / 1000); }
+
+uint32_t cycleCount() { return static_cast<uint32_t>(state().now_ns * HOST_CPU_MHZ / 1000); }
+uint32_t cpuMhz() { return HOST_CPU_MHZ; }
+
+void gpioOutput(uint8_t) {}
+
+void gpioWrite(uint8_t pin, bool level) {
+    setPin(pin, level);
+}
+
+void gpioWriteMask(uint32_t set_mask, uint32_t clear_mask) {
+    for (uint8_t pin = 0; pin < 32; pin++) {
+        if (clear_mask & (1UL << pin)) setPin(pin, false);
+        if (set_mask & (1UL << pin)) setPin(pin, true);
+    }
+}
+
+void shiftChainBegin(uint8_t, uint8_t, uint8_t, uint32_t) {}
+
+void shiftChainWrite(const uint8_t* data, size_t len) {
+    MockState& s = state();
+    s.shift_chain.assign(data, data + len);
+    s.shift_log.push_back({s.now_ns, s.shift_chain});
+}
+
+void i2cBegin(uint8_t, uint8_t, uint32_t) {}
+
+void adcBegin(uint8_t) {}
+
+uint32_t adcReadMv(uint8_t pin) {
+    MockState& s = state();
+    if (!s.b_plant || pin != s.plant.pin) {
+        return 0;
+    }
+    advancePlant();
+    return static_cast<uint32_t>(std::lround(s.plant_mv));
+}
+
+bool i2cWrite(uint8_t address, const uint8_t* data, size_t len) {
+    MockState& s = state();
+    // MCP4725 fast write：高4位在第一个字节的低4位
+    if (s.b_plant && address == s.plant.dac_address && len == 2) {
+        advancePlant();
+        s.plant_code = static_cast<uint16_t>(((data[0] & 0x0F) << 8) | data[1]);
+    }
+    s.i2c_log.push_back({s.now_ns, address, std::vector<uint8_t>(data, data + len)});
+    return true;
+}
+
+void ledBegin(uint8_t) {}
+
+bool ledBusy() {
+    return state().now_ns < state().led_busy_until_ns;
+}
+
+bool ledShow(const LedColor* pixels, size_t count, uint8_t brightness) {
+    MockState& s = state();
+    if (ledBusy()) {
+        return false;
+    }
+    s.led_log.push_back({s.now_ns, brightness, std::vector<LedColor>(pixels, pixels + count)});
+    // 与硬件相同：每个LED 30us，另加300us复位
+    s.led_busy_until_ns = s.now_ns + (count * 30 + 300) * 1000;
+    return true;
+}
+
+void timerStart(uint32_t timer_freq, uint32_t alarm_ticks, TimerCallback callback, void* arg) {
+    const uint64_t period_ns = static_cast<uint64_t>(alarm_ticks) * 1000000000ULL / timer_freq;
+    state().timers.push_back({period_ns, state().now_ns + period_ns, callback, arg});
+}
+
+// 虚拟时钟上所有闹钟都在到期时刻准时回调，不区分核心
+AlarmId alarmCreate(TimerCallback callback, void* arg, int) {
+    state().alarms.push_back({0, UINT64_MAX, callback, arg});
+    return static_cast<AlarmId>(state().alarms.size() - 1);
+}
+
+void alarmArm(AlarmId alarm, uint32_t delay_us) {
+    state().alarms[alarm].next_ns = state().now_ns + static_cast<uint64_t>(delay_us) * 1000;
+}
+
+} // namespace hal
+
+#endif
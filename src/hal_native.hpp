@@ -0,0 +1,134 @@
+#pragma once
+
+// 主机端模拟HAL的控制接口，仅在env:native中可用
+// 记录所有引脚、移位寄存器、I2C、WS2812与串口流量，时间由虚拟时钟推进
+
+#ifndef ARDUINO
+
+#include "hal.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hal::native {
+
+// 记录输出、可注入输入的模拟串口
+class MockSerial : public HalSerial {
+private:
+    std::deque<uint8_t> input;
+    std::string output;
+    unsigned long baud = 0;
+    SerialRxCallback rx_callback = nullptr;
+    void* rx_arg = nullptr;
+
+public:
+    void begin(unsigned long baud_rate, int rx_pin, int tx_pin) override;
+    int available() override;
+    int read() override;
+    size_t write(const uint8_t* data, size_t len) override;
+    // 模拟串口不会阻塞
+    int availableForWrite() override { return 4096; }
+    void onReceive(SerialRxCallback callback, void* arg) override;
+
+    // 注入待读取的数据
+    void inject(std::string_view data);
+    void inject(const uint8_t* data, size_t len);
+    // 取出并清空已写出的数据
+    std::string takeOutput();
+    const std::string& peekOutput() const { return output; }
+    unsigned long baudRate() const { return baud; }
+};
+
+MockSerial& hostMock();
+MockSerial& rs485Mock();
+
+struct PinEvent {
+    uint64_t time_ns;
+    uint8_t pin;
+    bool level;
+};
+
+// 一次锁存的74HC595链数据，bytes[0]最先移出
+struct ShiftEvent {
+    uint64_t time_ns;
+    std::vector<uint8_t> bytes;
+};
+
+struct I2cTransfer {
+    uint64_t time_ns;
+    uint8_t address;
+    std::vector<uint8_t> data;
+};
+
+// 一阶被控对象：模拟输入引脚的电压以时间常数tau_us趋近 offset_mv + gain_mv_per_code * DAC码，
+// DAC码取自最近一次写入dac_address的MCP4725 fast write，用于在主机上测试压强闭环
+struct AnalogPlant {
+    uint8_t pin;
+    uint8_t dac_address;
+    float gain_mv_per_code;
+    float offset_mv;
+    float tau_us;
+};
+
+// 485总线上的模拟切换阀：按帧中的地址应答，多台阀共用rs485Mock()，用于在主机上测试多设备调度与位置缓存
+// 查询通道（0x3E）回复当前通道，切换（0x44）转到位后才应答，复位（0x45）回到通道1
+struct SwitchValveSim {
+    uint8_t address;
+    uint32_t reply_ms;          // 收到帧到开始应答的延迟
+    uint32_t move_ms_per_step;  // 每转过一个通道的时间，按较短的方向转动
+    bool b_silent;              // 不应答，用于测试超时与离线
+};
+
+// 模拟切换阀的一次转动：time_ns收到指令开始转动，arrive_ns转到位并应答
+struct ValveMove {
+    uint64_t time_ns;
+    uint64_t arrive_ns;
+    uint8_t address;
+    uint8_t from;
+    uint8_t to;
+};
+
+struct LedFrame {
+    uint64_t time_ns;
+    uint8_t brightness;
+    std::vector<LedColor> pixels;
+};
+
+// 虚拟时钟：推进时间并按周期触发定时器回调
+uint64_t nowNs();
+void advanceNs(uint64_t ns);
+void advanceUs(uint64_t us);
+
+// 引脚状态与上升沿计数（步进脉冲计数不依赖事件日志）
+bool pinLevel(uint8_t pin);
+uint64_t risingEdges(uint8_t pin);
+
+// 设定一阶被控对象，未设定的模拟输入引脚读数为0
+void setAnalogPlant(const AnalogPlant& plant);
+
+// 在485总线上挂一台模拟切换阀（初始位于通道1），没有挂接时rs485Mock()的输出保持不动
+void addSwitchValveSim(const SwitchValveSim& sim);
+// 模拟切换阀当前所在的通道，地址不存在时为0
+uint8_t switchValveSimChannel(uint8_t address);
+
+// 74HC595链当前锁存的数据
+const std::vector<uint8_t>& shiftChainOutput();
+
+// 事件日志，引脚日志默认关闭以免步进脉冲占满内存
+void setPinLogging(bool enable);
+const std::vector<PinEvent>& pinLog();
+const std::vector<ShiftEvent>& shiftLog();
+const std::vector<I2cTransfer>& i2cLog();
+const std::vector<LedFrame>& ledLog();
+const std::vector<ValveMove>& valveLog();
+
+// 清空日志、计数与时钟（不移除已启动的定时器）
+void reset();
+
+} // namespace hal::native
+
+#endif
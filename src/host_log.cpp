@@ -0,0 +1,155 @@
+#include "host_log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static HostLog host_log(hal::hostSerial());
+
+HostLog& hostLog() { return host_log; }
+
+HostLog::HostLog(HalSerial& serial) : port(serial) {
+    head = 0;
+    tail = 0;
+    line_len = 0;
+    line_level = LogLevel::INFO;
+    tx_len = 0;
+    tx_pos = 0;
+    min_level = LogLevel::DEBUG;
+    policy = LogDropPolicy::DROP_NEWEST;
+    stats = {};
+}
+
+void HostLog::ringWrite(const void* data, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const size_t offset = tail & (LOG_BUFFER_LEN - 1);
+    const size_t first = std::min(len, LOG_BUFFER_LEN - offset);
+    std::memcpy(ring.data() + offset, bytes, first);
+    std::memcpy(ring.data(), bytes + first, len - first);
+    tail += len;
+}
+
+void HostLog::ringRead(void* data, size_t len) {
+    uint8_t* bytes = static_cast<uint8_t*>(data);
+    const size_t offset = head & (LOG_BUFFER_LEN - 1);
+    const size_t first = std::min(len, LOG_BUFFER_LEN - offset);
+    std::memcpy(bytes, ring.data() + offset, first);
+    std::memcpy(bytes + first, ring.data(), len - first);
+    head += len;
+}
+
+bool HostLog::enqueue(LogLevel level, bool b_frame, const uint8_t* data, size_t len) {
+    const size_t needed = sizeof(RecordHeader) + len;
+    const RecordHeader header {
+        .len = static_cast<uint16_t>(len),
+        .level = level,
+        .b_frame = b_frame,
+        .time_ms = hal::millis(),
+    };
+
+    lock.lock();
+    if (policy == LogDropPolicy::DROP_OLDEST) {
+        while (LOG_BUFFER_LEN - (tail - head) < needed && tail != head) {
+            RecordHeader oldest;
+            ringRead(&oldest, sizeof(oldest));
+            head += oldest.len;
+            stats.dropped++;
+        }
+    }
+    const bool b_fits = LOG_BUFFER_LEN - (tail - head) >= needed;
+    if (b_fits) {
+        ringWrite(&header, sizeof(header));
+        ringWrite(data, len);
+        stats.queued++;
+        stats.high_water = std::max(stats.high_water, tail - head);
+    } else {
+        stats.dropped++;
+    }
+    lock.unlock();
+    return b_fits;
+}
+
+void HostLog::commitLine() {
+    if (line_len == 0) {
+        return;
+    }
+    if (line_level < min_level) {
+        lock.lock();
+        stats.filtered++;
+        lock.unlock();
+    } else {
+        enqueue(line_level, false, line.data(), line_len);
+    }
+    line_len = 0;
+    line_level = LogLevel::INFO;
+}
+
+size_t HostLog::write(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        line[line_len++] = data[i];
+        // 超长的行按LOG_LINE_MAX拆成多条记录
+        if (data[i] == '\n' || line_len == line.size()) {
+            commitLine();
+        }
+    }
+    return len;
+}
+
+HostLog& HostLog::at(LogLevel level) {
+    line_level = level;
+    return *this;
+}
+
+bool HostLog::writeFrame(const uint8_t* data, size_t len) {
+    if (len > LOG_RECORD_MAX) {
+        return false;
+    }
+    return enqueue(LogLevel::ERROR, true, data, len);
+}
+
+size_t HostLog::freeSpace() {
+    lock.lock();
+    const size_t free_bytes = LOG_BUFFER_LEN - (tail - head);
+    lock.unlock();
+    return (free_bytes > sizeof(RecordHeader)) ? free_bytes - sizeof(RecordHeader) : 0;
+}
+
+void HostLog::drain() {
+    for (;;) {
+        if (tx_pos == tx_len) {
+            RecordHeader header;
+            lock.lock();
+            if (head == tail) {
+                lock.unlock();
+                return;
+            }
+            ringRead(&header, sizeof(header));
+            ringRead(tx_buffer.data(), header.len);
+            if (hal::millis() - header.time_ms > LOG_DELAY_MS) {
+                stats.delayed++;
+            }
+            lock.unlock();
+            tx_len = header.len;
+            tx_pos = 0;
+        }
+
+        const int room = port.availableForWrite();
+        if (room <= 0) {
+            return;
+        }
+        const size_t chunk = std::min(static_cast<size_t>(room), tx_len - tx_pos);
+        port.write(tx_buffer.data() + tx_pos, chunk);
+        tx_pos += chunk;
+        if (tx_pos == tx_len) {
+            lock.lock();
+            stats.sent++;
+            lock.unlock();
+        }
+    }
+}
+
+LogStats HostLog::statistics() {
+    lock.lock();
+    const LogStats res = stats;
+    lock.unlock();
+    return res;
+}
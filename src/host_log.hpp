@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "hal.hpp"
+
+// 日志级别，低于当前级别的文本行直接丢弃
+enum class LogLevel : uint8_t {
+    DEBUG = 0,
+    INFO = 1,
+    WARN = 2,
+    ERROR = 3
+};
+
+// 队列满时的处理方式
+enum class LogDropPolicy : uint8_t {
+    DROP_NEWEST = 0,    // 丢弃新记录
+    DROP_OLDEST = 1     // 丢弃最早的尚未开始发送的记录，腾出空间给新记录
+};
+
+struct LogStats {
+    uint32_t queued;        // 入队记录数
+    uint32_t sent;          // 发送完成的记录数
+    uint32_t dropped;       // 因队列满被丢弃
+    uint32_t filtered;      // 因级别过低被丢弃
+    uint32_t delayed;       // 入队后超过LOG_DELAY_MS才开始发送
+    size_t high_water;      // 队列最高占用字节数
+};
+
+// 上位机输出队列：所有回复、日志和二进制帧先进入定长环形缓冲区，
+// 由指令核心在串口发送缓冲区有空间时分批写出，调用者永远不会因为串口阻塞
+//
+// 文本按行入队：print系列写入当前行，遇到'\n'时整行作为一条记录提交，丢弃也以整行为单位
+// 当前行只能由指令核心拼接；环形缓冲区本身由自旋锁保护，入队和出队只在锁内拷贝
+class HostLog : public HalPrint {
+private:
+    struct RecordHeader {
+        uint16_t len;
+        LogLevel level;
+        uint8_t b_frame;
+        uint32_t time_ms;
+    };
+
+    HalSerial& port;
+    hal::SpinLock lock;
+
+    std::array<uint8_t, LOG_BUFFER_LEN> ring;
+    size_t head;    // 单调递增的字节序号，取模后为下标
+    size_t tail;
+
+    // 正在拼接的一行
+    std::array<uint8_t, LOG_LINE_MAX> line;
+    size_t line_len;
+    LogLevel line_level;
+
+    // 正在发送的记录，整条从环形缓冲区取出，保证丢弃最早记录时不会截断发送中的数据
+    std::array<uint8_t, LOG_RECORD_MAX> tx_buffer;
+    size_t tx_len;
+    size_t tx_pos;
+
+    LogLevel min_level;
+    LogDropPolicy policy;
+    LogStats stats;
+
+    void ringWrite(const void* data, size_t len);
+    void ringRead(void* data, size_t len);
+    bool enqueue(LogLevel level, bool b_frame, const uint8_t* data, size_t len);
+    void commitLine();
+
+public:
+    explicit HostLog(HalSerial& serial);
+
+    size_t write(const uint8_t* data, size_t len) override;
+
+    // 设置当前行的级别，提交后恢复为INFO
+    // 用法：hostLog().at(LogLevel::WARN).println("...");
+    HostLog& at(LogLevel level);
+
+    // 二进制帧（已COBS编码、含分隔符）整帧入队，不受级别过滤
+    bool writeFrame(const uint8_t* data, size_t len);
+    // 还能容纳的记录数据字节数
+    size_t freeSpace();
+
+    // 指令核心调用，写出发送缓冲区能容纳的数据
+    void drain();
+
+    void setLevel(LogLevel level) { min_level = level; }
+    LogLevel level() const { return min_level; }
+    void setDropPolicy(LogDropPolicy drop_policy) { policy = drop_policy; }
+    LogDropPolicy dropPolicy() const { return policy; }
+    LogStats statistics();
+};
+
+HostLog& hostLog();
@@ -0,0 +1,182 @@
+// 主机端入口（env:native），用模拟HAL运行与板上相同的固件逻辑
+// 从stdin逐行读取指令，按虚拟时钟推进，把主机串口输出写到stdout
+// 两个核心的任务在这里按顺序轮流执行，不等待真实时间，整段脚本以远快于实时的速度重放
+//
+// 脚本中除了指令还可以写：
+//   # 注释
+//   @wait 1500   推进1500ms虚拟时间
+//   @idle        一直运行到电机、配方、切换阀、电磁阀、压强与LED动画全部空闲
+// 参数：--trace 文件（执行器轨迹CSV，- 为stdout）、--rs485-reply-ms N、--valve-step-ms N、--interval N（每条指令后推进的ms）
+// pio test -e native时main()由test/test_native提供，本文件不参与编译
+
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+
+#include "constants.hpp"
+#include "ctrl_board_manager.hpp"
+#include "hal_native.hpp"
+#include "host_log.hpp"
+#include "instrumentation.hpp"
+#include "misc.hpp"
+#include "sim_trace.hpp"
+#include "step_engine.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+static StepEngine step_engine;
+static CtrlBoardManager manager(step_engine);
+static ActuatorTrace trace(step_engine);
+static bool b_trace = false;
+
+// 运行一毫秒虚拟时间，对应板上两个任务各自的一次循环
+static void runOneMs() {
+    static instr::IntervalMeter loop_meter;
+    hal::native::advanceUs(1000);
+    loop_meter.tick(instr::histograms().loop_period);
+    manager.maintainMotor();
+
+    manager.hostRx().wait(0);
+    procSerialCommand(manager);
+    manager.procMotionEvents();
+    manager.maintainSwitch();
+    manager.maintainRecipe();
+    manager.maintainFlow();
+    manager.maintainTelemetry();
+    manager.maintainLight();
+
+    hostLog().drain();
+
+    const std::string output = hal::native::hostMock().takeOutput();
+    if (!output.empty()) {
+        std::fwrite(output.data(), 1, output.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (b_trace) {
+        trace.poll();
+    }
+}
+
+// 没有任何进行中的动作，脚本的@idle和输入结束后都以此为准
+static bool boardIdle() {
+    return manager.motionIdle() && manager.recipeRunner().state() != RecipeState::RUNNING && !manager.switchBusy()
+        && !manager.solenoidBusy() && !manager.pressureBusy() && !manager.lightEngine().busy();
+}
+
+static void runUntilIdle() {
+    // 先跑一次，让排队的指令生效
+    do {
+        runOneMs();
+    } while (!boardIdle());
+}
+
+int main(int argc, char** argv) {
+    const char* trace_path = nullptr;
+    uint32_t rs485_reply_ms = 20;
+    uint32_t valve_step_ms = 150;
+    long interval_ms = INTERVAL;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (i + 1 < argc && arg == "--trace") {
+            trace_path = argv[++i];
+        } else if (i + 1 < argc && arg == "--rs485-reply-ms") {
+            rs485_reply_ms = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && arg == "--valve-step-ms") {
+            valve_step_ms = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && arg == "--interval") {
+            interval_ms = std::strtol(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "用法：%s [--trace 文件] [--rs485-reply-ms 20] [--valve-step-ms 150] [--interval %ld] < 脚本\n",
+                         argv[0], INTERVAL);
+            return 2;
+        }
+    }
+    b_trace = (trace_path != nullptr);
+
+    // 模拟比例阀与压强传感器：最大压强100kPa的阀实际只达到92%，开启压力约2kPa，一阶时间常数40ms
+    // 传感器电压按板型描述中的标定换算，开环输出有明显的静差，闭环应能消除
+    if constexpr (BOARD.pressure_sensor.b_present) {
+        constexpr auto& sensor = BOARD.pressure_sensor;
+        constexpr float valve_kpa_per_code = 0.92f * 100 / 4096;
+        constexpr float sensor_mv_per_kpa = (sensor.full_mv - sensor.zero_mv) / sensor.full_kpa;
+        hal::native::setAnalogPlant({
+            .pin = sensor.pin,
+            .dac_address = BOARD.dac.address,
+            .gain_mv_per_code = valve_kpa_per_code * sensor_mv_per_kpa,
+            .offset_mv = sensor.zero_mv - 2 * sensor_mv_per_kpa,
+            .tau_us = 40000,
+        });
+    }
+    // 模拟485总线上的各台切换阀：默认应答延迟20ms，每转过一个通道150ms
+    for (size_t i = 0; i < SWITCH_VALVE_COUNT; i++) {
+        hal::native::addSwitchValveSim({
+            .address = BOARD.switch_valve.valves[i].address,
+            .reply_ms = rs485_reply_ms,
+            .move_ms_per_step = valve_step_ms,
+            .b_silent = false,
+        });
+    }
+    manager.init();
+    hostLog().println("系统已启动");
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        if (line.starts_with("@wait ")) {
+            const long wait_ms = std::strtol(line.c_str() + 6, nullptr, 10);
+            for (long i = 0; i < wait_ms; i++) {
+                runOneMs();
+            }
+            continue;
+        }
+        if (line == "@idle") {
+            runUntilIdle();
+            continue;
+        }
+        line += '\n';
+        hal::native::hostMock().inject(line);
+        // 给每条指令留出一个解析周期
+        for (long i = 0; i < interval_ms; i++) {
+            runOneMs();
+        }
+    }
+
+    // 输入结束后继续运行，直到配方结束、电机停止、切换阀应答、电磁阀脉冲、压强斜坡和LED动画结束
+    runUntilIdle();
+    for (long i = 0; i < interval_ms; i++) {
+        runOneMs();
+    }
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    std::printf("\n[host] 虚拟时间 %.3f s，", hal::native::nowNs() / 1e9);
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        std::printf("%.*s %ld 步，", static_cast<int>(AXIS_REGISTRY[i].name.size()), AXIS_REGISTRY[i].name.data(),
+                    step_engine.currentPosition(static_cast<StepAxisId>(i)));
+    }
+    std::printf("595输出 %zu 次，I2C写入 %zu 次，LED帧 %zu 帧\n",
+                hal::native::shiftLog().size(),
+                hal::native::i2cLog().size(),
+                hal::native::ledLog().size());
+    const double virtual_s = hal::native::nowNs() / 1e9;
+    std::printf("[host] 实际用时 %.3f s，%.0f 倍速\n", wall_s, wall_s > 0 ? virtual_s / wall_s : 0.0);
+
+    if (b_trace) {
+        std::FILE* file = (std::string_view(trace_path) == "-") ? stdout : std::fopen(trace_path, "w");
+        if (!file) {
+            std::fprintf(stderr, "无法写入轨迹文件 %s\n", trace_path);
+            return 1;
+        }
+        trace.write(file);
+        if (file != stdout) {
+            std::fclose(file);
+            std::printf("[host] 执行器轨迹 %zu 条，已写入 %s\n", trace.size(), trace_path);
+        }
+    }
+    return 0;
+}
+
+#endif
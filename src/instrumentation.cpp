@@ -0,0 +1,62 @@
+#include "instrumentation.hpp"
+
+#include "host_log.hpp"
+
+#include <format>
+#include <string>
+
+namespace instr {
+
+static void dumpOne(std::string_view name, Histogram& histogram, bool b_reset) {
+    const float mhz = static_cast<float>(hal::cpuMhz());
+    const uint32_t count = histogram.samples();
+    if (count > 0) {
+        std::string msg_str = std::format(
+            "{}: n={} min={:.2f}us avg={:.2f}us max={:.2f}us\n",
+            name,
+            count,
+            histogram.minCycles() / mhz,
+            static_cast<float>(histogram.sumCycles()) / count / mhz,
+            histogram.maxCycles() / mhz
+        );
+        hostLog().print(msg_str);
+        // 只打印非空的桶，按桶的周期上界换算为微秒
+        msg_str.clear();
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            if (histogram.bucket(i) == 0) continue;
+            if (i + 1 < HISTOGRAM_BUCKETS) {
+                msg_str += std::format(" <{:.2f}us:{}", (1ULL << i) / mhz, histogram.bucket(i));
+            } else {
+                msg_str += std::format(" >={:.2f}us:{}", (1ULL << (i - 1)) / mhz, histogram.bucket(i));
+            }
+        }
+        msg_str += '\n';
+        hostLog().print(msg_str);
+    }
+    if (b_reset) {
+        histogram.reset();
+    }
+}
+
+void dumpHistograms(std::span<const std::string_view> verb_names, bool b_reset) {
+    if constexpr (!INSTRUMENTATION_ENABLED) {
+        hostLog().at(LogLevel::WARN).println("性能统计未编译进固件（INSTRUMENTATION=0）");
+        return;
+    }
+    Histograms& set = histograms();
+    dumpOne("loop", set.loop_period, b_reset);
+    dumpOne("motor", set.motor_interval, b_reset);
+    dumpOne("step_jitter", set.step_jitter, b_reset);
+    dumpOne("rs485", set.rs485_transaction, b_reset);
+    dumpOne("i2c", set.i2c_write, b_reset);
+    dumpOne("valve", set.valve_latency, b_reset);
+    for (size_t i = 0; i < verb_names.size() && i < VERB_SLOTS; i++) {
+        std::string name = std::format("verb {}", verb_names[i]);
+        dumpOne(name, set.verbs[i], b_reset);
+    }
+    if (b_reset) {
+        hostLog().println("统计已清零");
+    }
+}
+
+} // namespace instr
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "constants.hpp"
+#include "hal.hpp"
+
+// 热路径性能统计：用CPU周期计数器打时间戳，记录到固定桶的直方图
+// INSTRUMENTATION_ENABLED为false时所有记录函数都是空的内联函数，编译后不产生任何代码
+namespace instr {
+
+// 以2为底的对数分桶：桶0为0周期，桶i记录[2^(i-1), 2^i)周期，最后一个桶收纳更大的值
+constexpr size_t HISTOGRAM_BUCKETS = 32;
+
+// 每个直方图只有一个写入者（一个核心或中断），diag读取与清零时不加锁，统计值允许有少量偏差
+class Histogram {
+private:
+    std::array<uint32_t, HISTOGRAM_BUCKETS> buckets{};
+    uint32_t count = 0;
+    uint32_t min_cycles = UINT32_MAX;
+    uint32_t max_cycles = 0;
+    uint64_t sum_cycles = 0;
+
+public:
+    __attribute__((always_inline)) inline void record(uint32_t cycles) {
+        const size_t bucket = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles);
+        buckets[bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1]++;
+        count++;
+        sum_cycles += cycles;
+        if (cycles < min_cycles) min_cycles = cycles;
+        if (cycles > max_cycles) max_cycles = cycles;
+    }
+
+    void reset() { *this = Histogram{}; }
+
+    uint32_t samples() const { return count; }
+    uint32_t minCycles() const { return count ? min_cycles : 0; }
+    uint32_t maxCycles() const { return max_cycles; }
+    uint64_t sumCycles() const { return sum_cycles; }
+    uint32_t bucket(size_t index) const { return buckets[index]; }
+};
+
+// 每个指令动词一个直方图，先是AXIS_REGISTRY中的各轴，之后与CtrlBoardManager::verb_table一致
+constexpr size_t VERB_SLOTS = 16;
+
+struct Histograms {
+    Histogram loop_period;          // 指令任务循环周期
+    Histogram motor_interval;       // maintainMotor两次调用的间隔
+    Histogram step_jitter;          // 步进中断实际触发时刻与理想周期的偏差
+    Histogram rs485_transaction;    // 485从发送到收到应答/超时
+    Histogram i2c_write;            // 一次I2C写入
+    Histogram valve_latency;        // 电磁阀定时切换相对计划时刻的延迟
+    std::array<Histogram, VERB_SLOTS> verbs;    // 各动词的处理时间
+};
+
+// 步进中断也会写入，定义为内联变量，取地址不需要经过函数调用
+inline Histograms histogram_set;
+
+__attribute__((always_inline)) inline Histograms& histograms() { return histogram_set; }
+
+__attribute__((always_inline)) inline uint32_t now() {
+    if constexpr (INSTRUMENTATION_ENABLED) {
+        return hal::cycleCount();
+    } else {
+        return 0;
+    }
+}
+
+// 记录从start到现在的周期数
+__attribute__((always_inline)) inline void recordSince(Histogram& histogram, uint32_t start) {
+    if constexpr (INSTRUMENTATION_ENABLED) {
+        histogram.record(hal::cycleCount() - start);
+    }
+}
+
+// 记录相邻两次tick()之间的间隔，第一次调用只打时间戳
+class IntervalMeter {
+private:
+    uint32_t last = 0;
+    bool b_started = false;
+
+public:
+    __attribute__((always_inline)) inline void tick(Histogram& histogram) {
+        if constexpr (INSTRUMENTATION_ENABLED) {
+            const uint32_t stamp = hal::cycleCount();
+            if (b_started) {
+                histogram.record(stamp - last);
+            }
+            last = stamp;
+            b_started = true;
+        }
+    }
+};
+
+// 记录每次tick()相对固定周期的偏差（绝对值）
+class JitterMeter {
+private:
+    uint32_t last = 0;
+    uint32_t period_cycles = 0;
+    bool b_started = false;
+
+public:
+    void setPeriod(uint32_t cycles) { period_cycles = cycles; }
+
+    __attribute__((always_inline)) inline void tick(Histogram& histogram) {
+        if constexpr (INSTRUMENTATION_ENABLED) {
+            const uint32_t stamp = hal::cycleCount();
+            if (b_started) {
+                const int32_t deviation = static_cast<int32_t>(stamp - last - period_cycles);
+                histogram.record(deviation >= 0 ? deviation : -deviation);
+            }
+            last = stamp;
+            b_started = true;
+        }
+    }
+};
+
+// 把直方图打印到上位机输出，verb_names与verbs按下标对应，b_reset为true时打印后清零
+void dumpHistograms(std::span<const std::string_view> verb_names, bool b_reset);
+
+} // namespace instr
@@ -0,0 +1,173 @@
+#include "led_engine.hpp"
+
+#include <algorithm>
+
+LedEngine::LedEngine() {
+    pixels.fill(LedColor(0, 0, 0));
+    frame.fill(LedColor(0, 0, 0));
+    brightness = 200;
+    b_on = false;
+    b_dirty = false;
+    b_dark_sent = true;     // 上电时LED本来就是灭的
+    animation_start = 0;
+    animation_state = 0;
+    frames = 0;
+    updates = 0;
+}
+
+void LedEngine::begin() {
+    hal::ledBegin(BOARD.led.pin);
+    fill(LED_CENTER_MASK, LedColor(255, 255, 255));
+}
+
+void LedEngine::invalidate() {
+    updates++;
+    b_dirty = true;
+}
+
+void LedEngine::fill(LedMask mask, LedColor color) {
+    for (size_t i = 0; i < NUM_LEDS; i++) {
+        if (mask & (1ULL << i)) {
+            pixels[i] = color;
+        }
+    }
+    invalidate();
+}
+
+bool LedEngine::setPixel(size_t index, LedColor color) {
+    if (index >= NUM_LEDS) {
+        return false;
+    }
+    pixels[index] = color;
+    invalidate();
+    return true;
+}
+
+void LedEngine::setBrightness(uint8_t value) {
+    brightness = value;
+    invalidate();
+}
+
+void LedEngine::setOn(bool b_enable) {
+    b_on = b_enable;
+    if (b_on) {
+        b_dark_sent = false;
+    }
+    invalidate();
+}
+
+bool LedEngine::animate(const LedAnimation& new_animation) {
+    const bool b_valid = (new_animation.mask & LED_MASK_ALL) != 0 && new_animation.on_ms > 0
+                         && new_animation.on_ms <= LED_ANIMATION_MAX_MS && new_animation.off_ms <= LED_ANIMATION_MAX_MS
+                         && (new_animation.type != LedAnimationType::BREATHE || new_animation.on_ms >= 2 * LED_FRAME_MS);
+    if (new_animation.type == LedAnimationType::NONE || !b_valid) {
+        return false;
+    }
+    animation = new_animation;
+    animation.mask &= LED_MASK_ALL;
+    animation_start = hal::millis();
+    animationState(0, animation_state);
+    invalidate();
+    return true;
+}
+
+void LedEngine::stopAnimation() {
+    if (animation.type != LedAnimationType::NONE) {
+        animation.type = LedAnimationType::NONE;
+        invalidate();
+    }
+}
+
+bool LedEngine::animationState(uint32_t elapsed, uint32_t& state) const {
+    switch (animation.type) {
+        case LedAnimationType::BLINK: {
+            const uint32_t period = animation.on_ms + animation.off_ms;
+            if (animation.cycles != 0 && elapsed / period >= animation.cycles) return false;
+            state = (elapsed % period < animation.on_ms) ? 1 : 0;
+            return true;
+        }
+        case LedAnimationType::BREATHE: {
+            if (animation.cycles != 0 && elapsed / animation.on_ms >= animation.cycles) return false;
+            // 连续变化，按帧间隔取样；状态为0~255的亮度
+            const uint32_t sampled = elapsed - elapsed % LED_FRAME_MS;
+            const uint32_t phase = sampled % animation.on_ms;
+            const uint32_t half = animation.on_ms / 2;
+            const uint32_t level = (phase < half) ? phase * 255 / half : (animation.on_ms - phase) * 255 / (animation.on_ms - half);
+            state = std::min<uint32_t>(level, 255);
+            return true;
+        }
+        case LedAnimationType::CHASE: {
+            const uint32_t count = __builtin_popcountll(animation.mask);
+            const uint32_t step = elapsed / animation.on_ms;
+            if (animation.cycles != 0 && step / count >= animation.cycles) return false;
+            state = step % count;
+            return true;
+        }
+        case LedAnimationType::NONE:
+            break;
+    }
+    return false;
+}
+
+void LedEngine::render() {
+    if (!b_on) {
+        frame.fill(LedColor(0, 0, 0));
+        return;
+    }
+    frame = pixels;
+    if (animation.type == LedAnimationType::NONE) {
+        return;
+    }
+
+    uint32_t lit_index = 0;      // CHASE：区域内的序号
+    for (size_t i = 0; i < NUM_LEDS; i++) {
+        if (!(animation.mask & (1ULL << i))) {
+            continue;
+        }
+        const LedColor color = pixels[i];
+        switch (animation.type) {
+            case LedAnimationType::BLINK:
+                frame[i] = animation_state ? color : LedColor(0, 0, 0);
+                break;
+            case LedAnimationType::BREATHE:
+                frame[i] = LedColor(color.r * animation_state / 255, color.g * animation_state / 255,
+                                    color.b * animation_state / 255);
+                break;
+            case LedAnimationType::CHASE:
+                frame[i] = (lit_index++ == animation_state) ? color : LedColor(0, 0, 0);
+                break;
+            case LedAnimationType::NONE:
+                break;
+        }
+    }
+}
+
+void LedEngine::maintain() {
+    if (animation.type != LedAnimationType::NONE) {
+        uint32_t state = 0;
+        if (!animationState(hal::millis() - animation_start, state)) {
+            // 播放结束，恢复底图
+            animation.type = LedAnimationType::NONE;
+            invalidate();
+        } else if (state != animation_state) {
+            animation_state = state;
+            invalidate();
+        }
+    }
+
+    if (!b_dirty || hal::ledBusy()) {
+        return;
+    }
+    b_dirty = false;
+    // 关闭期间的修改只更新底图，不重复发送全黑帧
+    if (!b_on && b_dark_sent) {
+        return;
+    }
+    render();
+    if (hal::ledShow(frame.data(), frame.size(), brightness)) {
+        frames++;
+        b_dark_sent = !b_on;
+    } else {
+        b_dirty = true;
+    }
+}
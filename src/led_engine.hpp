@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "hal.hpp"
+
+enum class LedAnimationType : uint8_t {
+    NONE = 0,
+    BLINK = 1,      // 区域整体亮on_ms、灭off_ms
+    BREATHE = 2,    // 区域亮度在on_ms周期内线性渐亮再渐暗
+    CHASE = 3       // 区域内的LED按编号依次单独点亮，每个亮on_ms
+};
+
+// 动画只作用于mask中的LED，以它们在底图中的颜色闪烁、渐变或依次点亮，其余LED显示底图
+struct LedAnimation {
+    LedAnimationType type = LedAnimationType::NONE;
+    LedMask mask = 0;
+    uint32_t on_ms = 0;
+    uint32_t off_ms = 0;
+    uint32_t cycles = 0;    // 播放次数（CHASE为走完区域的遍数），0为循环
+};
+
+// WS2812光源：底图帧缓冲 + 一个定时动画，由指令核心每毫秒推进
+// 只在画面变化（脏）且上一帧发送完毕时编码发送，发送由RMT在后台完成，不阻塞任何任务
+// 发送期间的多次修改合并为一帧；关闭光源时发送全黑帧，底图保留
+class LedEngine {
+private:
+    std::array<LedColor, NUM_LEDS> pixels;  // 底图
+    std::array<LedColor, NUM_LEDS> frame;   // 合成后待发送的画面
+    uint8_t brightness;
+    bool b_on;
+    bool b_dirty;
+    bool b_dark_sent;       // 关闭后已发送过全黑帧
+
+    LedAnimation animation;
+    uint32_t animation_start;
+    uint32_t animation_state;   // 当前动画输出的摘要，变化时重绘
+
+    uint32_t frames;        // 已发送的帧数
+    uint32_t updates;       // 画面变化次数，多于frames的部分被合并
+
+    void invalidate();
+    // 按经过的时间计算动画状态，动画结束时返回false
+    bool animationState(uint32_t elapsed, uint32_t& state) const;
+    void render();
+
+public:
+    LedEngine();
+
+    void begin();
+
+    void fill(LedMask mask, LedColor color);
+    bool setPixel(size_t index, LedColor color);
+    void setBrightness(uint8_t value);
+    void setOn(bool b_enable);
+    // 参数无效时返回false；新动画取代正在播放的动画
+    bool animate(const LedAnimation& new_animation);
+    void stopAnimation();
+
+    // 指令核心每毫秒调用
+    void maintain();
+
+    uint8_t currentBrightness() const { return brightness; }
+    bool isOn() const { return b_on; }
+    LedAnimationType animationType() const { return animation.type; }
+    // 有限次数的动画尚未结束
+    bool busy() const { return animation.type != LedAnimationType::NONE && animation.cycles != 0; }
+    uint32_t frameCount() const { return frames; }
+    uint32_t updateCount() const { return updates; }
+};
@@ -1,31 +1,58 @@
 #include <Arduino.h>
-#include <AccelStepper.h>
 
 #include "constants.hpp"
 #include "ctrl_board_manager.hpp"
+#include "hal.hpp"
+#include "host_log.hpp"
+#include "instrumentation.hpp"
 #include "misc.hpp"
+#include "step_engine.hpp"
 
 
-static AccelStepper stepper(AccelStepper::DRIVER, STEP_PIN, DIR_PIN);
-static AccelStepper stepper_pp(AccelStepper::DRIVER, P_STEP, P_DIR);
+static StepEngine step_engine;
 
-static CtrlBoardManager manager(&stepper, &stepper_pp);
+static CtrlBoardManager manager(step_engine);
 
-unsigned long previous_millis = 0;
+// 运动核心：执行运动指令，步进脉冲由同核的定时器中断产生，电磁阀由同核的闹钟任务按计划时刻切换
+static void motionTask(void* param) {
+    for (;;) {
+        manager.maintainMotor();
+        vTaskDelay(1);
+    }
+}
+
+// 指令核心：串口解析、日志输出、485与WS2812等总线I/O
+static void commandTask(void* param) {
+    instr::IntervalMeter loop_meter;
+    for (;;) {
+        loop_meter.tick(instr::histograms().loop_period);
+        // 收到完整的一行或一帧时立即被唤醒，否则每1ms推进一次其余工作
+        manager.hostRx().wait(1);
+        procSerialCommand(manager);
+
+        manager.procMotionEvents();
+        manager.maintainSwitch();
+        manager.maintainRecipe();
+        manager.maintainFlow();
+        manager.maintainTelemetry();
+        manager.maintainLight();
+        // 最后写出本轮产生的回复和日志
+        hostLog().drain();
+    }
+}
 
 void setup() {
+    // setup()运行在核心1，步进中断随init()分配在同一核心
     manager.init();
-    Serial.println("系统已启动");
+    hostLog().println("系统已启动");
+
+    xTaskCreatePinnedToCore(motionTask, "motion", MOTION_TASK_STACK, nullptr,
+                            MOTION_TASK_PRIORITY, nullptr, MOTION_CORE);
+    xTaskCreatePinnedToCore(commandTask, "command", COMMAND_TASK_STACK, nullptr,
+                            COMMAND_TASK_PRIORITY, nullptr, COMMAND_CORE);
 }
 
 void loop() {
-    const unsigned long current_millis = millis();
-    if (current_millis - previous_millis >= INTERVAL) {
-        previous_millis = current_millis;
-        
-        procSerialCommand(manager);
-        if (stepper_pp.distanceToGo() > 0) Serial.println(stepper_pp.distanceToGo());
-    }
-    
-    manager.maintainMotor();
-}
\ No newline at end of file
+    // 所有工作都在上面两个任务中完成
+    vTaskDelete(nullptr);
+}
@@ -1,16 +1,19 @@
 #include "misc.hpp"
 
+#include "binary_protocol.hpp"
 #include "constants.hpp"
+#include "hal.hpp"
+#include "host_log.hpp"
+#include "instrumentation.hpp"
 #include "types.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <cstdint>
 #include <format>
 #include <string>
 #include <string_view>
-#include <Wire.h>
-#include <sys/_types.h>
 #include <type_traits>
 #include <variant>
 
@@ -34,82 +37,60 @@ bool hexStringToBytes(std::string_view sv, unsigned char* output) {
     return true;
 }
 
-bool binStringToBytes(std::string_view sv, unsigned char* output) {
-    const int len = sv.length();
-    if (len % 8 != 0) {
-        return false;
+// 校验和为前六位之和，数据第七位是校验和 % 256，第八位是校验和 / 256
+uint16_t switchChecksum(const uint8_t* frame) {
+    unsigned int sum = 0;
+    for (int i = 0; i < 6; i++) {
+        sum += frame[i];
     }
+    return static_cast<uint16_t>(sum);
+}
 
-    const int size = len / 8;
-    for (int i = 0; i < size; i++) {
-        output[i] = 0;
-        for (int j = 0; j < 8; j++) {
-            const int index = len - (i * 8 + j) - 1;
-            const char res = sv[index] - '0';
-            if (res != 0 && res != 1) {
-                return false;
-            }
-            output[i] |= res << j;
-        }
+bool switchFrameValid(const uint8_t* frame) {
+    if (frame[0] != 0xcc || frame[5] != 0xdd) {
+        return false;
     }
-
-    return true;
+    const uint16_t sum = switchChecksum(frame);
+    return frame[6] == static_cast<uint8_t>(sum % 256) && frame[7] == static_cast<uint8_t>(sum / 256);
 }
 
-// 目前的实现是阻塞的，请勿在电机运行时切换旋转阀！
+// 只负责发送，响应由Rs485Bus::poll()异步接收
 void transmit485(const uint8_t* data, size_t len) {
     // 向串口转485模块发送数据
-    // 包含了发送数据和接受反馈的全流程
-    Serial.print("待发送数据: (");
-    for (int i = 0; i < len; i++) {
+    hostLog().at(LogLevel::DEBUG).print("待发送数据: (");
+    for (size_t i = 0; i < len; i++) {
         if (i != len-1) {
-            Serial.printf("%x, ", data[i]);
+            hostLog().printf("%x, ", data[i]);
         } else {
-            Serial.printf("%x)\n", data[i]);
-        }
-    }
-    Serial1.write(data, len);
-    Serial.println("数据已发送至485模块");
-
-    // 一般1s内响应，先等待1000ms
-    delay(1000);
-
-    if (Serial1.available() >= 8) {
-        std::array<uint8_t, 8> response;
-        Serial1.readBytes(response.data(), 8);
-        Serial.print("收到响应：");
-        for (int i = 0; i < 8; i++) {
-            if (response[i] < 0x10) Serial.print('0');
-            Serial.print(response[i], HEX);
-            Serial.print(' ');
+            hostLog().printf("%x)\n", data[i]);
         }
-        Serial.println();
-    } else {
-        Serial.println("响应超时");
     }
+    hal::rs485Serial().write(data, len);
+    hostLog().at(LogLevel::DEBUG).println("数据已发送至485模块");
 }
 
-void procSwitchData(const SwitchCommand& command) {
-    std::array<uint8_t, 8> buffer{};
+bool buildSwitchFrame(const SwitchCommand& command, uint8_t address, uint8_t* buffer) {
+    std::fill(buffer, buffer + INSTR_485_LEN, 0);
 
-    std::visit([&buffer](auto&& arg) {
+    return std::visit([buffer, address](auto&& arg) {
         using T = std::decay_t<decltype(arg)>;
         if constexpr (std::is_same_v<T, SwitchRaw>) {
             // RAW指令，传入16个16进制字符的字符串
             const std::string_view cmd_str = arg.raw_cmd;
-            if (cmd_str.length() == INSTR_485_LEN * 2 && hexStringToBytes(cmd_str, buffer.data())) {
-                transmit485(buffer.data(), INSTR_485_LEN);
-            } else {
-                Serial.println("十六进制数据格式错误");
-                Serial.println("需要16个十六进制字符，例如：CC00200000DDC901");
+            if (cmd_str.length() == INSTR_485_LEN * 2 && hexStringToBytes(cmd_str, buffer)) {
+                return true;
             }
+            hostLog().at(LogLevel::WARN).println("十六进制数据格式错误");
+            hostLog().println("需要16个十六进制字符，例如：CC00200000DDC901");
+            return false;
         } else {
             // 根据指令生成待传输的数据
 
             // 头和尾都是确定的
             buffer[0] = 0xcc;
             buffer[5] = 0xdd;
-            // 通道是buffer[1], 默认为0
+            // buffer[1]为设备地址，总线上的每台阀地址不同
+            buffer[1] = address;
 
             // 处理不同指令
             if constexpr (std::is_same_v<T, SwitchCheck>) {
@@ -118,12 +99,13 @@ void procSwitchData(const SwitchCommand& command) {
                 buffer[2] = 0x4a;
             } else if constexpr (std::is_same_v<T, SwitchChannel>) {
                 const unsigned char channel = arg.channel;
-                if (channel >= 1 && channel <= 6) {
+                if (channel >= 1 && channel <= SWITCH_CHANNEL_COUNT) {
                     buffer[2] = 0x44;
                     buffer[3] = channel;
                 } else {
-                    Serial.println("通道数错误，应在1~6之间");
-                    return;
+                    std::string msg_str = std::format("通道数错误，应在1~{}之间\n", SWITCH_CHANNEL_COUNT);
+                    hostLog().at(LogLevel::WARN).print(msg_str);
+                    return false;
                 }
             } else if constexpr (std::is_same_v<T, SwitchReset>) {
                 buffer[2] = 0x45;
@@ -132,109 +114,244 @@ void procSwitchData(const SwitchCommand& command) {
             }
 
             // 计算校验和
-            // 校验和为前六位之和，数据第七位是校验和 % 256，第八位是校验和 / 256
-            unsigned int sum = 0;
-            for (int i = 0; i < 6; i++) {
-                sum += buffer[i];
-            }
+            const uint16_t sum = switchChecksum(buffer);
             buffer[6] = static_cast<uint8_t>(sum % 256);
             buffer[7] = static_cast<uint8_t>(sum / 256);
-
-            transmit485(buffer.data(), INSTR_485_LEN);
-        } 
+            return true;
+        }
     }, command);
 }
 
-void transmit595(uint8_t data) {
-    digitalWrite(STCP, LOW);
-    // 参数1：数据引脚
-    // 参数2：移位寄存器时钟引脚
-    // 参数3：数据格式(MSBFIRST, LSBFIRST)
-    // 参数4：数据
-    shiftOut(DS, SHCP, MSBFIRST, data);
-    digitalWrite(STCP, HIGH);
+void printSwitchResponse(const Rs485Transaction& txn, void*) {
+    switch (txn.status) {
+        case Rs485Status::TIMEOUT:
+            hostLog().at(LogLevel::WARN).println("响应超时");
+            return;
+        case Rs485Status::BAD_CHECKSUM:
+            hostLog().at(LogLevel::WARN).print("响应校验失败：");
+            break;
+        default:
+            hostLog().print("收到响应：");
+            break;
+    }
+
+    for (int i = 0; i < INSTR_485_LEN; i++) {
+        hostLog().printf("%02X ", txn.response[i]);
+    }
+    hostLog().println();
 }
 
-void showSolenoidStatus(const unsigned char& status) {
-    Serial.print("电磁阀状态：");
-    for (int i = 0; i < 8; i++) {
-        std::string_view status_str = ((status & (1 << i)) == 0) ? "关闭" : "开启";
-        std::string output_str = std::format("通道{}: {} ", (i + 1), status_str);
-        if (i != 7) {
-            Serial.print(output_str.c_str());
-        } else {
-            Serial.println(output_str.c_str());
+void transmit595(SolenoidMask data) {
+    // 离DS最远的一片最先移出，通道1~8所在的一片最后移出，整条链一次锁存
+    std::array<uint8_t, SOLENOID_CHIPS> bytes;
+    for (size_t i = 0; i < SOLENOID_CHIPS; i++) {
+        bytes[SOLENOID_CHIPS - 1 - i] = static_cast<uint8_t>(data >> (i * 8));
+    }
+    hal::shiftChainWrite(bytes.data(), bytes.size());
+}
+
+void showSolenoidStatus(SolenoidMask status) {
+    hostLog().print("电磁阀状态：");
+    // 每片74HC595一行
+    for (size_t chip = 0; chip < SOLENOID_CHIPS; chip++) {
+        std::string output_str;
+        for (size_t bit = 0; bit < 8; bit++) {
+            const size_t channel = chip * 8 + bit;
+            std::string_view status_str = ((status & (1UL << channel)) == 0) ? "关闭" : "开启";
+            output_str += std::format("通道{}: {} ", (channel + 1), status_str);
         }
+        output_str.pop_back();
+        hostLog().println(output_str);
     }
 }
 
 void writeDAC(int data) {
     if (data > 4095) return;
-    const uint8_t data_1 = static_cast<uint8_t>(data >> 8); // 高四位为0
-    const uint8_t data_2 = static_cast<uint8_t>(data & 0xFF);
-    Wire.beginTransmission(DAC_ADDR);
-    Wire.write(data_1);
-    Wire.write(data_2);
-    Wire.endTransmission();
+    const uint8_t buffer[2] = {
+        static_cast<uint8_t>(data >> 8), // 高四位为0
+        static_cast<uint8_t>(data & 0xFF)
+    };
+    const uint32_t start = instr::now();
+    hal::i2cWrite(BOARD.dac.address, buffer, 2);
+    instr::recordSince(instr::histograms().i2c_write, start);
 }
 
 void procSerialCommand(CtrlBoardManager& manager) {
-    static std::string buffer = "";
-    while (Serial.available()) {
-        const char c = Serial.read();
+    // 文本模式下的当前行，超长的行整行丢弃
+    static std::array<char, COMMAND_LINE_MAX> line;
+    static size_t line_len = 0;
+    static bool b_line_overflow = false;
+    // 二进制模式下以0x00分隔的COBS帧
+    static std::array<uint8_t, BINARY_WIRE_MAX> frame;
+    static size_t frame_len = 0;
+    static bool b_frame_overflow = false;
+    // 上次报告时的接收缓冲区溢出计数
+    static uint32_t reported_overflow = 0;
+
+    SerialRx& rx = manager.hostRx();
+    const uint32_t overflow = rx.overflowCount();
+    if (overflow != reported_overflow) {
+        std::string msg_str = std::format("串口接收缓冲区溢出，累计丢弃 {} 字节\n", overflow);
+        hostLog().at(LogLevel::ERROR).print(msg_str);
+        reported_overflow = overflow;
+    }
+
+    uint8_t byte = 0;
+    while (rx.pop(byte)) {
+        const char c = static_cast<char>(byte);
+        if (manager.hostProtocol() == HostProtocol::BINARY) {
+            if (c == 0) {
+                if (frame_len > 0 && !b_frame_overflow) {
+                    procBinaryFrame(manager, frame.data(), frame_len);
+                }
+                frame_len = 0;
+                b_frame_overflow = false;
+            } else if (frame_len < frame.size()) {
+                frame[frame_len++] = byte;
+            } else {
+                b_frame_overflow = true;
+            }
+            continue;
+        }
+
         if (c == '\n') {
-            // 解析命令
-            std::transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
-            manager.procInstruction(buffer);
-            // 指令处理完成后，清空buffer和tokens
-            buffer.clear();
-
-        } else if (isAlpha(c) || c == ' ' || isDigit(c) || c == '.' || c == '-') {
-            buffer += c;
+            if (b_line_overflow) {
+                hostLog().at(LogLevel::WARN).println("指令过长，已丢弃");
+            } else {
+                // 解析命令
+                std::transform(line.begin(), line.begin() + line_len, line.begin(), ::tolower);
+                manager.procInstruction(std::string_view(line.data(), line_len));
+            }
+            // 指令处理完成后，清空缓冲区
+            line_len = 0;
+            b_line_overflow = false;
+
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == ' ' || std::isdigit(static_cast<unsigned char>(c)) || c == '.' || c == '-') {
+            if (line_len < line.size()) {
+                line[line_len++] = c;
+            } else {
+                b_line_overflow = true;
+            }
         }
     }
 }
 
-void printSyringeInstr() {
-    Serial.println("sp -f 50  - 注射泵前进50mm");
-    Serial.println("sp -b 30  - 注射泵后退30mm");
-    Serial.println("sp -fv 5  - 注射泵前进5mL");
-    Serial.println("sp -bv 3  - 注射泵后退3mL");
-    Serial.println("sp -sv 0.1  - 注射泵设置流速为0.1mL/s");
-    Serial.println("sp -ft [0-3]  - 注射泵微调");
-    Serial.println("sp -s  - 注射泵停止");
-}
-
-void printPeristalticInstr() {
-    Serial.println("pp -f 5  - 蠕动泵前进5转");
-    Serial.println("pp -b 3  - 蠕动泵后退3转");
-    Serial.println("pp -v 1000  - 蠕动泵设置流速为1000步/s");
-    Serial.println("pp -fv 5  - 蠕动泵前进5mL");
-    Serial.println("pp -bv 3  - 蠕动泵后退3mL");
-    Serial.println("pp -sv 0.1  - 蠕动泵设置流速为0.1mL/s");
-    Serial.println("pp -s  - 蠕动泵停止");
+void printAxisInstr(const AxisDescriptor& axis) {
+    // 所有轴共用一套指令，示例数值按轴的限制和默认参数生成
+    std::string msg_str = std::format(
+        "{0} -f 5  - {1}正向{2}5{3}\n"
+        "{0} -b 3  - {1}反向{2}3{3}\n"
+        "{0} -fv 5  - {1}正向{2}5mL\n"
+        "{0} -bv 3  - {1}反向{2}3mL\n"
+        "{0} -v 1000  - {1}设置速度为1000微步/s（上限{4}）\n"
+        "{0} -sv 0.1  - {1}设置流速为0.1mL/s（上限{5}）\n"
+        "{0} -ft [0-3]  - {1}微调：快速正向/慢速正向/慢速反向/快速反向，-s停止\n"
+        "{0} -flow 0.1 [5] [60]  - {1}以0.1mL/s恒流运行（负数反向），可选走满5mL或60s后停止，-s停止；运行中-flow 0.2改流速\n"
+        "{0} -total [0]  - {1}查看恒流累计体积，带0时清零\n"
+        "{0} -a {6}  - {1}设置加速度为{6}微步/s²\n"
+        "{0} -j {7}  - {1}设置加加速度为{7}微步/s³\n"
+        "{0} -s  - {1}停止\n",
+        axis.verb,
+        axis.name,
+        axis.move_word,
+        axis.unit,
+        axis.max_speed,
+        axis.max_volume_speed,
+        axis.acceleration,
+        axis.jerk
+    );
+    hostLog().print(msg_str);
 }
 
 void printSwitchInstr() {
-    Serial.println("sv -raw CC00200000DDC901 - 发送8字节数据");
-    Serial.println("sv -check - 查询当前通道编号");
-    Serial.println("sv -status - 查询切换阀电机状态");
-    Serial.println("sv -c [1~6] - 旋转到指定通道");
-    Serial.println("sv -r  - 复位");
+    hostLog().println("sv -raw CC00200000DDC901 - 发送8字节数据");
+    hostLog().println("sv -check - 查询当前通道编号");
+    hostLog().println("sv -status - 查询切换阀电机状态");
+    hostLog().println("sv -c [1~6] - 旋转到指定通道");
+    hostLog().println("sv -r  - 复位");
+    hostLog().println("sv -cache - 查看缓存的通道与发送/跳过/合并统计");
+    hostLog().println("sv -bus - 查看485总线上各设备的地址、在线状态与收发统计");
+    if constexpr (SWITCH_VALVE_COUNT > 1) {
+        std::string msg_str = std::format("sv -d [1~{}] [以上参数] - 操作总线上的第几台阀，例如 sv -d 2 -c 3，省略时为第一台\n",
+                                          SWITCH_VALVE_COUNT);
+        hostLog().print(msg_str);
+    }
+    hostLog().println("目标已是当前通道时不发送；转动中收到的多个目标只执行最后一个；缓存未过期时-check/-status直接回答");
 }
 
 void printSolenoidInstr() {
-    Serial.println("sov -d 195 / sov -b 11000011 / sov -h C3 - 发送1字节数据，控制八个电磁阀通道");
-    Serial.println("sov -s - 查询电磁阀开关状态");
-    Serial.println("sov -c [1~8] [0/1] - 控制电磁阀指定通道开/关");
+    std::string msg_str = std::format(
+        "sov -d 195 / sov -b 11000011 / sov -h C3 - 以十进制/二进制/十六进制位图设置全部{}个通道，最低位为通道1\n"
+        "sov -m [开启位图] [关闭位图] - 十六进制位图，同时开启与关闭多个通道，其余通道不变\n"
+        "sov -s - 查询电磁阀开关状态\n"
+        "sov -c [1~{}] [0/1] - 控制电磁阀指定通道开/关\n"
+        "sov -p [通道] [开启ms] [延迟ms] - 单次脉冲，延迟可省略，例如 sov -p 3 35\n"
+        "sov -w [通道] [开启ms] [关闭ms] [次数] - 按占空比重复开关，次数为0时持续到该通道被sov指令改写\n"
+        "sov -q [十六进制位图] [开启ms] [间隔ms] - 位图中的通道从低到高依次脉冲，相邻通道错开指定间隔\n",
+        SOLENOID_CHANNELS,
+        SOLENOID_CHANNELS
+    );
+    hostLog().print(msg_str);
 }
 
 void printProportionInstr() {
-    Serial.println("pv -max 100 - 记录比例阀最大压强 (比例阀默认500kPa，程序默认100kPa)");
-    Serial.println("pv -p 50 - 设定比例阀压强 (kPa)");
+    hostLog().println("pv -max 100 - 记录比例阀最大压强 (比例阀默认500kPa，程序默认100kPa)");
+    hostLog().println("pv -p 50 - 设定比例阀压强 (kPa)，同时停止斜坡和波形");
+    hostLog().println("pv -r 50 2000 - 在2000ms内线性过渡到50kPa");
+    hostLog().println("pv -e 50 2000 - 在2000ms内按指数曲线（先快后慢）过渡到50kPa");
+    hostLog().println("pv -wa 10 40 20 - 向波形末尾添加点 (kPa)，每条指令1~4个点");
+    hostLog().println("pv -wc - 清空波形");
+    hostLog().println("pv -ws 100 3 - 播放波形，点间隔100ms并线性插值，共3次（0为循环）");
+    hostLog().println("pv -cl 1 - 开启/关闭 (1/0) 压强闭环，按传感器读数修正输出");
+    hostLog().println("pv -pid 2 12 0 - 设置闭环PID参数 kp ki(1/s) kd(s)，以最大压强归一化");
+    hostLog().println("pv -ff 1 - 设置闭环前馈（开环换算）权重");
+    hostLog().println("pv -s - 查看设定值、输出、测量压强与最近一次阶跃响应");
+}
+
+void printCoordinatedInstr() {
+    hostLog().println("co -t 1 0.5 10 - 注射泵1mL与蠕动泵0.5mL联动，共用时10s（负数为反向）");
+    hostLog().println("co -r 1 0.5 - 注射泵1mL，蠕动泵按0.5倍体积联动，速度取两泵设定中较慢者");
+    hostLog().println("co -s - 停止联动");
+}
+
+void printRecipeInstr() {
+    hostLog().println("rc -add [步骤] - 在配方末尾添加一步，例如 rc -add sp 1 / rc -add wait 500 / rc -add loop 3");
+    hostLog().println("  步骤：sov [位图] [高位图] | sovc [通道] [0/1] | sp/pp [mL] | spv/ppv [mL/s] | co [mL] [mL] [s]（仅两泵板） | sv [1~6] [阀号] | pv [kPa] | l [0/1] | wait [ms] | sync | loop [次数] | end | sovp [通道] [ms] [延迟ms] | pvr [kPa] [ms] [0线性/1指数]");
+    hostLog().println("rc -list - 查看配方");
+    hostLog().println("rc -clear - 清空配方");
+    hostLog().println("rc -start / -pause / -resume / -abort - 启动、暂停、继续、中止配方");
+}
+
+void printTelemetryInstr() {
+    hostLog().println("tm -r [0~100] - 设置遥测频率(Hz)，0为关闭，遥测以二进制帧输出");
+    hostLog().println("tm -s - 查看遥测状态");
+}
+
+void printLogInstr() {
+    hostLog().println("log -l [0~3] - 设置输出级别（0调试 1信息 2警告 3错误），低于该级别的消息不输出");
+    hostLog().println("log -p [0/1] - 输出队列满时丢弃新消息(0)或最早的消息(1)");
+    hostLog().println("log -s - 查看输出队列统计");
+}
+
+void printDiagInstr() {
+    hostLog().println("diag - 打印循环周期、步进抖动、485/I2C事务和各指令处理时间的统计并清零");
+    hostLog().println("diag -p - 只打印不清零");
+}
+
+void printBinaryInstr() {
+    hostLog().println("bin - 切换到二进制帧协议 (COBS+CRC16)，发送TEXT_MODE帧切回文本");
 }
 
 void printLightInstr() {
-    Serial.println("l -[on/off] - 开启或关闭光源");
-    Serial.println("l -b [0~255] - 设置光源亮度");
+    hostLog().println("l -[on/off] - 开启或关闭光源");
+    hostLog().println("l -b [0~255] - 设置光源亮度");
+    hostLog().println("l -c FF0000 [区域位图] - 把区域（16进制位图，bit i为第i个LED，省略为全部）设为指定颜色");
+    hostLog().println("l -px 10 00FF00 - 设置单个LED的颜色");
+    hostLog().println("l -clr - 清空图案（全部设为黑色）");
+    hostLog().println("l -rm 2 2 4 4 - 计算以(2,2)为左上角、4x4矩形的区域位图");
+    hostLog().println("l -bl [区域位图] 100 400 5 - 区域闪烁：亮100ms灭400ms，共5次（0为循环）");
+    hostLog().println("l -br [区域位图] 2000 0 - 区域呼吸：2000ms周期渐亮渐暗，0为循环");
+    hostLog().println("l -ch [区域位图] 50 3 - 区域跑马：依次点亮，每个50ms，走3遍");
+    hostLog().println("l -as - 停止动画");
+    hostLog().println("l -s - 查看光源状态");
 }
\ No newline at end of file
@@ -1,30 +1,39 @@
 #pragma once
 
-#include <AccelStepper.h>
-#include <Arduino.h>
+#include <cstddef>
+#include <cstdint>
 #include "ctrl_board_manager.hpp"
+#include "rs485_bus.hpp"
 #include <string_view>
 #include "types.hpp"
 
 // Helper functions:
 constexpr int hexToNibble(const char c);
 bool hexStringToBytes(std::string_view sv, unsigned char* output);
-bool binStringToBytes(std::string_view sv, unsigned char* output);
 
+uint16_t switchChecksum(const uint8_t* frame);
+bool switchFrameValid(const uint8_t* frame);
 void transmit485(const uint8_t* data, size_t len = 8);
-void procSwitchData(const SwitchCommand& command);
+// 按指令生成发往address的8字节切换阀帧（RAW帧原样使用），格式错误时返回false
+bool buildSwitchFrame(const SwitchCommand& command, uint8_t address, uint8_t* buffer);
+void printSwitchResponse(const Rs485Transaction& txn, void* context);
 
-void transmit595(uint8_t data);
-void showSolenoidStatus(const unsigned char& status);
+void transmit595(SolenoidMask data);
+void showSolenoidStatus(SolenoidMask status);
 
 void writeDAC(int data);
 
 void procSerialCommand(CtrlBoardManager& manager);
 
 // Printers:
-void printSyringeInstr();
-void printPeristalticInstr();
+void printAxisInstr(const AxisDescriptor& axis);
 void printSwitchInstr();
 void printSolenoidInstr();
 void printProportionInstr();
-void printLightInstr();
\ No newline at end of file
+void printLightInstr();
+void printCoordinatedInstr();
+void printRecipeInstr();
+void printTelemetryInstr();
+void printLogInstr();
+void printDiagInstr();
+void printBinaryInstr();
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "pressure_control.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void PressureController::reset() {
+    integral = 0;
+    derivative = 0;
+    b_started = false;
+    step = {};
+}
+
+void PressureController::trackStep(float setpoint, float measure, uint32_t now_us) {
+    const float change = setpoint - last_setpoint;
+    if (std::fabs(change) >= PRESSURE_STEP_MIN) {
+        step = {.b_valid = true, .from = measure, .to = setpoint};
+        step_start_us = now_us;
+    } else if (change != 0) {
+        // 设定值连续变化（斜坡、波形），不是阶跃
+        step.b_valid = false;
+    }
+    if (!step.b_valid) {
+        return;
+    }
+
+    const float amplitude = step.to - step.from;
+    if (amplitude == 0) {
+        return;
+    }
+    step.overshoot = std::max(step.overshoot, (measure - step.to) / amplitude);
+    step.b_settled = std::fabs(measure - step.to) <= PRESSURE_SETTLE_BAND * std::fabs(amplitude);
+    if (!step.b_settled) {
+        step.settle_us = now_us - step_start_us;
+    }
+}
+
+float PressureController::update(float setpoint, float measure, float dt_s, uint32_t now_us) {
+    if (!b_started) {
+        last_measure = measure;
+        last_setpoint = setpoint;
+        b_started = true;
+    }
+    trackStep(setpoint, measure, now_us);
+    last_setpoint = setpoint;
+
+    const float alpha = dt_s / (dt_s + PRESSURE_PID_D_FILTER_S);
+    derivative += (-(measure - last_measure) / dt_s - derivative) * alpha;
+    last_measure = measure;
+
+    const float error = setpoint - measure;
+    const float base = config.kff * setpoint + config.kp * error + config.kd * derivative;
+    const float candidate = std::clamp(integral + config.ki * error * dt_s, -1.0f, 1.0f);
+    const float unsaturated = base + candidate;
+    if (!((unsaturated > 1 && error > 0) || (unsaturated < 0 && error < 0))) {
+        integral = candidate;
+    }
+    return std::clamp(base + integral, 0.0f, 1.0f);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include "constants.hpp"
+
+// 压强闭环参数，由指令核心设定
+struct PressureLoopConfig {
+    bool b_enabled = false;
+    float kp = PRESSURE_PID_KP;
+    float ki = PRESSURE_PID_KI;
+    float kd = PRESSURE_PID_KD;
+    float kff = PRESSURE_PID_KFF;
+    float full_scale_kpa = 100;     // 最大压强，测量值除以它归一化
+};
+
+// 阶跃响应统计，设定值跳变时重新开始，斜坡和波形期间无效
+struct StepResponse {
+    bool b_valid = false;
+    bool b_settled = false;     // 当前误差在稳定带内
+    float from = 0;             // 跳变时的测量值（归一化）
+    float to = 0;               // 跳变后的设定值（归一化）
+    float overshoot = 0;        // 越过设定值的最大幅度，相对阶跃幅度
+    uint32_t settle_us = 0;     // 最后一次离开稳定带的时刻，相对跳变时刻
+};
+
+// 带前馈的PID：比例与积分作用于误差，微分作用于测量值（设定值跳变时没有微分冲击）
+// 输出饱和且误差仍在加深饱和时停止积分（条件积分），积分项本身也限制在±1以内
+// 纯计算，不访问硬件，由PressureOutput在闹钟回调中按固定频率调用
+class PressureController {
+private:
+    PressureLoopConfig config;
+
+    float integral = 0;
+    float derivative = 0;       // 滤波后的测量值变化率（取负）
+    float last_measure = 0;
+    float last_setpoint = 0;
+    bool b_started = false;
+
+    StepResponse step;
+    uint32_t step_start_us = 0;
+
+    void trackStep(float setpoint, float measure, uint32_t now_us);
+
+public:
+    void configure(const PressureLoopConfig& loop_config) { config = loop_config; }
+    const PressureLoopConfig& settings() const { return config; }
+
+    // 清除积分与微分状态，闭环开启或传感器恢复时调用
+    void reset();
+
+    // setpoint与measure均已归一化，返回0~1的输出
+    float update(float setpoint, float measure, float dt_s, uint32_t now_us);
+
+    const StepResponse& stepResponse() const { return step; }
+};
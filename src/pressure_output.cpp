@@ -0,0 +1,205 @@
+#include "pressure_output.hpp"
+
+#include "misc.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// 指数斜坡 S(x) = (1 - e^(-kx)) / (1 - e^(-k))，k越大前段越陡
+static constexpr float EXP_RAMP_RATE = 5.0f;
+static constexpr uint32_t TICK_US = 1000000 / DAC_UPDATE_FREQ;
+
+static float rampShape(PressureRampShape shape, float x) {
+    if (shape == PressureRampShape::EXPONENTIAL) {
+        return (1.0f - std::exp(-EXP_RAMP_RATE * x)) / (1.0f - std::exp(-EXP_RAMP_RATE));
+    }
+    return x;
+}
+
+void PressureOutput::begin(uint16_t code, PressureSensor& pressure_sensor) {
+    sensor = &pressure_sensor;
+    hal::i2cBegin(BOARD.dac.sda_pin, BOARD.dac.scl_pin, DAC_I2C_FREQ);
+    writeDAC(code);
+    output = code;
+    setpoint = code;
+    published_output.store(code, std::memory_order_release);
+    published_setpoint.store(code, std::memory_order_release);
+    alarm = hal::alarmCreate(&PressureOutput::onAlarm, this);
+}
+
+bool PressureOutput::submit(const DacCommand& command) {
+    if (!commands.push(command)) {
+        return false;
+    }
+    if (command.type == DacCommandType::WAVE) {
+        wave_submitted++;
+    }
+    hal::alarmArm(alarm, 0);
+    return true;
+}
+
+bool PressureOutput::configureLoop(const PressureLoopConfig& config) {
+    if (!loop_configs.push(config)) {
+        return false;
+    }
+    b_loop_enabled.store(config.b_enabled, std::memory_order_release);
+    hal::alarmArm(alarm, 0);
+    return true;
+}
+
+bool PressureOutput::loadWave(const uint16_t* codes, size_t len) {
+    if (len > wave.size() || wavePlaying()) {
+        return false;
+    }
+    std::copy(codes, codes + len, wave.begin());
+    wave_len = len;
+    return true;
+}
+
+bool PressureOutput::measuredPressure(float& kpa) const {
+    if (!b_measure_valid.load(std::memory_order_acquire)) {
+        return false;
+    }
+    kpa = published_measure.load(std::memory_order_relaxed);
+    return true;
+}
+
+void PressureOutput::onAlarm(void* arg) {
+    static_cast<PressureOutput*>(arg)->service();
+}
+
+void PressureOutput::write(uint16_t code) {
+    if (code == output) {
+        return;
+    }
+    writeDAC(code);
+    output = code;
+    published_output.store(code, std::memory_order_release);
+}
+
+// 结束当前的斜坡或波形
+void PressureOutput::finish() {
+    if (b_active && active.type == DacCommandType::WAVE) {
+        wave_finished.fetch_add(1, std::memory_order_release);
+    }
+    b_active = false;
+}
+
+void PressureOutput::apply(const DacCommand& command, uint32_t now) {
+    finish();
+    active = command;
+    start_code = setpoint;
+    elapsed_us = 0;
+    last_us = now;
+    switch (command.type) {
+        case DacCommandType::SET:
+            setpoint = command.code;
+            break;
+        case DacCommandType::RAMP:
+            b_active = true;
+            break;
+        case DacCommandType::WAVE:
+            b_active = true;
+            // 少于两个点或间隔为0时没有可播放的内容
+            if (wave_len < 2 || command.duration_us == 0) {
+                finish();
+            }
+            break;
+    }
+}
+
+void PressureOutput::advance(uint32_t now) {
+    // 播放期间闹钟每个周期都会推进，两次之间的差值不会回绕
+    elapsed_us += now - last_us;
+    last_us = now;
+    if (active.type == DacCommandType::RAMP) {
+        if (elapsed_us >= active.duration_us) {
+            setpoint = active.code;
+            finish();
+            return;
+        }
+        const float s = rampShape(active.shape, static_cast<float>(elapsed_us) / active.duration_us);
+        const float code = start_code + (static_cast<float>(active.code) - start_code) * s;
+        setpoint = static_cast<uint16_t>(std::lround(code));
+        return;
+    }
+
+    // 波形：相邻两点之间线性插值，播完一遍从第一个点重新开始
+    // 点数与间隔都取上限时一遍超过32位µs，用64位计算（playPressureWave保证一遍不超过32位）
+    // 总时长按64位计，多次播放超过71分钟也能结束，循环播放在micros()回绕时不跳相位
+    const uint64_t period_us = static_cast<uint64_t>(wave_len - 1) * active.duration_us;
+    if (active.repeats != 0 && elapsed_us / period_us >= active.repeats) {
+        setpoint = wave[wave_len - 1];
+        finish();
+        return;
+    }
+    const uint32_t position = static_cast<uint32_t>(elapsed_us % period_us);
+    const size_t index = position / active.duration_us;
+    const float frac = static_cast<float>(position % active.duration_us) / active.duration_us;
+    const float code = wave[index] + (static_cast<float>(wave[index + 1]) - wave[index]) * frac;
+    setpoint = static_cast<uint16_t>(std::lround(code));
+}
+
+// 闭环：读取传感器，由PID决定输出；传感器故障时退回开环，恢复后从零积分重新开始
+void PressureOutput::control(uint32_t now) {
+    const PressureLoopConfig& config = loop.settings();
+    float kpa = 0;
+    if (!sensor->read(kpa)) {
+        if (b_sensor_ok) {
+            loop.reset();
+            b_sensor_ok = false;
+        }
+        b_measure_valid.store(false, std::memory_order_release);
+        write(setpoint);
+        return;
+    }
+
+    // 第一次或恢复后按标称周期计算
+    const uint32_t dt_us = b_sensor_ok ? std::max<uint32_t>(now - last_control_us, 1) : TICK_US;
+    b_sensor_ok = true;
+    last_control_us = now;
+    published_measure.store(kpa, std::memory_order_relaxed);
+    b_measure_valid.store(true, std::memory_order_release);
+
+    const float u = loop.update(setpoint / 4096.0f, kpa / config.full_scale_kpa, dt_us / 1e6f, now);
+    write(static_cast<uint16_t>(std::min(std::lround(u * 4096.0f), 4095L)));
+    published_step = loop.stepResponse();
+}
+
+void PressureOutput::service() {
+    const uint32_t now = hal::micros();
+    PressureLoopConfig config;
+    while (loop_configs.pop(config)) {
+        if (config.b_enabled != loop.settings().b_enabled) {
+            loop.reset();
+            b_sensor_ok = false;
+        }
+        loop.configure(config);
+    }
+    DacCommand command;
+    while (commands.pop(command)) {
+        apply(command, now);
+    }
+    if (b_active) {
+        advance(now);
+    }
+    published_setpoint.store(setpoint, std::memory_order_release);
+
+    const bool b_closed = loop.settings().b_enabled;
+    if (b_closed) {
+        control(now);
+    } else {
+        b_measure_valid.store(false, std::memory_order_release);
+        write(setpoint);
+    }
+
+    const bool b_endless = b_active && active.type == DacCommandType::WAVE && active.repeats == 0;
+    b_busy.store(b_active && !b_endless, std::memory_order_release);
+
+    // 处理期间又提交的指令立即处理，否则按更新频率继续推进
+    if (!commands.empty() || !loop_configs.empty()) {
+        hal::alarmArm(alarm, 0);
+    } else if (b_active || b_closed) {
+        hal::alarmArm(alarm, TICK_US);
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "hal.hpp"
+#include "pressure_control.hpp"
+#include "pressure_sensor.hpp"
+#include "spsc_queue.hpp"
+
+// 斜坡形状
+enum class PressureRampShape : uint8_t {
+    LINEAR = 0,
+    EXPONENTIAL = 1     // 先快后慢，按时长归一化，到时刚好到达目标
+};
+
+// 压强输出指令，由指令核心提交；数值均为DAC码（0~4095）
+enum class DacCommandType : uint8_t {
+    SET = 0,    // 立即输出，取消斜坡和波形
+    RAMP = 1,   // 从当前设定值按形状过渡到目标
+    WAVE = 2    // 播放已装载的波形
+};
+
+struct DacCommand {
+    DacCommandType type = DacCommandType::SET;
+    PressureRampShape shape = PressureRampShape::LINEAR;
+    uint16_t code = 0;          // SET/RAMP的目标
+    uint32_t duration_us = 0;   // RAMP: 时长；WAVE: 相邻两点的间隔
+    uint32_t repeats = 0;       // WAVE: 播放次数，0为循环
+};
+
+// 比例阀DAC输出引擎，唯一写MCP4725的地方
+// 斜坡和波形生成设定值：开环时设定值直接输出，闭环时作为PID的设定值，由传感器读数修正输出
+// 开环空闲时不占用定时器；斜坡、波形和闭环期间由闹钟以DAC_UPDATE_FREQ推进
+// 设定值按开始以来经过的时间计算，闹钟的调度延迟不会拉长斜坡；数值不变时不写I2C
+class PressureOutput {
+private:
+    SpscQueue<DacCommand, DAC_QUEUE_LEN> commands;
+    SpscQueue<PressureLoopConfig, 4> loop_configs;
+    hal::AlarmId alarm = 0;
+    PressureSensor* sensor = nullptr;
+
+    // 波形点，只在没有波形播放时由指令核心装载
+    std::array<uint16_t, PRESSURE_WAVE_MAX> wave{};
+    size_t wave_len = 0;
+    // 已提交与已结束（播完或被新指令取代）的波形指令数，相等时波形表空闲
+    uint32_t wave_submitted = 0;
+    std::atomic<uint32_t> wave_finished{0};
+
+    // 以下只在闹钟回调中访问
+    DacCommand active;
+    bool b_active = false;
+    uint16_t start_code = 0;    // 斜坡起点
+    // 开始以来经过的时间：每次推进累加32位µs差值，micros()回绕后总时长也不会溢出
+    uint64_t elapsed_us = 0;
+    uint32_t last_us = 0;
+    uint16_t setpoint = 0;
+    uint16_t output = 0;
+    PressureController loop;
+    uint32_t last_control_us = 0;
+    bool b_sensor_ok = false;
+
+    std::atomic<uint16_t> published_output{0};
+    std::atomic<uint16_t> published_setpoint{0};
+    std::atomic<float> published_measure{0};    // kPa
+    std::atomic<bool> b_measure_valid{false};
+    std::atomic<bool> b_busy{false};    // 有限的斜坡或波形尚未结束
+    std::atomic<bool> b_loop_enabled{false};
+    StepResponse published_step;        // 由闹钟回调整体写入，显示用，允许偶尔读到新旧混合的值
+
+    void write(uint16_t code);
+    void finish();
+    void apply(const DacCommand& command, uint32_t now);
+    void advance(uint32_t now);
+    void control(uint32_t now);
+    void service();
+    static void onAlarm(void* arg);
+
+public:
+    // 初始化I2C并输出code，任务启动前调用；sensor用于闭环
+    void begin(uint16_t code, PressureSensor& pressure_sensor);
+
+    // 指令核心调用，队列满时返回false
+    bool submit(const DacCommand& command);
+    bool configureLoop(const PressureLoopConfig& config);
+    // 装载波形点，正在播放波形时返回false
+    bool loadWave(const uint16_t* codes, size_t len);
+    bool wavePlaying() const { return wave_finished.load(std::memory_order_acquire) != wave_submitted; }
+
+    uint16_t currentCode() const { return published_output.load(std::memory_order_acquire); }
+    uint16_t setpointCode() const { return published_setpoint.load(std::memory_order_acquire); }
+    bool loopEnabled() const { return b_loop_enabled.load(std::memory_order_acquire); }
+    // 闭环最近一次的传感器读数，开环或传感器故障时返回false
+    bool measuredPressure(float& kpa) const;
+    StepResponse stepResponse() const { return published_step; }
+    // 还有未处理的指令，或有限的斜坡、波形尚未结束
+    bool busy() const { return !commands.empty() || b_busy.load(std::memory_order_acquire); }
+};
@@ -0,0 +1,28 @@
+#include "pressure_sensor.hpp"
+
+#include "constants.hpp"
+#include "hal.hpp"
+
+#include <algorithm>
+
+AnalogPressureSensor::AnalogPressureSensor(uint8_t sensor_pin, float zero_point_mv, float full_scale_mv,
+                                           float full_scale_kpa) {
+    pin = sensor_pin;
+    zero_mv = zero_point_mv;
+    full_mv = full_scale_mv;
+    full_kpa = full_scale_kpa;
+}
+
+void AnalogPressureSensor::begin() {
+    hal::adcBegin(pin);
+}
+
+bool AnalogPressureSensor::read(float& kpa) {
+    const float mv = static_cast<float>(hal::adcReadMv(pin));
+    if (mv < zero_mv - PRESSURE_SENSOR_FAULT_MV || mv > full_mv + PRESSURE_SENSOR_FAULT_MV) {
+        return false;
+    }
+    // 零点附近的噪声可能略低于零点，截到量程以内
+    kpa = std::clamp((mv - zero_mv) / (full_mv - zero_mv), 0.0f, 1.0f) * full_kpa;
+    return true;
+}
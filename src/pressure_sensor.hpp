@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// 压强传感器接口，闭环控制只通过它读取测量值
+class PressureSensor {
+public:
+    virtual ~PressureSensor() = default;
+    // 读取失败（断线、超出量程）时返回false
+    virtual bool read(float& kpa) = 0;
+};
+
+// 电压与压强成线性关系的模拟输出传感器，经ADC读取
+class AnalogPressureSensor : public PressureSensor {
+private:
+    uint8_t pin;
+    float zero_mv;
+    float full_mv;
+    float full_kpa;
+
+public:
+    AnalogPressureSensor(uint8_t sensor_pin, float zero_point_mv, float full_scale_mv, float full_scale_kpa);
+
+    void begin();
+    bool read(float& kpa) override;
+};
@@ -0,0 +1,326 @@
+#include "recipe.hpp"
+
+#include "ctrl_board_manager.hpp"
+#include "hal.hpp"
+#include "host_log.hpp"
+#include "types.hpp"
+
+#include <cmath>
+#include <format>
+#include <string>
+#include <string_view>
+
+// 文本步骤名与参数个数，顺序与RecipeOp一致
+// 参数个数在min_args~arg_count之间，省略的参数为0
+struct RecipeOpInfo {
+    std::string_view name;
+    size_t arg_count;
+    size_t min_args;
+};
+
+static constexpr std::array<RecipeOpInfo, static_cast<size_t>(RecipeOp::OP_COUNT)> recipe_ops {{
+    {"sov", 2, 1},
+    {"sovc", 2, 2},
+    {"sp", 1, 1},
+    {"pp", 1, 1},
+    {"spv", 1, 1},
+    {"ppv", 1, 1},
+    {"co", 3, 3},
+    {"sv", 2, 1},
+    {"pv", 1, 1},
+    {"l", 1, 1},
+    {"wait", 1, 1},
+    {"sync", 0, 0},
+    {"loop", 1, 1},
+    {"end", 0, 0},
+    {"sovp", 3, 2},
+    {"pvr", 3, 2},
+}};
+
+// 配方参数是float，只能精确表示24位以内的整数，32位位图拆成两个16位的半字
+static SolenoidMask solenoidStepMask(const RecipeStep& step) {
+    return static_cast<SolenoidMask>(step.args[0]) | (static_cast<SolenoidMask>(step.args[1]) << 16);
+}
+
+RecipeRunner::RecipeRunner(CtrlBoardManager& board_manager) : manager(board_manager) {
+    count = 0;
+    pc = 0;
+    run_state = RecipeState::IDLE;
+    loop_depth = 0;
+    b_step_started = false;
+    wait_start = 0;
+    wait_ms = 0;
+}
+
+// 当前板型是否有该步骤用到的外设
+static constexpr bool opAvailable(RecipeOp op) {
+    switch (op) {
+        case RecipeOp::SOLENOID_SET:
+        case RecipeOp::SOLENOID_CHANNEL:
+        case RecipeOp::SOLENOID_PULSE:
+            return BOARD.solenoid.b_present;
+        case RecipeOp::SWITCH_CHANNEL:
+            return BOARD.switch_valve.b_present;
+        case RecipeOp::SET_PRESSURE:
+        case RecipeOp::PRESSURE_RAMP:
+            return BOARD.dac.b_present;
+        case RecipeOp::LIGHT:
+            return BOARD.led.b_present;
+        case RecipeOp::COORDINATED:
+            // 步骤最多3个参数，只够两泵体积加时长；三泵板请用co命令
+            return STEP_AXIS_COUNT == 2;
+        default:
+            return true;
+    }
+}
+
+// 上传时检查参数范围，避免执行到一半才失败
+static bool stepValid(const RecipeStep& step) {
+    const auto& args = step.args;
+    if (!opAvailable(step.op)) return false;
+    for (const float arg : args) {
+        if (!std::isfinite(arg)) return false;
+    }
+    switch (step.op) {
+        case RecipeOp::SOLENOID_SET:
+            return args[0] >= 0 && args[0] <= 0xFFFF && args[1] >= 0 && args[1] <= 0xFFFF
+                && solenoidStepMask(step) <= SOLENOID_MASK_ALL;
+        case RecipeOp::SOLENOID_CHANNEL:
+            return args[0] >= 1 && args[0] <= SOLENOID_CHANNELS;
+        case RecipeOp::SOLENOID_PULSE:
+            return args[0] >= 1 && args[0] <= SOLENOID_CHANNELS
+                && args[1] >= SOLENOID_TIMING_MIN_MS && args[1] <= SOLENOID_TIMING_MAX_MS
+                && args[2] >= 0 && args[2] <= SOLENOID_TIMING_MAX_MS;
+        case RecipeOp::PRESSURE_RAMP:
+            return args[1] >= 0 && args[1] <= PRESSURE_RAMP_MAX_MS && (args[2] == 0 || args[2] == 1);
+        case RecipeOp::SYRINGE_SPEED:
+            return args[0] > 0 && args[0] <= AXIS_REGISTRY[SYRINGE_AXIS].max_volume_speed;
+        case RecipeOp::PERISTALTIC_SPEED:
+            return args[0] > 0 && args[0] <= AXIS_REGISTRY[PERISTALTIC_AXIS].max_volume_speed;
+        case RecipeOp::SWITCH_CHANNEL:
+            return args[0] >= 1 && args[0] <= SWITCH_CHANNEL_COUNT
+                && args[1] >= 0 && args[1] <= SWITCH_VALVE_COUNT && std::floor(args[1]) == args[1];
+        case RecipeOp::WAIT_MS:
+            return args[0] >= 0 && args[0] <= RECIPE_WAIT_MAX_MS;
+        case RecipeOp::LOOP:
+            return args[0] >= 1 && args[0] <= RECIPE_LOOP_MAX;
+        case RecipeOp::OP_COUNT:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool RecipeRunner::add(const RecipeStep& step) {
+    if (run_state != RecipeState::IDLE || count == steps.size() || !stepValid(step)) {
+        return false;
+    }
+    steps[count++] = step;
+    return true;
+}
+
+bool RecipeRunner::clear() {
+    if (run_state != RecipeState::IDLE) {
+        return false;
+    }
+    count = 0;
+    pc = 0;
+    return true;
+}
+
+bool RecipeRunner::validate() const {
+    // LOOP/END_LOOP必须配对，嵌套不超过RECIPE_LOOP_DEPTH
+    size_t depth = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (steps[i].op == RecipeOp::LOOP) {
+            if (++depth > RECIPE_LOOP_DEPTH) return false;
+        } else if (steps[i].op == RecipeOp::END_LOOP) {
+            if (depth == 0) return false;
+            depth--;
+        }
+    }
+    return depth == 0;
+}
+
+bool RecipeRunner::start() {
+    if (run_state != RecipeState::IDLE || count == 0 || !validate()) {
+        return false;
+    }
+    pc = 0;
+    loop_depth = 0;
+    b_step_started = false;
+    run_state = RecipeState::RUNNING;
+    return true;
+}
+
+bool RecipeRunner::pause() {
+    if (run_state != RecipeState::RUNNING) {
+        return false;
+    }
+    // 暂停时冻结等待计时，已经开始的电机运动不受影响
+    if (b_step_started && steps[pc].op == RecipeOp::WAIT_MS) {
+        const uint32_t elapsed = hal::millis() - wait_start;
+        wait_ms = (elapsed >= wait_ms) ? 0 : wait_ms - elapsed;
+    }
+    run_state = RecipeState::PAUSED;
+    return true;
+}
+
+bool RecipeRunner::resume() {
+    if (run_state != RecipeState::PAUSED) {
+        return false;
+    }
+    wait_start = hal::millis();
+    run_state = RecipeState::RUNNING;
+    return true;
+}
+
+void RecipeRunner::abort() {
+    if (run_state == RecipeState::IDLE) {
+        return;
+    }
+    manager.stopAllAxes();
+    run_state = RecipeState::IDLE;
+    pc = 0;
+    loop_depth = 0;
+    b_step_started = false;
+}
+
+void RecipeRunner::fail(const char* reason) {
+    std::string msg_str = std::format("配方第 {} 步{}，已中止\n", pc + 1, reason);
+    hostLog().at(LogLevel::ERROR).print(msg_str);
+    abort();
+}
+
+bool RecipeRunner::execStep(const RecipeStep& step, bool& b_failed) {
+    const auto& args = step.args;
+    switch (step.op) {
+        case RecipeOp::SOLENOID_SET:
+            manager.setSolenoidStatus(solenoidStepMask(step));
+            return true;
+        case RecipeOp::SOLENOID_CHANNEL:
+            manager.solenoidToggleChannel(static_cast<int>(args[0]), args[1] != 0);
+            return true;
+        case RecipeOp::SYRINGE_MOVE:
+            manager.moveAxisVolume(SYRINGE_AXIS, args[0]);
+            return true;
+        case RecipeOp::PERISTALTIC_MOVE:
+            manager.moveAxisVolume(PERISTALTIC_AXIS, args[0]);
+            return true;
+        case RecipeOp::SYRINGE_SPEED:
+            manager.setAxisSpeed(SYRINGE_AXIS, args[0], true);
+            return true;
+        case RecipeOp::PERISTALTIC_SPEED:
+            manager.setAxisSpeed(PERISTALTIC_AXIS, args[0], true);
+            return true;
+        case RecipeOp::COORDINATED:
+            if constexpr (STEP_AXIS_COUNT == 2) {
+                b_failed = !manager.moveCoordinated({args[0], args[1]}, args[2]);
+            }
+            return true;
+        case RecipeOp::SWITCH_CHANNEL:
+            // 阀号从1开始，省略（0）时为第一台
+            b_failed = !manager.switchValve(SwitchChannel{static_cast<int>(args[0])},
+                                            args[1] > 0 ? static_cast<size_t>(args[1]) - 1 : 0);
+            return true;
+        case RecipeOp::SET_PRESSURE:
+            b_failed = !manager.setPressure(static_cast<int>(args[0]));
+            return true;
+        case RecipeOp::LIGHT:
+            if (args[0] != 0) {
+                manager.turnOnLED();
+            } else {
+                manager.shutLED();
+            }
+            return true;
+        case RecipeOp::WAIT_MS:
+            if (!b_step_started) {
+                b_step_started = true;
+                wait_start = hal::millis();
+                wait_ms = static_cast<uint32_t>(args[0]);
+            }
+            return hal::millis() - wait_start >= wait_ms;
+        case RecipeOp::WAIT_IDLE:
+            return manager.motionIdle() && !manager.switchBusy() && !manager.solenoidBusy()
+                && !manager.pressureBusy();
+        case RecipeOp::LOOP:
+            loops[loop_depth++] = {pc + 1, static_cast<uint32_t>(args[0]) - 1};
+            return true;
+        case RecipeOp::END_LOOP: {
+            LoopFrame& frame = loops[loop_depth - 1];
+            if (frame.remaining > 0) {
+                frame.remaining--;
+                // 回到循环体开头，pc随后会加一，所以这里减一
+                pc = frame.begin - 1;
+            } else {
+                loop_depth--;
+            }
+            return true;
+        }
+        case RecipeOp::SOLENOID_PULSE: {
+            const SolenoidMask mask = SolenoidMask{1} << (static_cast<int>(args[0]) - 1);
+            b_failed = !manager.timeSolenoids(mask, args[1], 0, 1, 0, args[2]);
+            return true;
+        }
+        case RecipeOp::PRESSURE_RAMP:
+            b_failed = !manager.setPressure(static_cast<int>(args[0]), args[1],
+                                            static_cast<PressureRampShape>(args[2]));
+            return true;
+        case RecipeOp::OP_COUNT:
+            break;
+    }
+    b_failed = true;
+    return true;
+}
+
+void RecipeRunner::maintain() {
+    // 同一毫秒内连续执行所有不需要等待的步骤，每次最多执行RECIPE_MAX_STEPS步，避免空循环占住指令核心
+    for (size_t budget = steps.size(); budget > 0 && run_state == RecipeState::RUNNING; budget--) {
+        if (pc >= count) {
+            run_state = RecipeState::IDLE;
+            pc = 0;
+            hostLog().println("配方执行完成");
+            return;
+        }
+
+        bool b_failed = false;
+        if (!execStep(steps[pc], b_failed)) {
+            return;
+        }
+        if (b_failed) {
+            fail("执行失败");
+            return;
+        }
+        b_step_started = false;
+        pc++;
+    }
+}
+
+bool parseRecipeStep(const CommandTokens& tokens, size_t first, RecipeStep& step) {
+    if (first >= tokens.size()) return false;
+
+    for (size_t op = 0; op < recipe_ops.size(); op++) {
+        const RecipeOpInfo& info = recipe_ops[op];
+        if (info.name != tokens[first]) continue;
+        const size_t arg_count = tokens.size() - first - 1;
+        if (arg_count < info.min_args || arg_count > info.arg_count) return false;
+
+        step.op = static_cast<RecipeOp>(op);
+        step.args = {0, 0, 0};
+        for (size_t i = 0; i < arg_count; i++) {
+            if (!parseNumber(tokens[first + 1 + i], step.args[i])) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+void printRecipeStep(size_t index, const RecipeStep& step) {
+    if (step.op >= RecipeOp::OP_COUNT) return;
+    const RecipeOpInfo& info = recipe_ops[static_cast<size_t>(step.op)];
+    std::string msg_str = std::format("{}: {}", index + 1, info.name);
+    for (size_t i = 0; i < info.arg_count; i++) {
+        msg_str += std::format(" {}", step.args[i]);
+    }
+    hostLog().println(msg_str);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "command_parser.hpp"
+#include "constants.hpp"
+
+class CtrlBoardManager;
+
+// 配方（板上流程）：预先上传一串步骤，由指令核心每毫秒推进，不再依赖上位机逐条下发
+// 步骤之间没有串口往返和INTERVAL轮询带来的延迟，时序由板上时钟决定
+enum class RecipeOp : uint8_t {
+    SOLENOID_SET = 0,       // args[0]: 通道1~16的位图，args[1]: 通道17~32的位图（文本中可省略，默认0）
+    SOLENOID_CHANNEL = 1,   // args[0]: 通道1~SOLENOID_CHANNELS，args[1]: 0关1开
+    SYRINGE_MOVE = 2,       // args[0]: mL，负数为反向
+    PERISTALTIC_MOVE = 3,   // args[0]: mL，负数为反向
+    SYRINGE_SPEED = 4,      // args[0]: mL/s
+    PERISTALTIC_SPEED = 5,  // args[0]: mL/s
+    COORDINATED = 6,        // args[0]: 注射泵mL，args[1]: 蠕动泵mL，args[2]: 总时长s（<=0按设定速度），仅限两泵板
+    SWITCH_CHANNEL = 7,     // args[0]: 切换阀通道1~6，args[1]: 阀号1~SWITCH_VALVE_COUNT（文本中可省略，默认第一台）
+    SET_PRESSURE = 8,       // args[0]: kPa
+    LIGHT = 9,              // args[0]: 0关1开
+    WAIT_MS = 10,           // args[0]: 等待毫秒数
+    WAIT_IDLE = 11,         // 等待电机停止、切换阀应答、有限次数的电磁阀定时和压强斜坡结束
+    LOOP = 12,              // args[0]: 循环次数，与END_LOOP之间的步骤重复执行
+    END_LOOP = 13,
+    SOLENOID_PULSE = 14,    // args[0]: 通道，args[1]: 开启ms，args[2]: 延迟ms（文本中可省略）
+    PRESSURE_RAMP = 15,     // args[0]: kPa，args[1]: 过渡ms，args[2]: 0线性1指数（文本中可省略）
+    OP_COUNT
+};
+
+struct RecipeStep {
+    RecipeOp op;
+    std::array<float, 3> args;
+};
+
+enum class RecipeState : uint8_t {
+    IDLE = 0,
+    RUNNING = 1,
+    PAUSED = 2
+};
+
+class RecipeRunner {
+private:
+    CtrlBoardManager& manager;
+
+    std::array<RecipeStep, RECIPE_MAX_STEPS> steps;
+    size_t count;
+    size_t pc;  // 下一个要执行的步骤
+    RecipeState run_state;
+
+    struct LoopFrame {
+        size_t begin;       // LOOP之后第一个步骤
+        uint32_t remaining; // 还需重复的次数
+    };
+    std::array<LoopFrame, RECIPE_LOOP_DEPTH> loops;
+    size_t loop_depth;
+
+    // 当前阻塞步骤的状态
+    bool b_step_started;
+    uint32_t wait_start;
+    uint32_t wait_ms;
+
+    bool validate() const;
+    // 执行当前步骤，返回false表示步骤仍在等待
+    bool execStep(const RecipeStep& step, bool& b_failed);
+    void fail(const char* reason);
+
+public:
+    explicit RecipeRunner(CtrlBoardManager& board_manager);
+
+    // 上传与清空只在空闲时允许
+    bool add(const RecipeStep& step);
+    bool clear();
+
+    bool start();
+    bool pause();
+    bool resume();
+    // 中止配方并停止两泵，配方内容保留
+    void abort();
+
+    // 指令核心每毫秒调用
+    void maintain();
+
+    RecipeState state() const { return run_state; }
+    size_t size() const { return count; }
+    size_t position() const { return pc; }
+    const RecipeStep& step(size_t index) const { return steps[index]; }
+};
+
+// 文本形式的步骤："sp 1.5"、"co 1 -2 20"、"wait 500"、"loop 3" 等，从tokens[first]开始解析
+bool parseRecipeStep(const CommandTokens& tokens, size_t first, RecipeStep& step);
+void printRecipeStep(size_t index, const RecipeStep& step);
@@ -0,0 +1,200 @@
+#include "rs485_bus.hpp"
+
+#include "host_log.hpp"
+#include "instrumentation.hpp"
+#include "misc.hpp"
+
+#include <algorithm>
+#include <format>
+#include <string>
+
+Rs485Bus::Rs485Bus(HalSerial& serial) : port(serial) {
+    device_count = 0;
+    state = State::IDLE;
+    active = 0;
+    last_served = 0;
+    sent_at = 0;
+    sent_cycles = 0;
+    rx_frame.fill(0);
+    received = 0;
+}
+
+int Rs485Bus::attach(uint8_t address, uint8_t priority, uint32_t timeout_ms) {
+    if (device_count == devices.size()) {
+        return -1;
+    }
+    Device& device = devices[device_count];
+    device.address = address;
+    device.priority = priority;
+    device.timeout_ms = timeout_ms;
+    device.head = 0;
+    device.count = 0;
+    device.stats = {};
+    // 新设备排在轮询的末尾
+    last_served = device_count;
+    return static_cast<int>(device_count++);
+}
+
+int Rs485Bus::findDevice(uint8_t address) const {
+    for (size_t i = 0; i < device_count; i++) {
+        if (devices[i].address == address) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+size_t Rs485Bus::pending() const {
+    size_t total = 0;
+    for (size_t i = 0; i < device_count; i++) {
+        total += devices[i].count;
+    }
+    return total;
+}
+
+bool Rs485Bus::submit(size_t device_id, const uint8_t* frame, Rs485Callback callback, void* context) {
+    Device& device = devices[device_id];
+    if (device.count == device.queue.size()) {
+        return false;
+    }
+
+    Rs485Transaction& txn = device.queue[(device.head + device.count) % device.queue.size()];
+    std::copy(frame, frame + INSTR_485_LEN, txn.request.begin());
+    txn.response.fill(0);
+    txn.status = Rs485Status::PENDING;
+    txn.callback = callback;
+    txn.context = context;
+    device.count++;
+
+    if (state == State::IDLE) {
+        startNext();
+    }
+    return true;
+}
+
+void Rs485Bus::startNext() {
+    // 从上一次服务的设备之后开始找，优先级最高且最靠前的设备获得总线
+    // 离线设备的排名低于所有在线设备
+    int next = -1;
+    int next_rank = -1;
+    for (size_t k = 1; k <= device_count; k++) {
+        const size_t i = (last_served + k) % device_count;
+        const Device& device = devices[i];
+        if (device.count == 0) continue;
+        const int rank = online(device) ? device.priority + 1 : 0;
+        if (rank > next_rank) {
+            next = static_cast<int>(i);
+            next_rank = rank;
+        }
+    }
+    if (next < 0) {
+        state = State::IDLE;
+        return;
+    }
+
+    // 丢弃上一次超时后才到达的残留字节，避免错位
+    while (port.available()) {
+        port.read();
+    }
+
+    active = static_cast<size_t>(next);
+    Device& device = devices[active];
+    device.stats.sent++;
+    transmit485(device.queue[device.head].request.data(), INSTR_485_LEN);
+    sent_at = hal::millis();
+    sent_cycles = instr::now();
+    received = 0;
+    state = State::WAIT_RESPONSE;
+}
+
+void Rs485Bus::finish(Rs485Status status) {
+    instr::recordSince(instr::histograms().rs485_transaction, sent_cycles);
+
+    Device& device = devices[active];
+    switch (status) {
+        case Rs485Status::OK:
+            device.stats.replied++;
+            device.stats.consecutive_timeouts = 0;
+            break;
+        case Rs485Status::TIMEOUT:
+            device.stats.timeouts++;
+            device.stats.consecutive_timeouts++;
+            break;
+        default:
+            // 校验失败说明设备在线，只是帧受了干扰
+            device.stats.bad_frames++;
+            device.stats.consecutive_timeouts = 0;
+            break;
+    }
+
+    Rs485Transaction& txn = device.queue[device.head];
+    txn.status = status;
+
+    // 先出队再回调，回调中可以继续submit
+    const Rs485Transaction done = txn;
+    device.head = (device.head + 1) % device.queue.size();
+    device.count--;
+    last_served = active;
+    state = State::IDLE;
+
+    if (done.callback) {
+        done.callback(done, done.context);
+    }
+
+    if (state == State::IDLE) {
+        startNext();
+    }
+}
+
+void Rs485Bus::poll() {
+    if (state != State::WAIT_RESPONSE) {
+        return;
+    }
+
+    const Device& device = devices[active];
+    const Rs485Transaction& txn = device.queue[device.head];
+    while (port.available()) {
+        const uint8_t byte = static_cast<uint8_t>(port.read());
+        // 按帧头同步，帧间的杂散字节直接丢弃
+        if (received == 0 && byte != 0xcc) continue;
+        rx_frame[received++] = byte;
+        if (received < INSTR_485_LEN) continue;
+
+        received = 0;
+        if (rx_frame[1] != txn.request[1]) {
+            const int owner = findDevice(rx_frame[1]);
+            if (owner >= 0) {
+                devices[owner].stats.late_replies++;
+            }
+            continue;
+        }
+        devices[active].queue[device.head].response = rx_frame;
+        finish(switchFrameValid(rx_frame.data()) ? Rs485Status::OK : Rs485Status::BAD_CHECKSUM);
+        return;
+    }
+
+    if (hal::millis() - sent_at >= device.timeout_ms) {
+        finish(Rs485Status::TIMEOUT);
+    }
+}
+
+void Rs485Bus::printStatus() const {
+    for (size_t i = 0; i < device_count; i++) {
+        const Device& device = devices[i];
+        std::string msg_str = std::format(
+            "485设备{}：地址{}，优先级{}，超时{}ms，{}，排队{}，发送{}，应答{}，超时{}，校验失败{}，迟到应答{}\n",
+            i,
+            device.address,
+            device.priority,
+            device.timeout_ms,
+            online(device) ? "在线" : "离线",
+            device.count,
+            device.stats.sent,
+            device.stats.replied,
+            device.stats.timeouts,
+            device.stats.bad_frames,
+            device.stats.late_replies
+        );
+        hostLog().print(msg_str);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "hal.hpp"
+#include "types.hpp"
+
+// 一次485事务：发送8字节帧，等待同一地址（帧的第2字节）回复的8字节响应
+struct Rs485Transaction;
+using Rs485Callback = void (*)(const Rs485Transaction& txn, void* context);
+
+struct Rs485Transaction {
+    std::array<uint8_t, INSTR_485_LEN> request;
+    std::array<uint8_t, INSTR_485_LEN> response;
+    Rs485Status status;
+    Rs485Callback callback;
+    void* context;
+};
+
+// 每台设备的收发统计
+struct Rs485DeviceStats {
+    uint32_t sent;
+    uint32_t replied;
+    uint32_t timeouts;
+    uint32_t bad_frames;            // 校验失败
+    uint32_t late_replies;          // 该地址在其他事务期间才到达的应答，已丢弃
+    uint32_t consecutive_timeouts;
+};
+
+// 多设备485总线（半双工，同一时刻只有一个事务在线上）
+// 每台设备有独立的事务队列、超时和统计；poll()空闲时按调度选出下一台设备发送：
+// 优先级高的先发，同优先级按设备编号轮流，不会让一台设备的连续指令饿死其他设备
+// 连续超时RS485_OFFLINE_AFTER次的设备视为离线，只在其他设备都没有待发事务时才发送，收到应答后恢复
+// 应答按地址字节分派，其他地址的帧（通常是上一台设备超时后才到的应答）丢弃，继续等待直到超时
+class Rs485Bus {
+private:
+    enum class State : uint8_t {
+        IDLE,
+        WAIT_RESPONSE
+    };
+
+    struct Device {
+        uint8_t address;
+        uint8_t priority;
+        uint32_t timeout_ms;
+        std::array<Rs485Transaction, RS485_DEVICE_QUEUE_LEN> queue;
+        size_t head;
+        size_t count;
+        Rs485DeviceStats stats;
+    };
+
+    HalSerial& port;
+
+    std::array<Device, RS485_MAX_DEVICES> devices;
+    size_t device_count;
+
+    State state;
+    size_t active;          // 正在等待应答的设备
+    size_t last_served;     // 同优先级轮询的起点
+    uint32_t sent_at;
+    uint32_t sent_cycles;   // 性能统计用的发送时刻
+    std::array<uint8_t, INSTR_485_LEN> rx_frame;
+    size_t received;
+
+    bool online(const Device& device) const { return device.stats.consecutive_timeouts < RS485_OFFLINE_AFTER; }
+    int findDevice(uint8_t address) const;
+    void startNext();
+    void finish(Rs485Status status);
+
+public:
+    explicit Rs485Bus(HalSerial& serial);
+
+    // 注册一台设备，返回设备编号，设备数已满时返回-1
+    // priority越大越优先，timeout_ms为该设备每个事务的应答超时
+    int attach(uint8_t address, uint8_t priority = 0, uint32_t timeout_ms = RS485_TIMEOUT_MS);
+
+    // 入队一个事务，该设备的队列满时返回false
+    bool submit(size_t device, const uint8_t* frame, Rs485Callback callback = nullptr, void* context = nullptr);
+
+    void poll();
+
+    bool busy() const { return state != State::IDLE || pending() != 0; }
+    // 该设备有事务在等待应答或排队
+    bool busy(size_t device) const { return (state != State::IDLE && active == device) || devices[device].count != 0; }
+    size_t pending() const;
+    size_t deviceCount() const { return device_count; }
+    uint8_t address(size_t device) const { return devices[device].address; }
+    bool deviceOnline(size_t device) const { return online(devices[device]); }
+    const Rs485DeviceStats& statistics(size_t device) const { return devices[device].stats; }
+    void printStatus() const;
+};
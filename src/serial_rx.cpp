@@ -0,0 +1,21 @@
+#include "serial_rx.hpp"
+
+void SerialRx::begin() {
+    port.onReceive(&SerialRx::onReceive, this);
+}
+
+void SerialRx::onReceive(void* arg) {
+    SerialRx& rx = *static_cast<SerialRx*>(arg);
+    bool b_frame_end = false;
+    while (rx.port.available() > 0) {
+        const uint8_t byte = static_cast<uint8_t>(rx.port.read());
+        if (!rx.ring.push(byte)) {
+            rx.overflow_bytes.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        b_frame_end = b_frame_end || byte == '\n' || byte == 0;
+    }
+    if (b_frame_end) {
+        rx.frame_ready.give();
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "hal.hpp"
+#include "spsc_queue.hpp"
+
+// 上位机串口的事件驱动接收通道
+// 驱动收到数据时由接收回调把字节搬进定长环形缓冲区，遇到行尾'\n'或帧分隔符0x00立即唤醒指令任务，
+// 指令任务不再按INTERVAL轮询串口。缓冲区满时丢弃新字节并计数
+class SerialRx {
+private:
+    HalSerial& port;
+    SpscQueue<uint8_t, HOST_RX_BUFFER_LEN> ring;
+    hal::Signal frame_ready;
+
+    std::atomic<uint32_t> overflow_bytes{0};
+
+    static void onReceive(void* arg);
+
+public:
+    explicit SerialRx(HalSerial& serial) : port(serial) {}
+
+    // 在串口begin之后调用
+    void begin();
+
+    // 等待直到收到完整的一行/一帧或超时，返回是否被唤醒
+    bool wait(uint32_t timeout_ms) { return frame_ready.take(timeout_ms); }
+
+    bool pop(uint8_t& byte) { return ring.pop(byte); }
+    uint32_t overflowCount() const { return overflow_bytes.load(std::memory_order_relaxed); }
+};
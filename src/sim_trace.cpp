@@ -0,0 +1,125 @@
+#ifndef ARDUINO
+
+#include "sim_trace.hpp"
+
+#include "board_config.hpp"
+#include "hal_native.hpp"
+
+#include <algorithm>
+#include <format>
+#include <utility>
+
+void ActuatorTrace::add(uint64_t time_ns, std::string device, std::string event, std::string value) {
+    events.push_back({time_ns, std::move(device), std::move(event), std::move(value)});
+}
+
+void ActuatorTrace::poll() {
+    const uint64_t now_ns = hal::native::nowNs();
+    pollAxes(now_ns);
+    if constexpr (BOARD.solenoid.b_present) pollShiftChain();
+    if constexpr (BOARD.dac.b_present) pollDac();
+    if constexpr (BOARD.led.b_present) pollLeds();
+    if constexpr (BOARD.switch_valve.b_present) pollValves();
+}
+
+void ActuatorTrace::pollAxes(uint64_t now_ns) {
+    // 使能低电平有效，所有电机共用
+    const bool b_enabled = !hal::native::pinLevel(BOARD.motor_en_pin);
+    if (b_enabled != b_motor_enabled) {
+        b_motor_enabled = b_enabled;
+        add(now_ns, "motor_en", b_enabled ? "enable" : "disable", "");
+    }
+
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        const StepAxisId id = static_cast<StepAxisId>(i);
+        const AxisDescriptor& desc = AXIS_REGISTRY[i];
+        AxisState& axis = axes[i];
+        const bool b_running = engine.isRunning(id);
+        const long position = engine.currentPosition(id);
+        const int8_t direction = hal::native::pinLevel(desc.dir_pin) ? 1 : -1;
+
+        if (b_running && !axis.b_running) {
+            axis.start_position = position;
+            axis.direction = direction;
+            add(now_ns, std::string(desc.verb), "start", std::format("pos={} dir={}", position, direction > 0 ? '+' : '-'));
+        } else if (b_running && direction != axis.direction) {
+            axis.direction = direction;
+            add(now_ns, std::string(desc.verb), "dir", std::format("pos={} dir={}", position, direction > 0 ? '+' : '-'));
+        } else if (!b_running && axis.b_running) {
+            add(now_ns, std::string(desc.verb), "stop",
+                std::format("pos={} steps={} ({:.4f} mL)", position, position - axis.start_position,
+                            (position - axis.start_position) / desc.microsteps_per_ml));
+        }
+        axis.b_running = b_running;
+    }
+}
+
+void ActuatorTrace::pollShiftChain() {
+    // 链上最先移出的一片离DS最远，最后一片是通道1~8
+    const auto& log = hal::native::shiftLog();
+    for (; shift_seen < log.size(); shift_seen++) {
+        const hal::native::ShiftEvent& shift = log[shift_seen];
+        SolenoidMask mask = 0;
+        for (size_t chip = 0; chip < shift.bytes.size(); chip++) {
+            mask |= static_cast<SolenoidMask>(shift.bytes[shift.bytes.size() - 1 - chip]) << (chip * 8);
+        }
+        if (mask == solenoids && shift_seen != 0) continue;
+
+        std::string value = std::format("0x{:08X}", mask);
+        const SolenoidMask changed = mask ^ solenoids;
+        for (size_t ch = 0; ch < 32; ch++) {
+            if (changed & (SolenoidMask{1} << ch)) {
+                value += std::format(" {}{}", (mask >> ch) & 1 ? '+' : '-', ch + 1);
+            }
+        }
+        solenoids = mask;
+        add(shift.time_ns, "sov", "latch", value);
+    }
+}
+
+void ActuatorTrace::pollDac() {
+    // MCP4725 fast write：高四位在第一字节的低四位
+    const auto& log = hal::native::i2cLog();
+    for (; i2c_seen < log.size(); i2c_seen++) {
+        const hal::native::I2cTransfer& transfer = log[i2c_seen];
+        if (transfer.address != BOARD.dac.address || transfer.data.size() != 2) continue;
+        const uint16_t code = static_cast<uint16_t>(((transfer.data[0] & 0x0f) << 8) | transfer.data[1]);
+        if (code == dac_code && i2c_seen != 0) continue;
+        dac_code = code;
+        add(transfer.time_ns, "dac", "code", std::format("{}", code));
+    }
+}
+
+void ActuatorTrace::pollLeds() {
+    const auto& log = hal::native::ledLog();
+    for (; led_seen < log.size(); led_seen++) {
+        const hal::native::LedFrame& frame = log[led_seen];
+        const size_t lit = std::count_if(frame.pixels.begin(), frame.pixels.end(), [](const LedColor& c) {
+            return c.r != 0 || c.g != 0 || c.b != 0;
+        });
+        add(frame.time_ns, "led", "frame", std::format("brightness={} lit={}/{}", frame.brightness, lit, frame.pixels.size()));
+    }
+}
+
+void ActuatorTrace::pollValves() {
+    const auto& log = hal::native::valveLog();
+    for (; valve_seen < log.size(); valve_seen++) {
+        const hal::native::ValveMove& move = log[valve_seen];
+        const std::string device = std::format("sv@{}", move.address);
+        add(move.time_ns, device, "move", std::format("{}->{}", move.from, move.to));
+        add(move.arrive_ns, device, "arrive", std::format("{}", move.to));
+    }
+}
+
+void ActuatorTrace::write(std::FILE* file) {
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.time_ns < b.time_ns;
+    });
+    std::fputs("time_ms,device,event,value\n", file);
+    for (const Event& event : events) {
+        const std::string line = std::format("{:.3f},{},{},{}\n", event.time_ns / 1e6, event.device, event.event, event.value);
+        std::fwrite(line.data(), 1, line.size(), file);
+    }
+}
+
+#endif
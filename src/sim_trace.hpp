@@ -0,0 +1,66 @@
+#pragma once
+
+// 主机仿真的执行器轨迹，仅在env:native中可用
+// 每个虚拟毫秒读取模拟HAL的日志与步进引擎状态，把各执行器的每次状态变化记成一行：
+// 时间(ms),设备,事件,值
+// 595、DAC、LED与切换阀的时间取自模拟HAL日志，精确到ns；步进轴的启停与换向按毫秒采样
+
+#ifndef ARDUINO
+
+#include "axis_registry.hpp"
+#include "step_engine.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class ActuatorTrace {
+private:
+    struct Event {
+        uint64_t time_ns;
+        std::string device;
+        std::string event;
+        std::string value;
+    };
+
+    struct AxisState {
+        bool b_running = false;
+        int8_t direction = 0;
+        long start_position = 0;
+    };
+
+    StepEngine& engine;
+    std::vector<Event> events;
+
+    std::array<AxisState, STEP_AXIS_COUNT> axes{};
+    bool b_motor_enabled = false;
+    SolenoidMask solenoids = 0;
+    uint16_t dac_code = 0;
+    // 模拟HAL日志中已处理到的位置
+    size_t shift_seen = 0;
+    size_t i2c_seen = 0;
+    size_t led_seen = 0;
+    size_t valve_seen = 0;
+
+    void add(uint64_t time_ns, std::string device, std::string event, std::string value);
+    void pollAxes(uint64_t now_ns);
+    void pollShiftChain();
+    void pollDac();
+    void pollLeds();
+    void pollValves();
+
+public:
+    explicit ActuatorTrace(StepEngine& step_engine) : engine(step_engine) {}
+
+    // 每推进一次虚拟时间后调用
+    void poll();
+    size_t size() const { return events.size(); }
+    // 按时间排序后以CSV写出（切换阀的到位事件在发出指令时就已记下）
+    void write(std::FILE* file);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "solenoid_scheduler.hpp"
+
+#include "hal.hpp"
+#include "instrumentation.hpp"
+#include "misc.hpp"
+
+#include <algorithm>
+
+void SolenoidScheduler::begin() {
+    output = 0;
+    transmit595(output);
+    // 与步进中断同核，不与压强输出的I2C读写排队
+    alarm = hal::alarmCreate(&SolenoidScheduler::onAlarm, this, MOTION_CORE);
+}
+
+bool SolenoidScheduler::submit(const ValveCommand& command) {
+    if (!commands.push(command)) {
+        return false;
+    }
+    // 立即唤醒调度器处理新指令
+    hal::alarmArm(alarm, 0);
+    return true;
+}
+
+void SolenoidScheduler::onAlarm(void* arg) {
+    static_cast<SolenoidScheduler*>(arg)->service();
+}
+
+void SolenoidScheduler::apply(const ValveCommand& command, SolenoidMask& next_output) {
+    if (command.type == ValveCommandType::SET) {
+        for (size_t i = 0; i < SOLENOID_CHANNELS; i++) {
+            if ((command.mask | command.close_mask) & (SolenoidMask{1} << i)) {
+                timers[i].b_active = false;
+            }
+        }
+        next_output = (next_output & ~command.close_mask) | command.mask;
+        return;
+    }
+
+    uint32_t start_us = command.start_us;
+    for (size_t i = 0; i < SOLENOID_CHANNELS; i++) {
+        if ((command.mask & (SolenoidMask{1} << i)) == 0) continue;
+        timers[i] = {
+            .b_active = true,
+            .b_on = false,
+            .next_us = start_us,
+            .on_us = command.on_us,
+            .off_us = command.off_us,
+            .cycles_left = command.cycles,
+        };
+        start_us += command.stagger_us;
+    }
+}
+
+void SolenoidScheduler::service() {
+    SolenoidMask next_output = output;
+    ValveCommand command;
+    while (commands.pop(command)) {
+        apply(command, next_output);
+    }
+
+    const uint32_t now = hal::micros();
+    SolenoidMask timed = 0;
+    SolenoidMask finite = 0;
+    uint32_t next_delay = UINT32_MAX;
+    for (size_t i = 0; i < SOLENOID_CHANNELS; i++) {
+        ChannelTimer& timer = timers[i];
+        const SolenoidMask bit = SolenoidMask{1} << i;
+        // 每次只推进一个切换：回调延迟超过on_us时，开启和关闭若在同一次锁存中抵消，脉冲就到不了阀
+        // 还有已到期的切换时闹钟立即再触发，先把这一次的输出锁存出去
+        if (timer.b_active && static_cast<int32_t>(now - timer.next_us) >= 0) {
+            if constexpr (INSTRUMENTATION_ENABLED) {
+                instr::histograms().valve_latency.record((now - timer.next_us) * hal::cpuMhz());
+            }
+            if (!timer.b_on) {
+                next_output |= bit;
+                timer.b_on = true;
+                timer.next_us += timer.on_us;
+            } else {
+                next_output &= ~bit;
+                timer.b_on = false;
+                if (timer.cycles_left != 0 && --timer.cycles_left == 0) {
+                    timer.b_active = false;
+                } else {
+                    timer.next_us += timer.off_us;
+                }
+            }
+        }
+        if (timer.b_active) {
+            timed |= bit;
+            if (timer.cycles_left != 0) {
+                finite |= bit;
+            }
+            const int32_t remaining = static_cast<int32_t>(timer.next_us - now);
+            next_delay = std::min(next_delay, static_cast<uint32_t>(std::max<int32_t>(remaining, 0)));
+        }
+    }
+
+    if (next_output != output) {
+        transmit595(next_output);
+        output = next_output;
+    }
+    published_output.store(output, std::memory_order_release);
+    timed_mask.store(timed, std::memory_order_release);
+    finite_mask.store(finite, std::memory_order_release);
+
+    if (next_delay != UINT32_MAX) {
+        hal::alarmArm(alarm, next_delay);
+    }
+    // 处理期间又提交的指令不能被上面的闹钟推迟
+    if (!commands.empty()) {
+        hal::alarmArm(alarm, 0);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "constants.hpp"
+#include "hal.hpp"
+#include "spsc_queue.hpp"
+#include "types.hpp"
+
+// 电磁阀指令，由指令核心提交给调度器
+enum class ValveCommandType : uint8_t {
+    SET = 0,    // 开启mask、关闭close_mask中的通道，并取消这些通道的定时
+    TIMED = 1   // mask中的通道按开启/关闭时长定时切换，结束后保持关闭
+};
+
+struct ValveCommand {
+    ValveCommandType type = ValveCommandType::SET;
+    SolenoidMask mask = 0;
+    SolenoidMask close_mask = 0;    // SET
+    uint32_t start_us = 0;          // TIMED：第一个通道开启的时刻（hal::micros()）
+    uint32_t on_us = 0;
+    uint32_t off_us = 0;
+    uint32_t cycles = 0;            // 开启次数，0为持续循环
+    uint32_t stagger_us = 0;        // mask中每个通道比前一个通道推迟开启的时间
+};
+
+// 电磁阀输出调度：所有74HC595输出都由这里写出，保证只有一个写入者
+// 由固定在运动核心的单次闹钟驱动，闹钟总是定在最近的一次切换时刻；同一时刻到期的通道在同一次锁存中切换
+// 切换按计划时刻推进，回调延迟不会累积到后续周期
+// 每个通道每次回调最多切换一次并立即锁存，回调严重延迟时脉冲变短但不会丢失
+class SolenoidScheduler {
+private:
+    struct ChannelTimer {
+        bool b_active = false;
+        bool b_on = false;
+        uint32_t next_us = 0;       // 下一次切换的计划时刻
+        uint32_t on_us = 0;
+        uint32_t off_us = 0;
+        uint32_t cycles_left = 0;   // 0为持续循环
+    };
+
+    SpscQueue<ValveCommand, SOLENOID_QUEUE_LEN> commands;
+    hal::AlarmId alarm = 0;
+    std::array<ChannelTimer, SOLENOID_CHANNELS> timers{};
+    SolenoidMask output = 0;
+
+    // 供指令核心读取的快照
+    std::atomic<SolenoidMask> published_output{0};
+    std::atomic<SolenoidMask> timed_mask{0};
+    std::atomic<SolenoidMask> finite_mask{0};   // 有限次数、尚未结束的定时通道
+
+    void apply(const ValveCommand& command, SolenoidMask& next_output);
+    void service();
+    static void onAlarm(void* arg);
+
+public:
+    // 锁存全部关闭并注册闹钟，任务启动前调用
+    void begin();
+
+    // 指令核心调用，队列满时返回false
+    bool submit(const ValveCommand& command);
+
+    SolenoidMask currentOutput() const { return published_output.load(std::memory_order_acquire); }
+    SolenoidMask timedChannels() const { return timed_mask.load(std::memory_order_acquire); }
+    // 还有未处理的指令，或有限次数的定时尚未结束
+    bool busy() const { return !commands.empty() || finite_mask.load(std::memory_order_acquire) != 0; }
+};
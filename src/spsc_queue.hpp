@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// 单生产者单消费者无锁队列，用于两个核心之间传递指令和事件
+// 生产者只写tail，消费者只写head，两端都不需要加锁或关中断
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue容量必须是2的幂");
+
+private:
+    std::array<T, N> buffer{};
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+
+public:
+    // 仅由生产者调用，队列满时返回false
+    bool push(const T& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        buffer[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅由消费者调用，队列空时返回false
+    bool pop(T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buffer[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+};
@@ -0,0 +1,211 @@
+#include "step_engine.hpp"
+
+#include "constants.hpp"
+#include "hal.hpp"
+
+void StepEngine::begin() {
+    for (const auto& pin : pins) {
+        hal::gpioOutput(pin.step);
+        hal::gpioOutput(pin.dir);
+        hal::gpioWrite(pin.step, false);
+        hal::gpioWrite(pin.dir, true); // StepAxis初始方向为正
+    }
+
+    jitter.setPeriod(hal::cpuMhz() * 1000000 / STEP_TICK_FREQ);
+    hal::timerStart(STEP_TIMER_FREQ, STEP_TIMER_FREQ / STEP_TICK_FREQ, &StepEngine::onTimer, this);
+}
+
+void HAL_ISR_ATTR StepEngine::onTimer(void* arg) {
+    auto* engine = static_cast<StepEngine*>(arg);
+    engine->jitter.tick(instr::histograms().step_jitter);
+    uint32_t set_mask = 0;
+    uint32_t clear_mask = 0;
+
+    engine->lock.lockFromISR();
+    Coordination& co = engine->coordination;
+    std::array<uint8_t, STEP_AXIS_COUNT> actions;
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        actions[i] = engine->axes[i].tick();
+    }
+
+    if (co.active) {
+        if (actions[co.master] & StepAxis::ACTION_STEP_HIGH) {
+            // Bresenham：主轴每走一步，从轴累加误差，超过一半主轴步数即走一步
+            for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+                if (i == co.master || co.minor_steps[i] == 0) continue;
+                co.error[i] += co.minor_steps[i];
+                if (2 * co.error[i] >= static_cast<long>(co.major_steps)) {
+                    co.error[i] -= co.major_steps;
+                    actions[i] |= engine->axes[i].followStep();
+                }
+            }
+        }
+        if (!engine->axes[co.master].isRunning()) {
+            co.active = false;
+            engine->axes[co.master].setMaxRate(co.saved_max_rate);
+        }
+    }
+
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        const StepAxis& axis = engine->axes[i];
+        const uint8_t action = actions[i];
+        if (action == StepAxis::ACTION_NONE) continue;
+
+        const AxisPins& pin = pins[i];
+        if (action & StepAxis::ACTION_STEP_HIGH) set_mask |= 1UL << pin.step;
+        if (action & StepAxis::ACTION_STEP_LOW) clear_mask |= 1UL << pin.step;
+        if (action & StepAxis::ACTION_DIR_CHANGE) {
+            if (axis.currentDirection() > 0) {
+                set_mask |= 1UL << pin.dir;
+            } else {
+                clear_mask |= 1UL << pin.dir;
+            }
+        }
+    }
+    engine->lock.unlockFromISR();
+
+    hal::gpioWriteMask(set_mask, clear_mask);
+}
+
+void StepEngine::setMaxSpeed(StepAxisId axis, float speed) {
+    lock.lock();
+    axes[axis].setMaxSpeed(speed);
+    lock.unlock();
+}
+
+void StepEngine::setAcceleration(StepAxisId axis, float acceleration) {
+    lock.lock();
+    axes[axis].setAcceleration(acceleration);
+    lock.unlock();
+}
+
+void StepEngine::setJerk(StepAxisId axis, float jerk) {
+    lock.lock();
+    axes[axis].setJerk(jerk);
+    lock.unlock();
+}
+
+bool StepEngine::move(StepAxisId axis, long relative) {
+    lock.lock();
+    const bool b_free = !coordination.active && !axes[axis].velocityMode();
+    if (b_free) {
+        axes[axis].move(relative);
+    }
+    lock.unlock();
+    return b_free;
+}
+
+bool StepEngine::moveTo(StepAxisId axis, long absolute) {
+    lock.lock();
+    const bool b_free = !coordination.active && !axes[axis].velocityMode();
+    if (b_free) {
+        axes[axis].moveTo(absolute);
+    }
+    lock.unlock();
+    return b_free;
+}
+
+void StepEngine::stop(StepAxisId axis) {
+    lock.lock();
+    // 联动中停止任一轴都会让主轴减速停止，从轴随之按比例停下
+    if (coordination.active) {
+        axes[coordination.master].stop();
+    } else {
+        axes[axis].stop();
+    }
+    lock.unlock();
+}
+
+bool StepEngine::moveCoordinated(const std::array<long, STEP_AXIS_COUNT>& steps, float master_speed) {
+    StepAxisId master = SYRINGE_AXIS;
+    unsigned long major_steps = 0;
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        const unsigned long abs_steps = (steps[i] >= 0) ? steps[i] : -steps[i];
+        if (abs_steps > major_steps) {
+            major_steps = abs_steps;
+            master = static_cast<StepAxisId>(i);
+        }
+    }
+    if (major_steps == 0 || master_speed <= 0) {
+        return false;
+    }
+
+    lock.lock();
+    bool b_busy = coordination.active;
+    for (const auto& axis : axes) {
+        b_busy = b_busy || axis.isRunning();
+    }
+    if (b_busy) {
+        lock.unlock();
+        return false;
+    }
+
+    coordination.master = master;
+    coordination.major_steps = major_steps;
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        coordination.minor_steps[i] = (steps[i] >= 0) ? steps[i] : -steps[i];
+        coordination.error[i] = 0;
+        if (i != master && steps[i] != 0) {
+            // 从轴方向在启动前设好，主轴方向由其tick()自行切换
+            const int8_t dir = (steps[i] > 0) ? 1 : -1;
+            axes[i].setDirection(dir);
+            hal::gpioWrite(pins[i].dir, dir > 0);
+        }
+    }
+    coordination.saved_max_rate = axes[master].maxRate();
+    axes[master].setMaxSpeed(master_speed);
+    axes[master].move(steps[master]);
+    coordination.active = true;
+    lock.unlock();
+    return true;
+}
+
+bool StepEngine::runVelocity(StepAxisId axis, float velocity, long limit) {
+    lock.lock();
+    const bool b_ok = !coordination.active && axes[axis].runVelocity(velocity, limit);
+    lock.unlock();
+    return b_ok;
+}
+
+long StepEngine::velocityDisplacement(StepAxisId axis) {
+    lock.lock();
+    const long res = axes[axis].velocityDisplacement();
+    lock.unlock();
+    return res;
+}
+
+void StepEngine::setCurrentPosition(StepAxisId axis, long position) {
+    lock.lock();
+    axes[axis].setCurrentPosition(position);
+    lock.unlock();
+}
+
+long StepEngine::distanceToGo(StepAxisId axis) {
+    lock.lock();
+    const long res = axes[axis].distanceToGo();
+    lock.unlock();
+    return res;
+}
+
+long StepEngine::currentPosition(StepAxisId axis) {
+    lock.lock();
+    const long res = axes[axis].currentPosition();
+    lock.unlock();
+    return res;
+}
+
+float StepEngine::speed(StepAxisId axis) {
+    lock.lock();
+    const float res = axes[axis].speed();
+    lock.unlock();
+    return res;
+}
+
+bool StepEngine::isRunning(StepAxisId axis) {
+    lock.lock();
+    // 联动中的从轴自身没有目标，以主轴状态为准
+    const bool b_following = coordination.active && coordination.minor_steps[axis] != 0;
+    const bool res = axes[axis].isRunning() || b_following;
+    lock.unlock();
+    return res;
+}
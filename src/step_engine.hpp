@@ -0,0 +1,504 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include "axis_registry.hpp"
+#include "constants.hpp"
+#include "hal.hpp"
+#include "instrumentation.hpp"
+
+// 单轴步进脉冲发生器，由StepEngine的定时器中断以STEP_TICK_FREQ固定频率调用tick()
+// 不依赖任何硬件，便于在主机上用虚拟时钟验证脉冲间隔
+//
+// 速度使用相位累加(DDA)：每tick相位增加rate >> 16，相位溢出即产生一步
+// 加减速为限制加加速度(jerk)的S曲线：速度 = 巡航速度 × S(u)，u为归一化的加速时间，
+// S(u)查编译期生成的PROFILE表并线性插值，中断中只有整数运算（ESP32中断内不能使用FPU）
+class StepAxis {
+public:
+    // tick()返回的动作位
+    static constexpr uint8_t ACTION_NONE = 0;
+    static constexpr uint8_t ACTION_STEP_HIGH = 1 << 0;
+    static constexpr uint8_t ACTION_STEP_LOW = 1 << 1;
+    static constexpr uint8_t ACTION_DIR_CHANGE = 1 << 2;
+
+    // 每tick最多走半步（高电平一个tick，低电平至少一个tick）
+    static constexpr uint64_t MAX_RATE = static_cast<uint64_t>(1) << 47;
+
+    // 归一化S曲线 S(u)，Q16定点，u ∈ [0, 1] 分为PROFILE_SIZE段
+    // 加速度在前1/3时间内线性升到峰值，中间1/3保持，后1/3线性降到0：
+    // 峰值加速度 = 1.5V/Tr，加加速度 = 4.5V/Tr²，加速段位移 = V·Tr/2
+    static constexpr int PROFILE_BITS = 8;
+    static constexpr int PROFILE_SIZE = 1 << PROFILE_BITS;
+    static constexpr std::array<uint32_t, PROFILE_SIZE + 1> PROFILE = []() {
+        std::array<uint32_t, PROFILE_SIZE + 1> table{};
+        for (int i = 0; i <= PROFILE_SIZE; i++) {
+            const double x = static_cast<double>(i) / PROFILE_SIZE;
+            double v = 0;
+            if (x <= 1.0 / 3) {
+                v = 2.25 * x * x;
+            } else if (x <= 2.0 / 3) {
+                v = 0.25 + 1.5 * (x - 1.0 / 3);
+            } else {
+                v = 1 - 2.25 * (1 - x) * (1 - x);
+            }
+            table[i] = static_cast<uint32_t>(v * 65536 + 0.5);
+        }
+        return table;
+    }();
+
+    // 从0加速到speed所需的时间（s），同时满足加速度与加加速度限制
+    static float rampTime(float speed, float acceleration, float jerk) {
+        return std::max(1.5f * speed / acceleration, std::sqrt(4.5f * speed / jerk));
+    }
+
+    // 最大速度在下一次从静止开始运动时生效
+    void setMaxSpeed(float speed) {
+        max_rate = speedToRate(speed);
+    }
+
+    void setAcceleration(float value) {
+        acceleration = value;
+        // 减速末段的最低速度，取从静止加速一步所能达到的速度 sqrt(2a)，保证能走完最后几步
+        min_rate = speedToRate(std::sqrt(2.0f * acceleration));
+    }
+
+    void setJerk(float value) {
+        jerk = value;
+    }
+
+    // 恒速运行：以|velocity|（步/s）朝velocity的方向持续运行，没有目标位置
+    // 已在恒速运行时按S曲线从当前速度平滑变到新速度，反向时先减速到0再反向加速，速度为0时减速停止
+    // limit不为0时在本次恒速运行起点+limit处精确停下：剩余距离等于制动距离时交给位置模式减速
+    // 正在按位置运动时返回false；在任务中调用（规划需要浮点运算），中断只执行算好的斜坡
+    bool runVelocity(float velocity, long limit) {
+        if (state != State::IDLE && state != State::VELOCITY) {
+            return false;
+        }
+        const int8_t dir = (velocity >= 0) ? 1 : -1;
+        const float new_speed = std::fabs(velocity);
+        const uint64_t new_rate = speedToRate(new_speed);
+
+        if (state == State::IDLE) {
+            if (new_rate == 0) return true;
+            origin = position;
+            target = position;
+            rate = 0;
+            phase = 0;
+            velocity_from = 0;
+            velocity_to = 0;
+            ramp_pos = UINT32_MAX;
+            pending_rate = 0;
+            if (limit != 0) {
+                const unsigned long distance = (limit >= 0) ? limit : -limit;
+                const float brake_time = rampTime(new_speed, acceleration, jerk);
+                if (distance <= new_speed * brake_time) {
+                    // 距离不够加速到目标速度再减速，按普通的位置运动走完
+                    const uint64_t saved_max_rate = max_rate;
+                    max_rate = new_rate;
+                    setTarget(origin + limit);
+                    max_rate = saved_max_rate;
+                    return true;
+                }
+            }
+            state = State::VELOCITY;
+        }
+
+        b_limit = (limit != 0);
+        limit_position = origin + limit;
+        // 制动距离按当前速度与目标速度中较大者估计，减速时不会超过加速度与加加速度限制
+        const float current_speed = static_cast<float>(rateToSpeed(rate));
+        const float brake_speed = std::max(current_speed, new_speed);
+        const float brake_time = rampTime(brake_speed, acceleration, jerk);
+        brake_steps = static_cast<unsigned long>(brake_speed * brake_time / 2) + 1;
+        brake_inc = rampInc(brake_time);
+
+        velocity_from = rate;
+        ramp_pos = 0;
+        if (rate == 0 || dir != direction) {
+            // 先减速到0（已停下时立即完成），再按等待的方向和速度加速
+            velocity_to = 0;
+            ramp_inc = rampInc(rampTime(current_speed, acceleration, jerk));
+            if (rate == 0) ramp_pos = UINT32_MAX;
+            pending_dir = dir;
+            pending_rate = new_rate;
+            pending_inc = rampInc(rampTime(new_speed, acceleration, jerk));
+        } else {
+            const float delta = std::fabs(new_speed - current_speed);
+            velocity_to = new_rate;
+            ramp_inc = rampInc(rampTime(delta, acceleration, jerk));
+            pending_rate = 0;
+        }
+        return true;
+    }
+
+    bool velocityMode() const { return state == State::VELOCITY; }
+    // 相对最近一次恒速运行起点的位移（步），整步计数，不因变速损失小数步
+    long velocityDisplacement() const { return position - origin; }
+
+    void move(long relative) { setTarget(position + relative); }
+    void moveTo(long absolute) { setTarget(absolute); }
+
+    void setCurrentPosition(long pos) {
+        position = pos;
+        target = pos;
+        rate = 0;
+        ramp_steps = 0;
+        ramp_pos = 0;
+        b_limit = false;
+        state = State::IDLE;
+    }
+
+    // 立即开始减速，停在减速所需的最短距离处
+    void stop() {
+        if (state == State::VELOCITY) {
+            runVelocity(0, 0);
+            return;
+        }
+        if (state == State::IDLE) {
+            target = position;
+            return;
+        }
+        const long stop_steps = static_cast<long>(ramp_steps) + 1;
+        target = position + (direction > 0 ? stop_steps : -stop_steps);
+    }
+
+    uint64_t maxRate() const { return max_rate; }
+    void setMaxRate(uint64_t value) { max_rate = value; }
+
+    // 联动时由主轴驱动的从轴：方向由调用者设置，步进由followStep()强制产生
+    void setDirection(int8_t dir) { direction = dir; }
+
+    __attribute__((always_inline)) inline uint8_t followStep() {
+        position += direction;
+        target = position;
+        pulse_high = true;
+        return ACTION_STEP_HIGH;
+    }
+
+    long distanceToGo() const { return target - position; }
+    long currentPosition() const { return position; }
+    long targetPosition() const { return target; }
+    int8_t currentDirection() const { return direction; }
+    bool isRunning() const { return state != State::IDLE || target != position; }
+
+    // 当前速度（步/s，带符号）
+    float speed() const {
+        return static_cast<float>(rateToSpeed(rate)) * direction;
+    }
+
+    // 由中断每tick调用一次
+    __attribute__((always_inline)) inline uint8_t tick() {
+        uint8_t action = ACTION_NONE;
+        if (pulse_high) {
+            // 上一tick拉高了STEP，本tick拉低，保证脉宽为一个tick
+            // rate不超过半步/tick，所以本tick不会再产生新的一步
+            pulse_high = false;
+            action = ACTION_STEP_LOW;
+        }
+
+        if (state == State::VELOCITY) {
+            return tickVelocity(action);
+        }
+
+        const long remaining = target - position;
+        if (remaining == 0 && state == State::IDLE) {
+            return action;
+        }
+
+        const int8_t wanted = (remaining > 0) ? 1 : ((remaining < 0) ? -1 : direction);
+        if (wanted != direction) {
+            if (state == State::IDLE || rate <= min_rate) {
+                // 已降到最低速度，换向后沿用上次规划的曲线重新加速
+                direction = wanted;
+                rate = 0;
+                ramp_steps = 0;
+                ramp_pos = 0;
+                state = State::ACCEL;
+                return action | ACTION_DIR_CHANGE;
+            }
+            state = State::DECEL;
+        } else {
+            const unsigned long abs_remaining = (remaining >= 0) ? remaining : -remaining;
+            if (abs_remaining == 0) {
+                finish();
+                return action;
+            }
+            if (abs_remaining <= ramp_steps) {
+                // 剩余距离不超过加速段走过的距离，沿S曲线原路减速
+                state = State::DECEL;
+            } else if (state == State::DECEL || state == State::IDLE) {
+                state = (ramp_pos == UINT32_MAX) ? State::CRUISE : State::ACCEL;
+            }
+        }
+
+        switch (state) {
+            case State::ACCEL:
+                if (ramp_pos > UINT32_MAX - ramp_inc) {
+                    ramp_pos = UINT32_MAX;
+                    state = State::CRUISE;
+                } else {
+                    ramp_pos += ramp_inc;
+                }
+                rate = profileRate(ramp_pos);
+                break;
+            case State::DECEL:
+                ramp_pos = (ramp_pos > ramp_inc) ? ramp_pos - ramp_inc : 0;
+                rate = profileRate(ramp_pos);
+                if (rate < min_rate) rate = min_rate;
+                break;
+            default:
+                break;
+        }
+
+        const uint32_t prev_phase = phase;
+        phase += static_cast<uint32_t>(rate >> 16);
+        if (phase < prev_phase) {
+            position += direction;
+            pulse_high = true;
+            action |= ACTION_STEP_HIGH;
+            if (state == State::ACCEL) {
+                ramp_steps++;
+            } else if (state == State::DECEL && ramp_steps > 0) {
+                ramp_steps--;
+            }
+            if (position == target) {
+                finish();
+            }
+        }
+        return action;
+    }
+
+    static constexpr double RATE_ONE_STEP_PER_TICK = 281474976710656.0; // 2^48
+
+    static uint64_t speedToRate(float speed) {
+        if (speed <= 0) return 0;
+        const double rate = static_cast<double>(speed) / STEP_TICK_FREQ * RATE_ONE_STEP_PER_TICK;
+        return (rate >= MAX_RATE) ? MAX_RATE : static_cast<uint64_t>(rate);
+    }
+
+    static double rateToSpeed(uint64_t rate) {
+        return static_cast<double>(rate) / RATE_ONE_STEP_PER_TICK * STEP_TICK_FREQ;
+    }
+
+private:
+    enum class State : uint8_t {
+        IDLE,
+        ACCEL,
+        CRUISE,
+        DECEL,
+        VELOCITY    // 恒速运行，速度在velocity_from与velocity_to之间沿S曲线过渡
+    };
+
+    // 斜坡时长对应的每tick ramp_pos增量
+    static uint32_t rampInc(float ramp_time) {
+        const float ramp_ticks = std::max(ramp_time * STEP_TICK_FREQ, 1.0f);
+        const uint32_t inc = static_cast<uint32_t>(std::min(4294967295.0f / ramp_ticks, 4294967295.0f));
+        return (inc == 0) ? 1 : inc;
+    }
+
+    // 从静止开始一次distance步的运动：确定巡航速度与加速时长
+    // 距离不足以完成完整的加减速时降低巡航速度，保证加加速度始终受限
+    void plan(unsigned long distance) {
+        float cruise = static_cast<float>(rateToSpeed(max_rate));
+        float ramp_time = rampTime(cruise, acceleration, jerk);
+        if (cruise * ramp_time > distance) {
+            const float d = static_cast<float>(distance);
+            const float accel_limited = std::sqrt(d * acceleration / 1.5f);
+            const float jerk_limited = std::cbrt(d * d * jerk / 4.5f);
+            cruise = std::min(accel_limited, jerk_limited);
+            ramp_time = rampTime(cruise, acceleration, jerk);
+        }
+        cruise_rate = speedToRate(cruise);
+        ramp_inc = rampInc(ramp_time);
+        ramp_pos = 0;
+        ramp_steps = 0;
+        state = State::ACCEL;
+    }
+
+    void setTarget(long value) {
+        target = value;
+        if (state == State::IDLE && target != position) {
+            const long distance = target - position;
+            plan((distance >= 0) ? distance : -distance);
+        }
+    }
+
+    // S(pos)，Q16
+    __attribute__((always_inline)) static inline uint64_t profileAt(uint32_t pos) {
+        const uint32_t index = pos >> (32 - PROFILE_BITS);
+        const uint32_t frac = (pos >> (16 - PROFILE_BITS)) & 0xffff;
+        const uint32_t lo = PROFILE[index];
+        const uint32_t hi = PROFILE[index + 1];
+        return lo + ((static_cast<uint64_t>(hi - lo) * frac) >> 16);
+    }
+
+    __attribute__((always_inline)) inline uint64_t profileRate(uint32_t pos) const {
+        return (cruise_rate >> 16) * profileAt(pos);
+    }
+
+    // 恒速运行的变速曲线：从velocity_from沿S曲线到velocity_to，升速降速都适用
+    __attribute__((always_inline)) inline uint64_t blendRate(uint32_t pos) const {
+        const uint64_t s = profileAt(pos);
+        if (velocity_to >= velocity_from) {
+            return velocity_from + ((velocity_to - velocity_from) >> 16) * s;
+        }
+        return velocity_from - ((velocity_from - velocity_to) >> 16) * s;
+    }
+
+    __attribute__((always_inline)) inline uint8_t tickVelocity(uint8_t action) {
+        if (ramp_pos != UINT32_MAX) {
+            ramp_pos = (ramp_pos > UINT32_MAX - ramp_inc) ? UINT32_MAX : ramp_pos + ramp_inc;
+            rate = blendRate(ramp_pos);
+        }
+
+        if (ramp_pos == UINT32_MAX && velocity_to == 0) {
+            if (pending_rate == 0) {
+                target = position;
+                finish();
+                return action;
+            }
+            // 已停下，按等待的方向和速度重新加速
+            velocity_from = 0;
+            velocity_to = pending_rate;
+            ramp_inc = pending_inc;
+            ramp_pos = 0;
+            pending_rate = 0;
+            if (pending_dir != direction) {
+                direction = pending_dir;
+                action |= ACTION_DIR_CHANGE;
+            }
+        }
+
+        if (b_limit) {
+            const long ahead = (limit_position - position) * direction;
+            if (ahead <= static_cast<long>(brake_steps)) {
+                // 交给位置模式：以当前速度为巡航速度沿S曲线减速，停在limit_position
+                target = limit_position;
+                rate = std::max(rate, min_rate);
+                cruise_rate = rate;
+                ramp_pos = UINT32_MAX;
+                ramp_inc = brake_inc;
+                ramp_steps = (ahead > 0) ? ahead : 0;
+                b_limit = false;
+                state = State::CRUISE;
+                return action;
+            }
+        }
+
+        const uint32_t prev_phase = phase;
+        phase += static_cast<uint32_t>(rate >> 16);
+        if (phase < prev_phase) {
+            position += direction;
+            target = position;
+            pulse_high = true;
+            action |= ACTION_STEP_HIGH;
+        }
+        return action;
+    }
+
+    __attribute__((always_inline)) inline void finish() {
+        rate = 0;
+        ramp_steps = 0;
+        ramp_pos = 0;
+        phase = 0;
+        b_limit = false;
+        state = State::IDLE;
+    }
+
+    long position = 0;
+    long target = 0;
+
+    uint32_t phase = 0;
+    uint64_t rate = 0;          // 相位增量，Q16定点（phase += rate >> 16）
+    uint64_t max_rate = 0;
+    uint64_t min_rate = 0;
+    uint64_t cruise_rate = 0;   // 本次运动的巡航速度
+    uint32_t ramp_pos = 0;      // S曲线上的归一化位置，UINT32_MAX对应加速完成
+    uint32_t ramp_inc = 1;      // 每tick的ramp_pos增量
+    unsigned long ramp_steps = 0; // 加速段已走的步数，减速时用作剩余制动距离
+
+    // 恒速运行
+    long origin = 0;            // 本次恒速运行开始时的位置，totalizer以此为零点
+    uint64_t velocity_from = 0; // 当前变速段的起止速度
+    uint64_t velocity_to = 0;
+    uint64_t pending_rate = 0;  // 减速到0后反向加速到的速度，0为停止
+    uint32_t pending_inc = 1;
+    int8_t pending_dir = 1;
+    bool b_limit = false;
+    long limit_position = 0;
+    unsigned long brake_steps = 0; // 从目标速度制动所需的距离
+    uint32_t brake_inc = 1;
+
+    float acceleration = 1;     // 步/s²
+    float jerk = 1;             // 步/s³
+
+    State state = State::IDLE;
+    int8_t direction = 1;
+    bool pulse_high = false;
+};
+
+// 定时器驱动的步进引擎，独占所有轴的STEP/DIR引脚
+// 中断固定以STEP_TICK_FREQ运行，不受loop()中打印、485等待等阻塞操作影响
+class StepEngine {
+private:
+    struct AxisPins {
+        uint8_t step;
+        uint8_t dir;
+    };
+
+    std::array<StepAxis, STEP_AXIS_COUNT> axes;
+    // 中断中只访问这张紧凑的引脚表，由AXIS_REGISTRY生成
+    static constexpr std::array<AxisPins, STEP_AXIS_COUNT> pins = [] {
+        std::array<AxisPins, STEP_AXIS_COUNT> res{};
+        for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+            res[i] = {AXIS_REGISTRY[i].step_pin, AXIS_REGISTRY[i].dir_pin};
+        }
+        return res;
+    }();
+
+    hal::SpinLock lock;
+
+    // 联动状态：主轴按自身S曲线运行，其余轴用Bresenham按主轴步数插补
+    struct Coordination {
+        bool active = false;
+        StepAxisId master = SYRINGE_AXIS;
+        unsigned long major_steps = 0;
+        std::array<unsigned long, STEP_AXIS_COUNT> minor_steps{};
+        std::array<long, STEP_AXIS_COUNT> error{};
+        uint64_t saved_max_rate = 0; // 联动结束后恢复主轴原来的最大速度
+    } coordination;
+
+    instr::JitterMeter jitter;
+
+    static void onTimer(void* arg);
+
+public:
+    void begin();
+
+    void setMaxSpeed(StepAxisId axis, float speed);
+    void setAcceleration(StepAxisId axis, float acceleration);
+    void setJerk(StepAxisId axis, float jerk);
+    // 轴正在联动或恒速运行时返回false，不改变目标
+    bool move(StepAxisId axis, long relative);
+    bool moveTo(StepAxisId axis, long absolute);
+    void stop(StepAxisId axis);
+    void setCurrentPosition(StepAxisId axis, long position);
+
+    // 恒速运行，velocity为步/s（带符号），limit见StepAxis::runVelocity
+    // 正在联动或按位置运动时返回false
+    bool runVelocity(StepAxisId axis, float velocity, long limit);
+    // 相对最近一次恒速运行起点的位移（步）
+    long velocityDisplacement(StepAxisId axis);
+
+    // 所有轴同时开始、同时结束的联动运动，步数最多的轴为主轴，以master_speed（步/s）巡航
+    // 任一轴正在运动时返回false
+    bool moveCoordinated(const std::array<long, STEP_AXIS_COUNT>& steps, float master_speed);
+
+    long distanceToGo(StepAxisId axis);
+    long currentPosition(StepAxisId axis);
+    float speed(StepAxisId axis);
+    bool isRunning(StepAxisId axis);
+};
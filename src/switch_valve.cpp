@@ -0,0 +1,191 @@
+#include "switch_valve.hpp"
+
+#include "hal.hpp"
+#include "host_log.hpp"
+#include "misc.hpp"
+
+#include <array>
+#include <format>
+#include <string>
+#include <variant>
+
+// 切换阀功能码
+constexpr uint8_t SWITCH_OP_CHECK = 0x3e;
+constexpr uint8_t SWITCH_OP_STATUS = 0x4a;
+constexpr uint8_t SWITCH_OP_CHANNEL = 0x44;
+constexpr uint8_t SWITCH_OP_RESET = 0x45;
+
+SwitchValve::SwitchValve(Rs485Bus& rs485_bus, const SwitchValveDescriptor& descriptor)
+    : bus(rs485_bus), desc(descriptor) {
+    // 设备数由SWITCH_VALVE_COUNT <= RS485_MAX_DEVICES在编译期保证
+    device = static_cast<size_t>(bus.attach(desc.address, desc.priority));
+    channel = 0;
+    b_valid = false;
+    channel_ms = 0;
+    motor_state = 0;
+    b_state_valid = false;
+    state_ms = 0;
+    moving = 0;
+    pending = 0;
+    stats = {};
+}
+
+bool SwitchValve::cacheFresh() const {
+    return b_valid && moving == 0 && pending == 0 && hal::millis() - channel_ms < SWITCH_CACHE_TTL_MS;
+}
+
+bool SwitchValve::submit(const SwitchCommand& command) {
+    std::array<uint8_t, INSTR_485_LEN> frame{};
+    if (!buildSwitchFrame(command, desc.address, frame.data())) {
+        return false;
+    }
+    if (!bus.submit(device, frame.data(), onResponse, this)) {
+        hostLog().at(LogLevel::ERROR).println("485队列已满，指令被丢弃");
+        return false;
+    }
+    stats.sent++;
+    return true;
+}
+
+bool SwitchValve::startMove(uint8_t target) {
+    if (b_valid && channel == target) {
+        stats.skipped++;
+        std::string msg_str = std::format("{}已在通道{}，不再发送\n", desc.name, target);
+        hostLog().print(msg_str);
+        return true;
+    }
+    if (!submit(SwitchChannel{target})) {
+        return false;
+    }
+    moving = target;
+    return true;
+}
+
+bool SwitchValve::request(const SwitchCommand& command) {
+    if (const auto* move = std::get_if<SwitchChannel>(&command)) {
+        if (move->channel < 1 || move->channel > SWITCH_CHANNEL_COUNT) {
+            std::string msg_str = std::format("通道数错误，应在1~{}之间\n", SWITCH_CHANNEL_COUNT);
+            hostLog().at(LogLevel::WARN).print(msg_str);
+            return false;
+        }
+        const uint8_t target = static_cast<uint8_t>(move->channel);
+        if (moving != 0) {
+            // 阀正在转动，只记住最终目标，中间目标不再发送
+            if (pending != 0) {
+                stats.coalesced++;
+            }
+            pending = target;
+            std::string msg_str = std::format("{}正在转到通道{}，之后转到通道{}\n", desc.name, moving, target);
+            hostLog().print(msg_str);
+            return true;
+        }
+        return startMove(target);
+    }
+
+    if (std::holds_alternative<SwitchCheck>(command) && cacheFresh()) {
+        stats.cached++;
+        std::string msg_str = std::format("{}当前通道：{}（缓存，{}ms前确认）\n",
+                                          desc.name, channel, hal::millis() - channel_ms);
+        hostLog().print(msg_str);
+        return true;
+    }
+    if (std::holds_alternative<SwitchStatus>(command) && b_state_valid && moving == 0 && pending == 0
+        && hal::millis() - state_ms < SWITCH_CACHE_TTL_MS) {
+        stats.cached++;
+        std::string msg_str = std::format("{}状态：{:02X}（缓存，{}ms前确认）\n",
+                                          desc.name, motor_state, hal::millis() - state_ms);
+        hostLog().print(msg_str);
+        return true;
+    }
+
+    if (std::holds_alternative<SwitchReset>(command) || std::holds_alternative<SwitchRaw>(command)) {
+        // 复位后的位置、RAW指令的效果都未知，等待的切换也一并取消
+        if (pending != 0) {
+            stats.coalesced++;
+            pending = 0;
+        }
+        b_valid = false;
+        b_state_valid = false;
+    }
+    return submit(command);
+}
+
+void SwitchValve::maintain() {
+    if (pending != 0 && moving == 0) {
+        const uint8_t target = pending;
+        pending = 0;
+        if (!startMove(target)) {
+            // 合并后的目标没能发出，阀停在哪里已不确定
+            b_valid = false;
+        }
+    }
+}
+
+void SwitchValve::onResponse(const Rs485Transaction& txn, void* context) {
+    static_cast<SwitchValve*>(context)->handleResponse(txn);
+}
+
+void SwitchValve::handleResponse(const Rs485Transaction& txn) {
+    printSwitchResponse(txn, nullptr);
+
+    const uint8_t op = txn.request[2];
+    if (op == SWITCH_OP_CHANNEL) {
+        moving = 0;
+    }
+
+    if (txn.status != Rs485Status::OK) {
+        // 没有可信的应答，位置不再确定
+        if (op == SWITCH_OP_CHANNEL || op == SWITCH_OP_RESET) {
+            b_valid = false;
+        }
+        return;
+    }
+
+    const uint8_t state = txn.response[2];
+    const uint32_t now = hal::millis();
+    motor_state = state;
+    b_state_valid = true;
+    state_ms = now;
+
+    switch (op) {
+        case SWITCH_OP_CHANNEL:
+            // 转到位后才应答，应答正常即位于请求的通道
+            b_valid = (state == SWITCH_REPLY_OK);
+            channel = txn.request[3];
+            channel_ms = now;
+            break;
+        case SWITCH_OP_CHECK:
+            b_valid = (state == SWITCH_REPLY_OK && txn.response[3] >= 1 && txn.response[3] <= SWITCH_CHANNEL_COUNT);
+            channel = txn.response[3];
+            channel_ms = now;
+            break;
+        case SWITCH_OP_RESET:
+            // 复位后重新查询一次通道，使缓存恢复有效
+            if (state == SWITCH_REPLY_OK) {
+                submit(SwitchCheck{});
+            }
+            break;
+        case SWITCH_OP_STATUS:
+        default:
+            break;
+    }
+}
+
+void SwitchValve::printCache() const {
+    std::string msg_str;
+    if (b_valid) {
+        msg_str = std::format("{}（地址{}）缓存：通道{}，{}ms前确认{}\n", desc.name, desc.address, channel,
+                              hal::millis() - channel_ms, cacheFresh() ? "" : "（已过期）");
+    } else {
+        msg_str = std::format("{}（地址{}）缓存：通道未知\n", desc.name, desc.address);
+    }
+    if (moving != 0) {
+        msg_str += std::format("正在转到通道{}\n", moving);
+    }
+    if (pending != 0) {
+        msg_str += std::format("等待转到通道{}\n", pending);
+    }
+    msg_str += std::format("已发送{}帧，跳过{}次切换，合并{}个目标，缓存回答{}次查询\n",
+                           stats.sent, stats.skipped, stats.coalesced, stats.cached);
+    hostLog().print(msg_str);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "board_config.hpp"
+#include "constants.hpp"
+#include "rs485_bus.hpp"
+#include "types.hpp"
+
+// 切换阀应答帧：CC [地址] [状态] [参数低] [参数高] DD [校验和低] [校验和高]
+// 状态为0表示正常；查询通道（0x3E）的参数低字节为当前通道，切换（0x44）在转到位后才应答
+constexpr uint8_t SWITCH_REPLY_OK = 0x00;
+
+// 切换阀位置缓存统计，diag/sv -cache查看
+struct SwitchValveStats {
+    uint32_t sent;          // 实际发出的帧数
+    uint32_t skipped;       // 目标已是当前通道而未发送的切换
+    uint32_t coalesced;     // 被后续切换覆盖、未发送的目标
+    uint32_t cached;        // 由缓存直接回答的查询
+};
+
+// 切换阀驱动：把文本/二进制/配方的切换阀指令翻译成发往本阀地址的485帧，并用应答维护位置缓存
+// - 目标已是缓存中的当前通道时不发送，省去约1s的响应时间
+// - 切换进行中收到的新目标只保留最后一个，上一次切换应答后再发出
+// - 缓存在TTL内时，通道与状态查询直接由缓存回答
+// 超时、校验失败、错误状态、复位和RAW指令都会使缓存失效，之后的切换一定会发出
+class SwitchValve {
+private:
+    Rs485Bus& bus;
+    const SwitchValveDescriptor& desc;
+    size_t device;          // 在bus上的设备编号
+
+    uint8_t channel;        // 缓存的当前通道，b_valid为false时无意义
+    bool b_valid;
+    uint32_t channel_ms;    // 通道最近一次由应答确认的时刻
+    uint8_t motor_state;    // 最近一次应答的状态字节
+    bool b_state_valid;
+    uint32_t state_ms;
+
+    uint8_t moving;         // 已发出、尚未应答的切换目标，0为无
+    uint8_t pending;        // 等待上一次切换结束的目标，0为无
+
+    SwitchValveStats stats;
+
+    bool submit(const SwitchCommand& command);
+    // 目标已是当前通道时不发送也算成功，485队列已满时返回false
+    bool startMove(uint8_t target);
+    void handleResponse(const Rs485Transaction& txn);
+    static void onResponse(const Rs485Transaction& txn, void* context);
+
+public:
+    // 在bus上注册本阀的地址与优先级
+    SwitchValve(Rs485Bus& rs485_bus, const SwitchValveDescriptor& descriptor);
+
+    // 指令格式错误或485队列已满时返回false
+    bool request(const SwitchCommand& command);
+    // 指令核心每毫秒调用，上一次切换结束后发出合并后的目标
+    void maintain();
+
+    // 有切换在进行或等待发出，或本阀在总线上还有事务
+    bool busy() const { return moving != 0 || pending != 0 || bus.busy(device); }
+    // 缓存的当前通道，未知时为0
+    uint8_t currentChannel() const { return b_valid ? channel : 0; }
+    bool cacheFresh() const;
+    const SwitchValveStats& statistics() const { return stats; }
+    const SwitchValveDescriptor& descriptor() const { return desc; }
+    size_t busDevice() const { return device; }
+    void printCache() const;
+};
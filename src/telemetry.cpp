@@ -0,0 +1,91 @@
+#include "telemetry.hpp"
+
+#include "binary_protocol.hpp"
+#include "ctrl_board_manager.hpp"
+#include "hal.hpp"
+#include "host_log.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstring>
+
+Telemetry::Telemetry(CtrlBoardManager& board_manager) : manager(board_manager) {
+    rate = 0;
+    period_ms = 0;
+    last_sample_ms = 0;
+    seq = 0;
+    dropped = 0;
+    sent = 0;
+}
+
+bool Telemetry::setRate(uint16_t hz) {
+    if (hz > TELEMETRY_MAX_RATE) {
+        return false;
+    }
+    rate = hz;
+    if (hz == 0) {
+        TelemetrySample discard;
+        while (samples.pop(discard)) {}
+        period_ms = 0;
+        return true;
+    }
+    period_ms = 1000 / hz;
+    last_sample_ms = hal::millis() - period_ms; // 下一次maintain立即采样
+    return true;
+}
+
+void Telemetry::sample(uint32_t now) {
+    const BoardStatus status = manager.getStatus();
+    TelemetrySample item {
+        .time_ms = now,
+        .positions = {},
+        .speeds = {},
+        .motor_flags = static_cast<uint8_t>(status.runningMask()),
+        .solenoid_valve_status = status.solenoid_valve_status,
+        .cur_pressure = static_cast<uint16_t>(status.cur_pressure),
+        .switch_channel = status.switch_channel,
+        .light_status = status.light_status,
+        .dropped = dropped,
+    };
+    for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+        item.positions[i] = static_cast<int32_t>(status.axes[i].position);
+        item.speeds[i] = status.axes[i].speed;
+    }
+    // 缓冲区满时丢弃最新采样，已缓冲的采样保持时间连续
+    if (!samples.push(item)) {
+        dropped++;
+    }
+}
+
+void Telemetry::maintain() {
+    if (rate == 0) {
+        return;
+    }
+
+    const uint32_t now = hal::millis();
+    if (now - last_sample_ms >= period_ms) {
+        // 按固定节拍推进，落后超过一个周期时重新对齐，不补采
+        last_sample_ms += period_ms;
+        if (now - last_sample_ms >= period_ms) {
+            last_sample_ms = now;
+        }
+        sample(now);
+    }
+
+    // [seq][TELEMETRY_DATA | 0x80][OK][TelemetrySample]
+    constexpr size_t frame_len = 3 + sizeof(TelemetrySample);
+    static_assert(frame_len <= BINARY_FRAME_MAX, "遥测帧超过BINARY_FRAME_MAX");
+    constexpr size_t wire_len = cobsMaxEncodedLen(frame_len + 2) + 2;
+
+    TelemetrySample item;
+    // 给文本回复至少留出一行的空间，遥测不挤占输出队列
+    while (hostLog().freeSpace() >= wire_len + LOG_LINE_MAX && samples.pop(item)) {
+        std::array<uint8_t, frame_len> frame;
+        frame[0] = seq++;
+        frame[1] = static_cast<uint8_t>(BinaryOpcode::TELEMETRY_DATA) | 0x80;
+        frame[2] = static_cast<uint8_t>(BinaryResult::OK);
+        std::memcpy(frame.data() + 3, &item, sizeof(item));
+        sendBinaryFrame(frame.data(), frame.size());
+        sent++;
+    }
+}
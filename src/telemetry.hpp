@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "axis_registry.hpp"
+#include "constants.hpp"
+#include "spsc_queue.hpp"
+
+class CtrlBoardManager;
+
+// 遥测采样，作为TELEMETRY_DATA帧的数据部分发送，小端序
+#pragma pack(push, 1)
+struct TelemetrySample {
+    uint32_t time_ms;
+    int32_t positions[STEP_AXIS_COUNT]; // 微步，按StepAxisId索引，两轴时与旧格式相同
+    float speeds[STEP_AXIS_COUNT];      // 微步/s，带符号
+    uint8_t motor_flags;            // bit i: 轴i运行中
+    uint32_t solenoid_valve_status; // 电磁阀位图，bit0为通道1
+    uint16_t cur_pressure;          // kPa
+    uint8_t switch_channel;
+    uint8_t light_status;
+    uint16_t dropped;               // 累计因缓冲区满丢弃的采样数
+};
+#pragma pack(pop)
+
+// 周期遥测：按设定频率采样到环形缓冲区，上位机输出队列有空间时再以二进制帧发出
+// 采样与发送都在指令核心上进行，发送永远不会阻塞指令核心
+class Telemetry {
+private:
+    CtrlBoardManager& manager;
+
+    SpscQueue<TelemetrySample, TELEMETRY_BUFFER_LEN> samples;
+
+    uint16_t rate;          // Hz，0为关闭
+    uint32_t period_ms;
+    uint32_t last_sample_ms;
+    uint8_t seq;            // 遥测帧序号，与应答帧的seq各自独立
+    uint16_t dropped;
+    uint32_t sent;
+
+    void sample(uint32_t now);
+
+public:
+    explicit Telemetry(CtrlBoardManager& board_manager);
+
+    // rate为0时关闭并清空缓冲区，超过TELEMETRY_MAX_RATE返回false
+    bool setRate(uint16_t hz);
+    uint16_t currentRate() const { return rate; }
+    size_t buffered() const { return samples.size(); }
+    uint16_t droppedCount() const { return dropped; }
+    uint32_t sentCount() const { return sent; }
+
+    // 指令核心每毫秒调用
+    void maintain();
+};
@@ -1,9 +1,13 @@
 #pragma once
 
-#include <string>
+#include <array>
+#include <cstdint>
+#include <string_view>
 #include <variant>
+#include "axis_registry.hpp"
 
-enum class SyringeFinetuneType : unsigned char {
+// 微调：以微调速度向很远的目标移动，直到收到停止指令
+enum class FinetuneType : unsigned char {
     SPEED_UP = 0,
     SLOW_UP = 1,
     SLOW_DOWN = 2,
@@ -11,9 +15,88 @@ enum class SyringeFinetuneType : unsigned char {
 };
 
 // 旋转阀指令类型
-struct SwitchRaw { std::string raw_cmd; };
+struct SwitchRaw { std::string_view raw_cmd; };
 struct SwitchCheck {};
 struct SwitchStatus {};
 struct SwitchChannel { int channel; };
 struct SwitchReset {};
-using SwitchCommand = std::variant<SwitchRaw, SwitchCheck, SwitchStatus, SwitchChannel, SwitchReset>;
\ No newline at end of file
+using SwitchCommand = std::variant<SwitchRaw, SwitchCheck, SwitchStatus, SwitchChannel, SwitchReset>;
+
+// 485事务状态
+enum class Rs485Status : unsigned char {
+    PENDING = 0,
+    OK = 1,
+    TIMEOUT = 2,
+    BAD_CHECKSUM = 3
+};
+
+// 上位机通信协议
+enum class HostProtocol : unsigned char {
+    TEXT = 0,   // 以\n结尾的文本指令
+    BINARY = 1  // COBS编码、CRC16校验的二进制帧
+};
+
+// 电磁阀位图，bit0为通道1，有效位数为SOLENOID_CHANNELS
+using SolenoidMask = uint32_t;
+
+// 单轴状态
+struct AxisStatus {
+    long position;  // 微步
+    float speed;    // 微步/s，带符号
+    bool b_running;
+};
+
+// 板上所有外设的状态快照
+struct BoardStatus {
+    std::array<AxisStatus, STEP_AXIS_COUNT> axes; // 按StepAxisId索引
+    unsigned char switch_channel;   // 切换阀应答确认的通道，未知时为0
+    SolenoidMask solenoid_valve_status;
+    int cur_pressure;           // kPa，闭环时为传感器读数，否则按DAC实际输出换算
+    int max_pressure;
+    unsigned char brightness;
+    bool light_status;
+
+    // bit i为轴i正在运动
+    uint32_t runningMask() const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < STEP_AXIS_COUNT; i++) {
+            mask |= static_cast<uint32_t>(axes[i].b_running) << i;
+        }
+        return mask;
+    }
+};
+
+// 运动核心指令：由指令核心投递到运动核心执行
+enum class MotionOp : unsigned char {
+    SET_MAX_SPEED = 0,  // value: 步/s
+    MOVE = 1,           // steps: 相对位移
+    STOP = 2,
+    MOVE_COORDINATED = 3, // axis_steps: 各轴步数，value: 主轴速度(步/s)
+    SET_ACCELERATION = 4, // value: 步/s²
+    SET_JERK = 5,         // value: 步/s³
+    RUN_VELOCITY = 6,     // value: 步/s（带符号），steps: 相对本次起点的停止位移，0为不限
+    SET_VELOCITY = 7      // 同RUN_VELOCITY，只改变进行中的恒速运行，已停下或已进入最后制动时忽略
+};
+
+struct MotionCommand {
+    MotionOp op;
+    unsigned char axis;
+    long steps;
+    float value;
+    std::array<long, STEP_AXIS_COUNT> axis_steps{};
+};
+
+// 运动核心事件：由运动核心回报给指令核心
+enum class MotionEventType : unsigned char {
+    MOTION_DONE = 0,
+    COORDINATED_REJECTED = 1, // 有电机正在运动，联动未启动
+    MOVE_REJECTED = 2,        // 该轴正在联动或恒速运行，单轴运动被忽略
+    VELOCITY_DONE = 3,        // 恒速运行结束，steps为本次运行的位移
+    VELOCITY_REJECTED = 4     // 该轴正在联动或按位置运动，恒速运行未启动
+};
+
+struct MotionEvent {
+    MotionEventType type;
+    unsigned char axis;
+    long steps = 0;
+};
\ No newline at end of file
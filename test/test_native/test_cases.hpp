@@ -0,0 +1,48 @@
+#pragma once
+
+// env:native的单元测试用例，每个源文件一组，由test_main.cpp依次运行
+// 被测代码与固件相同，时间由模拟HAL的虚拟时钟推进，setUp()中清空日志与时钟
+
+// test_command_parser.cpp
+void testTokenizeSplitsOnSpaces();
+void testTokenizeOverflow();
+void testParseNumber();
+void testParseNumberBase();
+void testDispatchFlag();
+
+// test_protocol.cpp
+void testSwitchChecksum();
+void testBuildSwitchFrame();
+void testSwitchRawFrame();
+void testCrc16();
+void testCobsRoundTrip();
+void testCobsRejectsMalformed();
+
+// test_step_axis.cpp
+void testStepAxisReachesTarget();
+void testStepAxisPulseWidth();
+void testStepAxisReverse();
+void testStepAxisStop();
+void testStepAxisVelocityLimit();
+void testStepAxisPulseSpacing();
+void testStepAxisBoardAxes();
+
+// test_solenoid.cpp
+void testSolenoidPulseTiming();
+void testSolenoidStagger();
+void testSolenoidContinuousCancel();
+void testSolenoidLatePulse();
+
+// test_pressure.cpp
+void testPressureLoopStep();
+void testPressureOpenLoopError();
+void testPressureLongWave();
+
+// test_rs485_bus.cpp
+void testRs485Scheduling();
+void testRs485QueueFull();
+void testRs485LateReply();
+void testRs485OfflineDevice();
+
+// test_led.cpp
+void testLedAnimationLimits();
@@ -0,0 +1,124 @@
+#include <unity.h>
+
+#include "command_parser.hpp"
+#include "test_cases.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+void testTokenizeSplitsOnSpaces() {
+    const CommandTokens tokens = tokenizeCommand("  sp   -fv 1.5 ");
+    TEST_ASSERT_EQUAL(3, tokens.size());
+    TEST_ASSERT_FALSE(tokens.overflow);
+    TEST_ASSERT_TRUE(tokens[0] == "sp");
+    TEST_ASSERT_TRUE(tokens[1] == "-fv");
+    TEST_ASSERT_TRUE(tokens[2] == "1.5");
+
+    TEST_ASSERT_EQUAL(0, tokenizeCommand("").size());
+    TEST_ASSERT_EQUAL(0, tokenizeCommand("    ").size());
+
+    // 编译期也能分词
+    static_assert(tokenizeCommand("sov -c 3 1").size() == 4);
+}
+
+void testTokenizeOverflow() {
+    const CommandTokens full = tokenizeCommand("rc -add co 1 -2 20");
+    TEST_ASSERT_EQUAL(MAX_COMMAND_TOKENS, full.size());
+    TEST_ASSERT_FALSE(full.overflow);
+
+    // 多出的token不写进表，只置overflow
+    const CommandTokens over = tokenizeCommand("rc -add co 1 -2 20 7");
+    TEST_ASSERT_EQUAL(MAX_COMMAND_TOKENS, over.size());
+    TEST_ASSERT_TRUE(over.overflow);
+    TEST_ASSERT_TRUE(over[MAX_COMMAND_TOKENS - 1] == "20");
+}
+
+void testParseNumber() {
+    float f = 0;
+    TEST_ASSERT_TRUE(parseNumber("1.5", f));
+    TEST_ASSERT_EQUAL_FLOAT(1.5f, f);
+    TEST_ASSERT_TRUE(parseNumber("-0.25", f));
+    TEST_ASSERT_EQUAL_FLOAT(-0.25f, f);
+
+    long l = 0;
+    TEST_ASSERT_TRUE(parseNumber("200000", l));
+    TEST_ASSERT_EQUAL(200000, l);
+    TEST_ASSERT_TRUE(parseNumber("-3", l));
+    TEST_ASSERT_EQUAL(-3, l);
+
+    // 整个token都必须是数字
+    TEST_ASSERT_FALSE(parseNumber("abc", f));
+    TEST_ASSERT_FALSE(parseNumber("1.5x", f));
+    TEST_ASSERT_FALSE(parseNumber("", f));
+    TEST_ASSERT_FALSE(parseNumber("12 ", l));
+    TEST_ASSERT_FALSE(parseNumber("1.5", l));
+
+    // 超出类型范围
+    uint8_t u8 = 0;
+    TEST_ASSERT_FALSE(parseNumber("256", u8));
+    TEST_ASSERT_FALSE(parseNumber("-1", u8));
+}
+
+void testParseNumberBase() {
+    uint32_t mask = 0;
+    TEST_ASSERT_TRUE(parseNumber("c3", mask, 16));
+    TEST_ASSERT_EQUAL_HEX32(0xc3, mask);
+    TEST_ASSERT_TRUE(parseNumber("FFFFFFFF", mask, 16));
+    TEST_ASSERT_EQUAL_HEX32(0xffffffff, mask);
+    TEST_ASSERT_TRUE(parseNumber("11000011", mask, 2));
+    TEST_ASSERT_EQUAL_HEX32(0xc3, mask);
+
+    TEST_ASSERT_FALSE(parseNumber("12", mask, 2));
+    TEST_ASSERT_FALSE(parseNumber("0x10", mask, 16));
+    TEST_ASSERT_FALSE(parseNumber("100000000", mask, 16));
+}
+
+namespace {
+
+struct FlagOwner {
+    int last = 0;
+    float value = 0;
+};
+
+constexpr std::array<FlagEntry<FlagOwner>, 3> FLAG_TABLE {{
+    {"-s", 2, [](FlagOwner& owner, const CommandTokens&) {
+        owner.last = 1;
+        return true;
+    }},
+    {"-v", 3, [](FlagOwner& owner, const CommandTokens& tokens) {
+        owner.last = 2;
+        return parseNumber(tokens[2], owner.value);
+    }},
+    // 同一flag按token数区分
+    {"-v", 2, [](FlagOwner& owner, const CommandTokens&) {
+        owner.last = 3;
+        return true;
+    }},
+}};
+
+} // namespace
+
+void testDispatchFlag() {
+    FlagOwner owner;
+    TEST_ASSERT_TRUE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp -s")));
+    TEST_ASSERT_EQUAL(1, owner.last);
+
+    TEST_ASSERT_TRUE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp -v 12000")));
+    TEST_ASSERT_EQUAL(2, owner.last);
+    TEST_ASSERT_EQUAL_FLOAT(12000.0f, owner.value);
+
+    TEST_ASSERT_TRUE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp -v")));
+    TEST_ASSERT_EQUAL(3, owner.last);
+
+    // handler的返回值原样传出
+    TEST_ASSERT_FALSE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp -v abc")));
+    TEST_ASSERT_EQUAL(2, owner.last);
+
+    // flag或token数不匹配时不调用任何handler
+    owner.last = 0;
+    TEST_ASSERT_FALSE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp -s 1")));
+    TEST_ASSERT_FALSE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp -x")));
+    TEST_ASSERT_FALSE(dispatchFlag(FLAG_TABLE, owner, tokenizeCommand("sp")));
+    TEST_ASSERT_EQUAL(0, owner.last);
+}
@@ -0,0 +1,50 @@
+#include <unity.h>
+
+#include "constants.hpp"
+#include "hal_native.hpp"
+#include "led_engine.hpp"
+#include "test_cases.hpp"
+
+#include <cstdint>
+
+// 闪烁周期on_ms + off_ms在uint32中回绕为0时会在maintain()中除零，超出上限的时长必须在animate()中拒绝
+void testLedAnimationLimits() {
+    if (NUM_LEDS == 0) TEST_IGNORE_MESSAGE("板上没有光源");
+    LedEngine engine;
+    engine.begin();
+    engine.setOn(true);
+
+    const LedAnimation blink {.type = LedAnimationType::BLINK, .mask = LED_MASK_ALL, .on_ms = 100, .off_ms = 100};
+    TEST_ASSERT_TRUE(engine.animate(blink));
+
+    LedAnimation wrapped = blink;
+    wrapped.on_ms = 0x80000000;
+    wrapped.off_ms = 0x80000000;
+    TEST_ASSERT_FALSE(engine.animate(wrapped));
+    LedAnimation long_on = blink;
+    long_on.on_ms = LED_ANIMATION_MAX_MS + 1;
+    TEST_ASSERT_FALSE(engine.animate(long_on));
+    LedAnimation long_off = blink;
+    long_off.off_ms = LED_ANIMATION_MAX_MS + 1;
+    TEST_ASSERT_FALSE(engine.animate(long_off));
+    const LedAnimation long_breathe {.type = LedAnimationType::BREATHE, .mask = LED_MASK_ALL, .on_ms = LED_ANIMATION_MAX_MS + 1};
+    TEST_ASSERT_FALSE(engine.animate(long_breathe));
+
+    // 被拒绝的动画不取代正在播放的闪烁
+    TEST_ASSERT_TRUE(engine.animationType() == LedAnimationType::BLINK);
+    for (int ms = 0; ms < 300; ms++) {
+        engine.maintain();
+        hal::native::advanceUs(1000);
+    }
+    TEST_ASSERT_TRUE(engine.animationType() == LedAnimationType::BLINK);
+
+    // 上限本身可用
+    LedAnimation longest = blink;
+    longest.on_ms = LED_ANIMATION_MAX_MS;
+    longest.off_ms = LED_ANIMATION_MAX_MS;
+    TEST_ASSERT_TRUE(engine.animate(longest));
+    const LedAnimation longest_breathe {.type = LedAnimationType::BREATHE, .mask = LED_MASK_ALL, .on_ms = LED_ANIMATION_MAX_MS};
+    TEST_ASSERT_TRUE(engine.animate(longest_breathe));
+    engine.maintain();
+    engine.stopAnimation();
+}
@@ -0,0 +1,56 @@
+// env:native单元测试入口：pio test -e native
+// 被测源文件随test_build_src = yes一起编译，host_main.cpp的main()在PIO_UNIT_TESTING下不参与编译
+
+#include <unity.h>
+
+#include "hal_native.hpp"
+#include "test_cases.hpp"
+
+void setUp() {
+    hal::native::reset();
+}
+
+void tearDown() {}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+
+    RUN_TEST(testTokenizeSplitsOnSpaces);
+    RUN_TEST(testTokenizeOverflow);
+    RUN_TEST(testParseNumber);
+    RUN_TEST(testParseNumberBase);
+    RUN_TEST(testDispatchFlag);
+
+    RUN_TEST(testSwitchChecksum);
+    RUN_TEST(testBuildSwitchFrame);
+    RUN_TEST(testSwitchRawFrame);
+    RUN_TEST(testCrc16);
+    RUN_TEST(testCobsRoundTrip);
+    RUN_TEST(testCobsRejectsMalformed);
+
+    RUN_TEST(testStepAxisReachesTarget);
+    RUN_TEST(testStepAxisPulseWidth);
+    RUN_TEST(testStepAxisReverse);
+    RUN_TEST(testStepAxisStop);
+    RUN_TEST(testStepAxisVelocityLimit);
+    RUN_TEST(testStepAxisPulseSpacing);
+    RUN_TEST(testStepAxisBoardAxes);
+
+    RUN_TEST(testSolenoidPulseTiming);
+    RUN_TEST(testSolenoidStagger);
+    RUN_TEST(testSolenoidContinuousCancel);
+    RUN_TEST(testSolenoidLatePulse);
+
+    RUN_TEST(testPressureLoopStep);
+    RUN_TEST(testPressureOpenLoopError);
+    RUN_TEST(testPressureLongWave);
+
+    RUN_TEST(testRs485Scheduling);
+    RUN_TEST(testRs485QueueFull);
+    RUN_TEST(testRs485LateReply);
+    RUN_TEST(testRs485OfflineDevice);
+
+    RUN_TEST(testLedAnimationLimits);
+
+    return UNITY_END();
+}
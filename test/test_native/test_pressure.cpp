@@ -0,0 +1,156 @@
+#include <unity.h>
+
+#include "board_config.hpp"
+#include "constants.hpp"
+#include "hal_native.hpp"
+#include "pressure_output.hpp"
+#include "pressure_sensor.hpp"
+#include "test_cases.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+constexpr float FULL_SCALE_KPA = 100;
+
+// 阶跃响应的验收范围：40ms时间常数的被控对象上，超调不超过3%，150ms内进入±2%稳定带
+// 默认参数下实测超调约1%，稳定时间55~75ms
+constexpr float OVERSHOOT_MAX = 0.03f;
+constexpr uint32_t SETTLE_MAX_US = 150000;
+
+constexpr bool B_LOOP_PRESENT = BOARD.dac.b_present && BOARD.pressure_sensor.b_present;
+
+// 与host_main.cpp相同的被控对象：阀输出为DAC满量程的92%、开启压强2kPa，一阶滞后40ms
+void attachPlant() {
+    constexpr auto& sensor = BOARD.pressure_sensor;
+    constexpr float valve_kpa_per_code = 0.92f * 100 / 4096;
+    constexpr float sensor_mv_per_kpa = (sensor.full_mv - sensor.zero_mv) / sensor.full_kpa;
+    hal::native::setAnalogPlant({
+        .pin = sensor.pin,
+        .dac_address = BOARD.dac.address,
+        .gain_mv_per_code = valve_kpa_per_code * sensor_mv_per_kpa,
+        .offset_mv = sensor.zero_mv - 2 * sensor_mv_per_kpa,
+        .tau_us = 40000,
+    });
+}
+
+AnalogPressureSensor& sensor() {
+    static AnalogPressureSensor instance(BOARD.pressure_sensor.pin, BOARD.pressure_sensor.zero_mv,
+                                         BOARD.pressure_sensor.full_mv, BOARD.pressure_sensor.full_kpa);
+    return instance;
+}
+
+// 闹钟在模拟HAL中一直有效，整个测试程序共用一个输出引擎
+PressureOutput& output() {
+    static PressureOutput instance;
+    static bool b_started = false;
+    if (!b_started) {
+        sensor().begin();
+        instance.begin(0, sensor());
+        b_started = true;
+    }
+    return instance;
+}
+
+uint16_t kpaToCode(float kpa) {
+    return static_cast<uint16_t>(std::lround(kpa / FULL_SCALE_KPA * 4096));
+}
+
+void setPressure(float kpa) {
+    TEST_ASSERT_TRUE(output().submit({.type = DacCommandType::SET, .code = kpaToCode(kpa)}));
+}
+
+// 接上被控对象、打开闭环并从0 kPa稳定下来
+void startLoop() {
+    attachPlant();
+    PressureLoopConfig config;
+    config.b_enabled = true;
+    config.full_scale_kpa = FULL_SCALE_KPA;
+    TEST_ASSERT_TRUE(output().configureLoop(config));
+    setPressure(0);
+    hal::native::advanceUs(500000);
+    TEST_ASSERT_TRUE(output().loopEnabled());
+}
+
+void stopLoop() {
+    PressureLoopConfig config;
+    config.full_scale_kpa = FULL_SCALE_KPA;
+    output().configureLoop(config);
+    setPressure(0);
+    hal::native::advanceUs(1000);
+}
+
+// 设定值阶跃后运行1s：响应统计有效、已稳定，超调与稳定时间在范围内，稳态没有静差
+void checkStep(float kpa) {
+    setPressure(kpa);
+    hal::native::advanceUs(1000000);
+
+    const StepResponse step = output().stepResponse();
+    TEST_ASSERT_TRUE(step.b_valid);
+    TEST_ASSERT_TRUE(step.b_settled);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, kpaToCode(kpa) / 4096.0f, step.to);
+    TEST_ASSERT_TRUE(step.overshoot <= OVERSHOOT_MAX);
+    TEST_ASSERT_GREATER_THAN(0, step.settle_us);
+    TEST_ASSERT_LESS_OR_EQUAL(SETTLE_MAX_US, step.settle_us);
+
+    float measured = 0;
+    TEST_ASSERT_TRUE(output().measuredPressure(measured));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, kpa, measured);
+}
+
+} // namespace
+
+// 升压与降压的阶跃，被控对象增益只有92%且有2kPa的开启压强，积分项必须消除静差
+void testPressureLoopStep() {
+    if (!B_LOOP_PRESENT) TEST_IGNORE_MESSAGE("板上没有比例阀闭环");
+    startLoop();
+    checkStep(30);
+    checkStep(60);
+    checkStep(20);
+    stopLoop();
+}
+
+// 开环时同样的设定值达不到目标，说明上面的用例确实由闭环修正
+void testPressureOpenLoopError() {
+    if (!B_LOOP_PRESENT) TEST_IGNORE_MESSAGE("板上没有比例阀闭环");
+    attachPlant();
+    stopLoop();
+    TEST_ASSERT_FALSE(output().loopEnabled());
+    setPressure(60);
+    hal::native::advanceUs(1000000);
+
+    TEST_ASSERT_EQUAL(kpaToCode(60), output().currentCode());
+    float measured = 0;
+    TEST_ASSERT_TRUE(sensor().read(measured));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 60 * 0.92f - 2, measured);
+    stopLoop();
+}
+
+// 10分钟一遍的两点波形：8遍共80分钟，超过32位µs（约71.6分钟）后仍能结束并停在最后一个点
+// 循环播放经过micros()回绕后相位连续，10.5遍时位于两点中间
+void testPressureLongWave() {
+    if (!BOARD.dac.b_present) TEST_IGNORE_MESSAGE("板上没有比例阀");
+    stopLoop();
+    constexpr uint32_t PERIOD_US = 600000000;
+    constexpr uint64_t MINUTE_US = 60000000;
+    const std::array<uint16_t, 2> points {{0, 4000}};
+
+    TEST_ASSERT_TRUE(output().loadWave(points.data(), points.size()));
+    TEST_ASSERT_TRUE(output().submit({.type = DacCommandType::WAVE, .duration_us = PERIOD_US, .repeats = 8}));
+    hal::native::advanceUs(79 * MINUTE_US);
+    TEST_ASSERT_TRUE(output().busy());
+    TEST_ASSERT_TRUE(output().wavePlaying());
+    hal::native::advanceUs(2 * MINUTE_US);
+    TEST_ASSERT_FALSE(output().busy());
+    TEST_ASSERT_FALSE(output().wavePlaying());
+    TEST_ASSERT_EQUAL(4000, output().currentCode());
+
+    TEST_ASSERT_TRUE(output().loadWave(points.data(), points.size()));
+    TEST_ASSERT_TRUE(output().submit({.type = DacCommandType::WAVE, .duration_us = PERIOD_US, .repeats = 0}));
+    hal::native::advanceUs(105 * MINUTE_US);
+    TEST_ASSERT_FALSE(output().busy());
+    TEST_ASSERT_UINT16_WITHIN(10, 2000, output().setpointCode());
+    stopLoop();
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+
+#include "binary_protocol.hpp"
+#include "constants.hpp"
+#include "misc.hpp"
+#include "test_cases.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// 切换阀帧：CC 地址 功能码 参数 00 DD 校验和低位 校验和高位，校验和为前六字节之和
+void testSwitchChecksum() {
+    std::array<uint8_t, INSTR_485_LEN> frame {{0xcc, 0x00, 0x20, 0x00, 0x00, 0xdd, 0xc9, 0x01}};
+    TEST_ASSERT_EQUAL_HEX16(0x01c9, switchChecksum(frame.data()));
+    TEST_ASSERT_TRUE(switchFrameValid(frame.data()));
+
+    // 校验和的高低字节都要对上
+    frame[7] = 0x00;
+    TEST_ASSERT_FALSE(switchFrameValid(frame.data()));
+    frame[7] = 0x01;
+    frame[6] = 0xc8;
+    TEST_ASSERT_FALSE(switchFrameValid(frame.data()));
+    frame[6] = 0xc9;
+
+    // 帧头帧尾
+    frame[0] = 0xcd;
+    TEST_ASSERT_FALSE(switchFrameValid(frame.data()));
+    frame[0] = 0xcc;
+    frame[5] = 0xde;
+    TEST_ASSERT_FALSE(switchFrameValid(frame.data()));
+}
+
+void testBuildSwitchFrame() {
+    std::array<uint8_t, INSTR_485_LEN> frame{};
+
+    TEST_ASSERT_TRUE(buildSwitchFrame(SwitchChannel{4}, 0, frame.data()));
+    const std::array<uint8_t, INSTR_485_LEN> channel {{0xcc, 0x00, 0x44, 0x04, 0x00, 0xdd, 0xf1, 0x01}};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(channel.data(), frame.data(), INSTR_485_LEN);
+
+    // 地址写在第二字节并计入校验和
+    TEST_ASSERT_TRUE(buildSwitchFrame(SwitchCheck{}, 2, frame.data()));
+    const std::array<uint8_t, INSTR_485_LEN> check {{0xcc, 0x02, 0x3e, 0x00, 0x00, 0xdd, 0xe9, 0x01}};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(check.data(), frame.data(), INSTR_485_LEN);
+
+    TEST_ASSERT_TRUE(buildSwitchFrame(SwitchReset{}, 0, frame.data()));
+    TEST_ASSERT_EQUAL_HEX8(0x45, frame[2]);
+    TEST_ASSERT_TRUE(switchFrameValid(frame.data()));
+
+    TEST_ASSERT_TRUE(buildSwitchFrame(SwitchStatus{}, 0, frame.data()));
+    TEST_ASSERT_EQUAL_HEX8(0x4a, frame[2]);
+    TEST_ASSERT_TRUE(switchFrameValid(frame.data()));
+
+    TEST_ASSERT_FALSE(buildSwitchFrame(SwitchChannel{0}, 0, frame.data()));
+    TEST_ASSERT_FALSE(buildSwitchFrame(SwitchChannel{SWITCH_CHANNEL_COUNT + 1}, 0, frame.data()));
+}
+
+void testSwitchRawFrame() {
+    std::array<uint8_t, INSTR_485_LEN> frame{};
+    TEST_ASSERT_TRUE(buildSwitchFrame(SwitchRaw{"CC00200000ddc901"}, 0, frame.data()));
+    const std::array<uint8_t, INSTR_485_LEN> expected {{0xcc, 0x00, 0x20, 0x00, 0x00, 0xdd, 0xc9, 0x01}};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), frame.data(), INSTR_485_LEN);
+
+    // RAW帧必须正好16个十六进制字符
+    TEST_ASSERT_FALSE(buildSwitchFrame(SwitchRaw{"cc00200000ddc9"}, 0, frame.data()));
+    TEST_ASSERT_FALSE(buildSwitchFrame(SwitchRaw{"cc00200000ddc9011"}, 0, frame.data()));
+    TEST_ASSERT_FALSE(buildSwitchFrame(SwitchRaw{"cc00200000ddc9g1"}, 0, frame.data()));
+}
+
+// CRC-16/CCITT-FALSE：多项式0x1021，初值0xFFFF
+void testCrc16() {
+    const char* check = "123456789";
+    TEST_ASSERT_EQUAL_HEX16(0x29b1, crc16(reinterpret_cast<const uint8_t*>(check), std::strlen(check)));
+    TEST_ASSERT_EQUAL_HEX16(0xffff, crc16(nullptr, 0));
+
+    // 帧中任一位出错，CRC都会不同
+    std::array<uint8_t, 3> frame {{0x01, 0x10, 0x00}};
+    const uint16_t crc = crc16(frame.data(), 3);
+    frame[1] ^= 0x01;
+    TEST_ASSERT_TRUE(crc16(frame.data(), 3) != crc);
+}
+
+static void checkCobsRoundTrip(const uint8_t* data, size_t len) {
+    std::array<uint8_t, cobsMaxEncodedLen(300)> encoded{};
+    std::array<uint8_t, 300> decoded{};
+    const size_t encoded_len = cobsEncode(data, len, encoded.data());
+    TEST_ASSERT_LESS_OR_EQUAL(cobsMaxEncodedLen(len), encoded_len);
+    // 编码结果不含0，0只用作帧分隔符
+    for (size_t i = 0; i < encoded_len; i++) {
+        TEST_ASSERT_TRUE(encoded[i] != 0);
+    }
+    TEST_ASSERT_EQUAL(len, cobsDecode(encoded.data(), encoded_len, decoded.data()));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded.data(), len);
+}
+
+void testCobsRoundTrip() {
+    const std::array<uint8_t, 4> zeros {{0, 0, 0, 0}};
+    checkCobsRoundTrip(zeros.data(), zeros.size());
+
+    const std::array<uint8_t, 6> mixed {{0x11, 0x00, 0x22, 0x33, 0x00, 0x44}};
+    checkCobsRoundTrip(mixed.data(), mixed.size());
+
+    std::array<uint8_t, 6> encoded{};
+    TEST_ASSERT_EQUAL(6, cobsEncode(mixed.data(), 5, encoded.data()));
+    const std::array<uint8_t, 6> expected {{0x02, 0x11, 0x03, 0x22, 0x33, 0x01}};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), encoded.data(), expected.size());
+
+    // 含CRC的最长一帧，以及跨过254字节分组边界的长数据
+    std::array<uint8_t, BINARY_FRAME_MAX + 2> frame{};
+    for (size_t i = 0; i < frame.size(); i++) {
+        frame[i] = static_cast<uint8_t>(i % 7);
+    }
+    checkCobsRoundTrip(frame.data(), frame.size());
+
+    std::array<uint8_t, 300> long_run{};
+    for (size_t i = 0; i < long_run.size(); i++) {
+        long_run[i] = static_cast<uint8_t>(i % 255 + 1);
+    }
+    checkCobsRoundTrip(long_run.data(), 254);
+    checkCobsRoundTrip(long_run.data(), 255);
+    checkCobsRoundTrip(long_run.data(), long_run.size());
+}
+
+void testCobsRejectsMalformed() {
+    std::array<uint8_t, 8> decoded{};
+
+    // 分组码为0
+    const std::array<uint8_t, 3> zero_code {{0x02, 0x11, 0x00}};
+    TEST_ASSERT_EQUAL(0, cobsDecode(zero_code.data(), zero_code.size(), decoded.data()));
+
+    // 分组长度超出输入
+    const std::array<uint8_t, 3> truncated {{0x05, 0x11, 0x22}};
+    TEST_ASSERT_EQUAL(0, cobsDecode(truncated.data(), truncated.size(), decoded.data()));
+}
@@ -0,0 +1,236 @@
+#include <unity.h>
+
+#include "constants.hpp"
+#include "hal.hpp"
+#include "hal_native.hpp"
+#include "misc.hpp"
+#include "rs485_bus.hpp"
+#include "test_cases.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Frame = std::array<uint8_t, INSTR_485_LEN>;
+
+// 应答按回调顺序记下，tag区分同一设备的各个事务
+struct Completion {
+    int tag;
+    Rs485Status status;
+    Frame response;
+};
+
+std::vector<Completion>& completions() {
+    static std::vector<Completion> list;
+    return list;
+}
+
+void record(const Rs485Transaction& txn, void* context) {
+    completions().push_back({static_cast<int>(reinterpret_cast<intptr_t>(context)), txn.status, txn.response});
+}
+
+void* tagged(int tag) {
+    return reinterpret_cast<void*>(static_cast<intptr_t>(tag));
+}
+
+// 发往address的查询帧，第4字节放tag以便从线上认出是哪个事务
+Frame request(uint8_t address, uint8_t tag) {
+    Frame frame {{0xcc, address, 0x3e, tag, 0x00, 0xdd, 0, 0}};
+    const uint16_t sum = switchChecksum(frame.data());
+    frame[6] = static_cast<uint8_t>(sum % 256);
+    frame[7] = static_cast<uint8_t>(sum / 256);
+    return frame;
+}
+
+// address的应答，通道号放value
+Frame reply(uint8_t address, uint8_t value) {
+    Frame frame {{0xcc, address, 0x00, value, 0x00, 0xdd, 0, 0}};
+    const uint16_t sum = switchChecksum(frame.data());
+    frame[6] = static_cast<uint8_t>(sum % 256);
+    frame[7] = static_cast<uint8_t>(sum / 256);
+    return frame;
+}
+
+// 取出总线上已发出的帧
+std::vector<Frame> sentFrames() {
+    const std::string bytes = hal::native::rs485Mock().takeOutput();
+    TEST_ASSERT_EQUAL(0, bytes.size() % INSTR_485_LEN);
+    std::vector<Frame> frames(bytes.size() / INSTR_485_LEN);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        frames[i / INSTR_485_LEN][i % INSTR_485_LEN] = static_cast<uint8_t>(bytes[i]);
+    }
+    return frames;
+}
+
+// 总线上应当正好发出了发往address、tag的一帧
+void expectSent(uint8_t address, uint8_t tag) {
+    const std::vector<Frame> frames = sentFrames();
+    TEST_ASSERT_EQUAL(1, frames.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(request(address, tag).data(), frames[0].data(), INSTR_485_LEN);
+}
+
+void answer(Rs485Bus& bus, const Frame& frame) {
+    hal::native::rs485Mock().inject(frame.data(), frame.size());
+    bus.poll();
+}
+
+void submit(Rs485Bus& bus, int device, uint8_t tag) {
+    const Frame frame = request(bus.address(device), tag);
+    TEST_ASSERT_TRUE(bus.submit(device, frame.data(), record, tagged(tag)));
+}
+
+} // namespace
+
+// 三台设备：优先级高的先得到总线，同优先级按设备编号轮流，每台设备的事务按提交顺序发出
+void testRs485Scheduling() {
+    completions().clear();
+    Rs485Bus bus(hal::rs485Serial());
+    const int a = bus.attach(0x10);
+    const int b = bus.attach(0x11);
+    const int c = bus.attach(0x12, 1);
+    TEST_ASSERT_EQUAL(3, bus.deviceCount());
+
+    // 总线空闲时立即发送，其余排队
+    submit(bus, a, 1);
+    expectSent(0x10, 1);
+    submit(bus, a, 2);
+    submit(bus, a, 3);
+    submit(bus, b, 4);
+    submit(bus, b, 5);
+    submit(bus, c, 6);
+    // 等待应答的事务仍在队首，计入pending
+    TEST_ASSERT_EQUAL(6, bus.pending());
+    TEST_ASSERT_TRUE(bus.busy(c));
+
+    // 每收到一个应答发出下一帧：C优先，然后A、B轮流
+    const std::array<std::pair<uint8_t, uint8_t>, 6> order {{
+        {0x10, 1}, {0x12, 6}, {0x10, 2}, {0x11, 4}, {0x10, 3}, {0x11, 5},
+    }};
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i > 0) expectSent(order[i].first, order[i].second);
+        answer(bus, reply(order[i].first, order[i].second));
+    }
+    TEST_ASSERT_TRUE(sentFrames().empty());
+    TEST_ASSERT_FALSE(bus.busy());
+
+    TEST_ASSERT_EQUAL(order.size(), completions().size());
+    for (size_t i = 0; i < order.size(); i++) {
+        TEST_ASSERT_EQUAL(order[i].second, completions()[i].tag);
+        TEST_ASSERT_TRUE(completions()[i].status == Rs485Status::OK);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(reply(order[i].first, order[i].second).data(),
+                                      completions()[i].response.data(), INSTR_485_LEN);
+    }
+    TEST_ASSERT_EQUAL(3, bus.statistics(a).sent);
+    TEST_ASSERT_EQUAL(3, bus.statistics(a).replied);
+    TEST_ASSERT_EQUAL(2, bus.statistics(b).replied);
+    TEST_ASSERT_EQUAL(1, bus.statistics(c).replied);
+}
+
+// 每台设备的队列满时拒绝，出队后又可以提交
+void testRs485QueueFull() {
+    completions().clear();
+    Rs485Bus bus(hal::rs485Serial());
+    const int a = bus.attach(0x10);
+    const int b = bus.attach(0x11);
+
+    // 第一帧立即发出并仍占着队首
+    for (size_t i = 0; i < RS485_DEVICE_QUEUE_LEN; i++) {
+        submit(bus, a, static_cast<uint8_t>(i + 1));
+    }
+    expectSent(0x10, 1);
+    const Frame extra = request(0x10, 9);
+    TEST_ASSERT_FALSE(bus.submit(a, extra.data(), record, tagged(9)));
+    // 其他设备的队列不受影响
+    submit(bus, b, 10);
+
+    answer(bus, reply(0x10, 1));
+    expectSent(0x11, 10);
+    TEST_ASSERT_TRUE(bus.submit(a, extra.data(), record, tagged(9)));
+    // A的队列又满了，B还有一个在等待应答
+    TEST_ASSERT_FALSE(bus.submit(a, extra.data(), record, tagged(9)));
+    TEST_ASSERT_EQUAL(RS485_DEVICE_QUEUE_LEN + 1, bus.pending());
+}
+
+// A超时后B得到总线，A迟到的应答按地址丢弃并计数，不会当作B的应答；帧前的杂散字节被跳过
+void testRs485LateReply() {
+    completions().clear();
+    Rs485Bus bus(hal::rs485Serial());
+    const int a = bus.attach(0x10, 0, 50);
+    const int b = bus.attach(0x11, 0, 50);
+
+    submit(bus, a, 1);
+    submit(bus, b, 2);
+    expectSent(0x10, 1);
+
+    hal::native::advanceUs(49000);
+    bus.poll();
+    TEST_ASSERT_TRUE(completions().empty());
+    hal::native::advanceUs(1000);
+    bus.poll();
+    TEST_ASSERT_EQUAL(1, completions().size());
+    TEST_ASSERT_EQUAL(1, completions()[0].tag);
+    TEST_ASSERT_TRUE(completions()[0].status == Rs485Status::TIMEOUT);
+    expectSent(0x11, 2);
+
+    answer(bus, reply(0x10, 1));
+    TEST_ASSERT_EQUAL(1, completions().size());
+    TEST_ASSERT_EQUAL(1, bus.statistics(a).late_replies);
+    TEST_ASSERT_EQUAL(0, bus.statistics(b).late_replies);
+    TEST_ASSERT_TRUE(bus.busy(b));
+
+    const std::array<uint8_t, 3> noise {{0x00, 0x55, 0xdd}};
+    hal::native::rs485Mock().inject(noise.data(), noise.size());
+    answer(bus, reply(0x11, 2));
+    TEST_ASSERT_EQUAL(2, completions().size());
+    TEST_ASSERT_EQUAL(2, completions()[1].tag);
+    TEST_ASSERT_TRUE(completions()[1].status == Rs485Status::OK);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(reply(0x11, 2).data(), completions()[1].response.data(), INSTR_485_LEN);
+
+    TEST_ASSERT_EQUAL(1, bus.statistics(a).timeouts);
+    TEST_ASSERT_EQUAL(1, bus.statistics(b).replied);
+    TEST_ASSERT_FALSE(bus.busy());
+}
+
+// 连续超时RS485_OFFLINE_AFTER次的设备离线，只在其他设备没有待发事务时才得到总线，应答后恢复
+void testRs485OfflineDevice() {
+    completions().clear();
+    Rs485Bus bus(hal::rs485Serial());
+    const int a = bus.attach(0x10, 1, 10);
+    const int b = bus.attach(0x11, 0, 10);
+
+    for (uint32_t i = 0; i < RS485_OFFLINE_AFTER; i++) {
+        submit(bus, a, static_cast<uint8_t>(i + 1));
+        hal::native::advanceUs(10000);
+        bus.poll();
+    }
+    TEST_ASSERT_FALSE(bus.deviceOnline(a));
+    TEST_ASSERT_EQUAL(RS485_OFFLINE_AFTER, sentFrames().size());
+
+    // 离线的A即使优先级更高，也排在有事务的B之后
+    submit(bus, b, 20);
+    submit(bus, b, 21);
+    submit(bus, a, 22);
+    expectSent(0x11, 20);
+    answer(bus, reply(0x11, 20));
+    expectSent(0x11, 21);
+    answer(bus, reply(0x11, 21));
+    expectSent(0x10, 22);
+    answer(bus, reply(0x10, 22));
+    TEST_ASSERT_TRUE(bus.deviceOnline(a));
+    TEST_ASSERT_EQUAL(0, bus.statistics(a).consecutive_timeouts);
+
+    // 一次校验失败也说明设备在线
+    submit(bus, a, 23);
+    expectSent(0x10, 23);
+    Frame corrupted = reply(0x10, 23);
+    corrupted[6] ^= 0xff;
+    answer(bus, corrupted);
+    TEST_ASSERT_TRUE(completions().back().status == Rs485Status::BAD_CHECKSUM);
+    TEST_ASSERT_EQUAL(1, bus.statistics(a).bad_frames);
+    TEST_ASSERT_TRUE(bus.deviceOnline(a));
+}
@@ -0,0 +1,186 @@
+#include <unity.h>
+
+#include "constants.hpp"
+#include "hal.hpp"
+#include "hal_native.hpp"
+#include "solenoid_scheduler.hpp"
+#include "test_cases.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// 一个通道的一次切换，时间取自模拟HAL的锁存日志
+struct Edge {
+    uint32_t time_us;
+    bool level;
+};
+
+// 调度器的闹钟在模拟HAL中一直有效，所以整个测试程序共用一个调度器
+SolenoidScheduler& scheduler() {
+    static SolenoidScheduler instance;
+    static bool b_started = false;
+    if (!b_started) {
+        instance.begin();
+        b_started = true;
+    }
+    return instance;
+}
+
+// 取消上一个用例留下的定时并全部关闭，返回此后锁存日志的起点
+size_t startClean() {
+    scheduler().submit({.type = ValveCommandType::SET, .mask = 0, .close_mask = SOLENOID_MASK_ALL});
+    hal::native::advanceUs(1);
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().currentOutput());
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().timedChannels());
+    return hal::native::shiftLog().size();
+}
+
+SolenoidMask latchedMask(const hal::native::ShiftEvent& shift) {
+    // bytes[0]最先移出，离DS最远；最后一个字节是通道1~8
+    SolenoidMask mask = 0;
+    for (size_t chip = 0; chip < shift.bytes.size(); chip++) {
+        mask |= static_cast<SolenoidMask>(shift.bytes[shift.bytes.size() - 1 - chip]) << (chip * 8);
+    }
+    return mask;
+}
+
+// 从first起的锁存日志中取出channel（从0开始）的每次切换
+std::vector<Edge> channelEdges(size_t first, size_t channel) {
+    std::vector<Edge> edges;
+    const auto& log = hal::native::shiftLog();
+    bool b_level = false;
+    for (size_t i = first; i < log.size(); i++) {
+        const bool b_on = (latchedMask(log[i]) >> channel) & 1;
+        if (b_on != b_level) {
+            edges.push_back({static_cast<uint32_t>(log[i].time_ns / 1000), b_on});
+            b_level = b_on;
+        }
+    }
+    return edges;
+}
+
+// 按开启时刻与开/关时长展开的期望切换
+void checkPulses(const std::vector<Edge>& edges, uint32_t start_us, uint32_t on_us, uint32_t off_us, uint32_t cycles) {
+    TEST_ASSERT_EQUAL(cycles * 2, edges.size());
+    uint32_t t = start_us;
+    for (uint32_t i = 0; i < cycles; i++) {
+        TEST_ASSERT_TRUE(edges[i * 2].level);
+        TEST_ASSERT_EQUAL_UINT32(t, edges[i * 2].time_us);
+        t += on_us;
+        TEST_ASSERT_FALSE(edges[i * 2 + 1].level);
+        TEST_ASSERT_EQUAL_UINT32(t, edges[i * 2 + 1].time_us);
+        t += off_us;
+    }
+}
+
+} // namespace
+
+// 延迟1ms开始，开5ms关3ms共3次：每次切换都落在计划时刻，结束后保持关闭且不再占用调度器
+void testSolenoidPulseTiming() {
+    if (SOLENOID_CHANNELS == 0) TEST_IGNORE_MESSAGE("板上没有电磁阀");
+    const size_t first = startClean();
+    const uint32_t start_us = hal::micros() + 1000;
+    TEST_ASSERT_TRUE(scheduler().submit({
+        .type = ValveCommandType::TIMED,
+        .mask = 0x1,
+        .start_us = start_us,
+        .on_us = 5000,
+        .off_us = 3000,
+        .cycles = 3,
+    }));
+
+    hal::native::advanceUs(500);
+    TEST_ASSERT_TRUE(scheduler().busy());
+    TEST_ASSERT_EQUAL_HEX32(0x1, scheduler().timedChannels());
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().currentOutput());
+
+    hal::native::advanceUs(30000);
+    checkPulses(channelEdges(first, 0), start_us, 5000, 3000, 3);
+    TEST_ASSERT_FALSE(scheduler().busy());
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().timedChannels());
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().currentOutput());
+}
+
+// 三个通道依次推迟2ms开启：前一通道关闭与后一通道开启在同一时刻时合成一次锁存
+void testSolenoidStagger() {
+    if (SOLENOID_CHANNELS < 3) TEST_IGNORE_MESSAGE("板上电磁阀通道不足");
+    const size_t first = startClean();
+    const uint32_t start_us = hal::micros() + 100;
+    TEST_ASSERT_TRUE(scheduler().submit({
+        .type = ValveCommandType::TIMED,
+        .mask = 0x7,
+        .start_us = start_us,
+        .on_us = 2000,
+        .off_us = 1000,
+        .cycles = 1,
+        .stagger_us = 2000,
+    }));
+    hal::native::advanceUs(10000);
+
+    for (size_t ch = 0; ch < 3; ch++) {
+        checkPulses(channelEdges(first, ch), start_us + static_cast<uint32_t>(ch) * 2000, 2000, 1000, 1);
+    }
+    // 开1、关1开2、关2开3、关3
+    TEST_ASSERT_EQUAL(4, hal::native::shiftLog().size() - first);
+    TEST_ASSERT_FALSE(scheduler().busy());
+}
+
+// 次数为0时持续循环，不算作忙；SET关闭该通道即取消定时
+void testSolenoidContinuousCancel() {
+    if (SOLENOID_CHANNELS < 2) TEST_IGNORE_MESSAGE("板上电磁阀通道不足");
+    const size_t first = startClean();
+    const uint32_t start_us = hal::micros();
+    TEST_ASSERT_TRUE(scheduler().submit({
+        .type = ValveCommandType::TIMED,
+        .mask = 0x2,
+        .start_us = start_us,
+        .on_us = 1000,
+        .off_us = 1000,
+        .cycles = 0,
+    }));
+    hal::native::advanceUs(20500);
+    TEST_ASSERT_FALSE(scheduler().busy());
+    TEST_ASSERT_EQUAL_HEX32(0x2, scheduler().timedChannels());
+    TEST_ASSERT_EQUAL_HEX32(0x2, scheduler().currentOutput());
+
+    // 20ms内开关各10次，第11次开启在20ms处
+    const std::vector<Edge> edges = channelEdges(first, 1);
+    TEST_ASSERT_EQUAL(21, edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(start_us + static_cast<uint32_t>(i) * 1000, edges[i].time_us);
+        TEST_ASSERT_EQUAL(i % 2 == 0, edges[i].level);
+    }
+
+    scheduler().submit({.type = ValveCommandType::SET, .mask = 0, .close_mask = 0x2});
+    hal::native::advanceUs(1);
+    const size_t after_cancel = hal::native::shiftLog().size();
+    hal::native::advanceUs(10000);
+    TEST_ASSERT_EQUAL(after_cancel, hal::native::shiftLog().size());
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().timedChannels());
+    TEST_ASSERT_EQUAL_HEX32(0, scheduler().currentOutput());
+}
+
+// 指令到达时开启时刻已过去且超过了开启时长：开启与关闭分两次锁存，阀上仍能看到这个脉冲
+void testSolenoidLatePulse() {
+    if (SOLENOID_CHANNELS < 3) TEST_IGNORE_MESSAGE("板上电磁阀通道不足");
+    hal::native::advanceUs(1000);
+    const size_t first = startClean();
+    TEST_ASSERT_TRUE(scheduler().submit({
+        .type = ValveCommandType::TIMED,
+        .mask = 0x4,
+        .start_us = hal::micros() - 500,
+        .on_us = 200,
+        .off_us = 1000,
+        .cycles = 1,
+    }));
+    hal::native::advanceUs(5000);
+
+    const auto& log = hal::native::shiftLog();
+    TEST_ASSERT_EQUAL(2, log.size() - first);
+    TEST_ASSERT_EQUAL_HEX32(0x4, latchedMask(log[first]));
+    TEST_ASSERT_EQUAL_HEX32(0, latchedMask(log[first + 1]));
+    TEST_ASSERT_FALSE(scheduler().busy());
+}
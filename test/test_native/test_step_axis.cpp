@@ -0,0 +1,249 @@
+#include <unity.h>
+
+#include "axis_registry.hpp"
+#include "constants.hpp"
+#include "step_engine.hpp"
+#include "test_cases.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// 与板上无关的一组运动参数：加速段0.3s、1200步
+constexpr float TEST_SPEED = 8000;          // 步/s
+constexpr float TEST_ACCELERATION = 40000;  // 步/s²
+constexpr float TEST_JERK = 400000;         // 步/s³
+constexpr uint64_t TICK_LIMIT = 10ULL * STEP_TICK_FREQ;
+
+static StepAxis makeAxis() {
+    StepAxis axis;
+    axis.setMaxSpeed(TEST_SPEED);
+    axis.setAcceleration(TEST_ACCELERATION);
+    axis.setJerk(TEST_JERK);
+    return axis;
+}
+
+// 按STEP_TICK_FREQ调用tick()直到停下，返回每一步所在的tick序号
+static std::vector<uint64_t> runToIdle(StepAxis& axis, uint64_t start_tick = 0) {
+    std::vector<uint64_t> steps;
+    for (uint64_t tick = start_tick; axis.isRunning() && tick < start_tick + TICK_LIMIT; tick++) {
+        if (axis.tick() & StepAxis::ACTION_STEP_HIGH) {
+            steps.push_back(tick);
+        }
+    }
+    return steps;
+}
+
+void testStepAxisReachesTarget() {
+    StepAxis axis = makeAxis();
+    axis.move(10000);
+    TEST_ASSERT_TRUE(axis.isRunning());
+    TEST_ASSERT_EQUAL(10000, axis.distanceToGo());
+
+    const std::vector<uint64_t> steps = runToIdle(axis);
+    TEST_ASSERT_FALSE(axis.isRunning());
+    TEST_ASSERT_EQUAL(10000, axis.currentPosition());
+    TEST_ASSERT_EQUAL(10000, steps.size());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, axis.speed());
+
+    // 两段0.3s的斜坡加上7600步巡航，共1.55s
+    const double seconds = static_cast<double>(steps.back()) / STEP_TICK_FREQ;
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 1.55, seconds);
+
+    // 距离不够完整加减速时降低巡航速度，照样精确停在目标
+    axis.move(-300);
+    runToIdle(axis);
+    TEST_ASSERT_FALSE(axis.isRunning());
+    TEST_ASSERT_EQUAL(9700, axis.currentPosition());
+}
+
+void testStepAxisPulseWidth() {
+    StepAxis axis = makeAxis();
+    axis.move(3000);
+    bool b_high = false;
+    for (uint64_t tick = 0; tick < TICK_LIMIT && (axis.isRunning() || b_high); tick++) {
+        const uint8_t action = axis.tick();
+        if (b_high) {
+            // 拉高后的下一tick必须拉低，且不能同时再走一步
+            TEST_ASSERT_TRUE(action & StepAxis::ACTION_STEP_LOW);
+            TEST_ASSERT_FALSE(action & StepAxis::ACTION_STEP_HIGH);
+        } else {
+            TEST_ASSERT_FALSE(action & StepAxis::ACTION_STEP_LOW);
+        }
+        b_high = action & StepAxis::ACTION_STEP_HIGH;
+    }
+    TEST_ASSERT_FALSE(b_high);
+    TEST_ASSERT_EQUAL(3000, axis.currentPosition());
+}
+
+void testStepAxisReverse() {
+    StepAxis axis = makeAxis();
+    axis.move(5000);
+    for (uint64_t tick = 0; tick < STEP_TICK_FREQ / 2; tick++) {
+        axis.tick();
+    }
+    TEST_ASSERT_TRUE(axis.speed() > 0);
+    const long turn_at = axis.currentPosition();
+
+    // 运动中改到反方向的目标：先减速到最低速度，换向一次后走到目标
+    axis.moveTo(-2000);
+    int dir_changes = 0;
+    long farthest = turn_at;
+    for (uint64_t tick = 0; tick < TICK_LIMIT && axis.isRunning(); tick++) {
+        if (axis.tick() & StepAxis::ACTION_DIR_CHANGE) dir_changes++;
+        farthest = std::max(farthest, axis.currentPosition());
+    }
+    TEST_ASSERT_EQUAL(1, dir_changes);
+    TEST_ASSERT_EQUAL(-1, axis.currentDirection());
+    TEST_ASSERT_EQUAL(-2000, axis.currentPosition());
+    // 减速距离不超过加速段的1200步
+    TEST_ASSERT_LESS_OR_EQUAL(turn_at + 1201, farthest);
+}
+
+void testStepAxisStop() {
+    StepAxis axis = makeAxis();
+    axis.move(100000);
+    for (uint64_t tick = 0; tick < STEP_TICK_FREQ; tick++) {
+        axis.tick();
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, TEST_SPEED, axis.speed());
+    const long stop_at = axis.currentPosition();
+
+    // 巡航中停止：沿加速曲线原路减速，约0.3s、1200步
+    axis.stop();
+    const std::vector<uint64_t> steps = runToIdle(axis);
+    TEST_ASSERT_FALSE(axis.isRunning());
+    TEST_ASSERT_INT_WITHIN(2, 1200, axis.currentPosition() - stop_at);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 0.3, static_cast<double>(steps.back()) / STEP_TICK_FREQ);
+}
+
+void testStepAxisVelocityLimit() {
+    StepAxis axis = makeAxis();
+    TEST_ASSERT_TRUE(axis.runVelocity(-4000, -5000));
+    TEST_ASSERT_TRUE(axis.velocityMode());
+    // 到达limit时交给位置模式减速，精确停在起点+limit处
+    runToIdle(axis);
+    TEST_ASSERT_FALSE(axis.isRunning());
+    TEST_ASSERT_EQUAL(-5000, axis.currentPosition());
+    TEST_ASSERT_EQUAL(-5000, axis.velocityDisplacement());
+
+    // 位置运动中不能切换到恒速运行
+    axis.move(100);
+    TEST_ASSERT_FALSE(axis.runVelocity(1000, 0));
+}
+
+// 逐步检查一次从静止到静止的位置运动的脉冲间隔（tick），各段按时间划分：
+// 加速段为起步后的斜坡时长，减速段为停下前的斜坡时长，其余为巡航
+//   加速段：间隔只减不增，减速段：只增不减，允许DDA量化带来的1 tick抖动
+//   巡航段：间隔只取ideal的上下取整两值，平均间隔与ideal相差不超过0.01%，
+//           每一步相对按平均间隔排布的等间隔时刻，偏差的范围不超过1 tick
+//   每20ms窗口的平均速度变化不超过加速度限制（加上窗口计数量化的余量），任何时候都不超过巡航速度
+static void checkPulseSpacing(const std::vector<uint64_t>& steps, float speed, float acceleration, float ramp_time) {
+    TEST_ASSERT_GREATER_THAN(2, steps.size());
+    const double ideal = static_cast<double>(STEP_TICK_FREQ) / speed;
+    const double ramp_ticks = ramp_time * STEP_TICK_FREQ;
+    const uint64_t first = steps.front();
+    const uint64_t last = steps.back();
+    const uint64_t min_interval = static_cast<uint64_t>(std::floor(ideal));
+    const uint64_t max_cruise = static_cast<uint64_t>(std::ceil(ideal));
+
+    size_t cruise_first = 0;
+    size_t cruise_last = 0;
+    for (size_t i = 1; i < steps.size(); i++) {
+        const uint64_t interval = steps[i] - steps[i - 1];
+        const uint64_t prev = (i >= 2) ? steps[i - 1] - steps[i - 2] : interval;
+        const double since_start = static_cast<double>(steps[i] - first);
+        const double before_end = static_cast<double>(last - steps[i]);
+
+        // 一步至少两个tick（高、低各一个），且不快于巡航速度
+        TEST_ASSERT_GREATER_OR_EQUAL(2, interval);
+        TEST_ASSERT_GREATER_OR_EQUAL(min_interval, interval);
+
+        if (since_start <= ramp_ticks) {
+            TEST_ASSERT_LESS_OR_EQUAL(prev + 1, interval);
+        } else if (before_end <= ramp_ticks) {
+            TEST_ASSERT_GREATER_OR_EQUAL(prev - 1, interval);
+        } else if (since_start > ramp_ticks * 1.05 && before_end > ramp_ticks * 1.05) {
+            TEST_ASSERT_LESS_OR_EQUAL(max_cruise, interval);
+            if (cruise_first == 0) cruise_first = i;
+            cruise_last = i;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(100, cruise_last - cruise_first);
+
+    // 巡航段按最小二乘拟合 tick = base + mean × n，DDA的每一步相对拟合直线的偏差范围不超过1 tick（另留1%拟合误差）
+    const double n = static_cast<double>(cruise_last - cruise_first + 1);
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    for (size_t i = cruise_first; i <= cruise_last; i++) {
+        const double x = static_cast<double>(i - cruise_first);
+        const double y = static_cast<double>(steps[i] - steps[cruise_first]);
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+    const double mean = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+    const double base = (sum_y - mean * sum_x) / n;
+    TEST_ASSERT_FLOAT_WITHIN(ideal * 1e-4, ideal, mean);
+    double drift_min = 0;
+    double drift_max = 0;
+    for (size_t i = cruise_first; i <= cruise_last; i++) {
+        const double drift = static_cast<double>(steps[i] - steps[cruise_first]) - base - (i - cruise_first) * mean;
+        drift_min = std::min(drift_min, drift);
+        drift_max = std::max(drift_max, drift);
+    }
+    TEST_ASSERT_TRUE(drift_max - drift_min <= 1.01);
+
+    constexpr uint64_t WINDOW = STEP_TICK_FREQ / 50;
+    constexpr double WINDOW_S = static_cast<double>(WINDOW) / STEP_TICK_FREQ;
+    std::vector<double> window_speed((last - first) / WINDOW + 1, 0.0);
+    for (const uint64_t tick : steps) {
+        window_speed[(tick - first) / WINDOW] += 1.0 / WINDOW_S;
+    }
+    for (size_t i = 1; i + 1 < window_speed.size(); i++) {
+        TEST_ASSERT_TRUE(window_speed[i] <= speed * 1.01 + 1.0 / WINDOW_S);
+        const double accel = std::fabs(window_speed[i] - window_speed[i - 1]) / WINDOW_S;
+        TEST_ASSERT_TRUE(accel <= acceleration * 1.05 + 2.0 / WINDOW_S / WINDOW_S);
+    }
+}
+
+void testStepAxisPulseSpacing() {
+    // 7000步/s对应11.43 tick/步，巡航段的间隔在11与12之间交替
+    constexpr float speed = 7000;
+    StepAxis axis = makeAxis();
+    axis.setMaxSpeed(speed);
+    axis.move(20000);
+    const std::vector<uint64_t> steps = runToIdle(axis);
+
+    TEST_ASSERT_FALSE(axis.isRunning());
+    TEST_ASSERT_EQUAL(20000, axis.currentPosition());
+    TEST_ASSERT_EQUAL(20000, steps.size());
+    checkPulseSpacing(steps, speed, TEST_ACCELERATION, StepAxis::rampTime(speed, TEST_ACCELERATION, TEST_JERK));
+
+    // 反方向同样的运动，间隔与正向一致
+    axis.move(-20000);
+    const std::vector<uint64_t> back = runToIdle(axis);
+    TEST_ASSERT_EQUAL(0, axis.currentPosition());
+    TEST_ASSERT_EQUAL(-1, axis.currentDirection());
+    checkPulseSpacing(back, speed, TEST_ACCELERATION, StepAxis::rampTime(speed, TEST_ACCELERATION, TEST_JERK));
+}
+
+// 当前板型每个轴按板上的最高速度、加速度与加加速度运动，距离含三倍斜坡长度的巡航段
+void testStepAxisBoardAxes() {
+    for (const AxisDescriptor& desc : AXIS_REGISTRY) {
+        StepAxis axis;
+        axis.setMaxSpeed(desc.max_speed);
+        axis.setAcceleration(desc.acceleration);
+        axis.setJerk(desc.jerk);
+        const float ramp_time = StepAxis::rampTime(desc.max_speed, desc.acceleration, desc.jerk);
+        const long distance = std::lround(desc.max_speed * ramp_time * 3);
+
+        axis.move(distance);
+        const std::vector<uint64_t> steps = runToIdle(axis);
+        TEST_ASSERT_FALSE(axis.isRunning());
+        TEST_ASSERT_EQUAL(distance, axis.currentPosition());
+        TEST_ASSERT_EQUAL(distance, steps.size());
+        checkPulseSpacing(steps, desc.max_speed, desc.acceleration, ramp_time);
+    }
+}